@@ -2,11 +2,22 @@
  *  Decompress an IGC file as done in SoftRF for writing to flash
  *
  *  Usage:  igz2igc infile outfile
+ *          igz2igc -f HHMMSS [-t HHMMSS] infile outfile
+ *              - only the part of the flight between those times (UTC)
+ *          igz2igc -a infile
+ *              - list the times of the collision alarms (LPLTA comments)
+ *          igz2igc -b N infile...
+ *              - benchmark: decompress each file N times, in memory
+ *
+ *  Version 2 files (with "IGZ2" at the end) carry a time index, which
+ *  lets -f start decompressing near the requested time.
+ *  See compressblock() in SoftRF IGC.cpp for the format.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /* buffer sizes */
 #define BSIZE  255
@@ -14,9 +25,18 @@
 /* line length limits for error checking (not including CRLF) */
 #define LONGLINE  128
 
-char *inbuf;
+/* version 2 footer */
+#define INDEX_MAX    64
+#define FOOTER_SIZE  (8*INDEX_MAX + 8)
+#define MAGIC        "IGZ2"
+
+unsigned char *inbuf;
+long insize;
+long dataend;          /* where the footer starts, or insize */
+int nindex = 0;
 char *outbuf;
 long nlines = 0;
+long outbytes = 0;
 
 char outfilename[256];
 
@@ -26,19 +46,102 @@ char brecord[40];
 int tpos[22] = {1,2,3,4,7,8,9,10,14,15,16,17,18,19,23,24,25,26,27,30,31,32};
 int bpos[12] = { 5, 6, 11, 12, 13, 20, 21, 22, 28, 29, 33, 34 };
 
-void decompress(infile, outbuf, outfile)
-    FILE *infile;
+/* output modes */
+#define OUT_FILE    0
+#define OUT_ALARMS  1
+#define OUT_NONE    2
+
+/* time window, in seconds since midnight of the first B-record */
+long wfrom = -1;
+long wto = -1;
+long day = 0;
+long last_time = 0;
+
+long get_le32(p)
+    unsigned char *p;
+{
+    return ((long)p[0] | ((long)p[1] << 8) | ((long)p[2] << 16) | ((long)p[3] << 24));
+}
+
+long brecord_time()
+{
+    return (3600 * (10*(brecord[1]-'0') + (brecord[2]-'0'))
+            + 60 * (10*(brecord[3]-'0') + (brecord[4]-'0'))
+                 + (10*(brecord[5]-'0') + (brecord[6]-'0')));
+}
+
+long hhmmss(s)
+    char *s;
+{
+    long v = atol(s);
+    return (3600 * (v / 10000) + 60 * ((v / 100) % 100) + (v % 100));
+}
+
+/* seconds since midnight to the running time of the file */
+long unwrap(tod, ref)
+    long tod, ref;
+{
+    if (tod + 43200 < ref)    /* after midnight */
+        tod += 86400;
+    return tod;
+}
+
+/* look for the version 2 footer */
+void read_footer()
+{
+    unsigned char *trailer = inbuf + insize - 8;
+    dataend = insize;
+    nindex = 0;
+    if (insize >= FOOTER_SIZE && memcmp(trailer+4, MAGIC, 4) == 0) {
+        nindex = trailer[0] | (trailer[1] << 8);
+        if (nindex > INDEX_MAX)
+            nindex = 0;
+        dataend = insize - FOOTER_SIZE;
+    }
+}
+
+/* find where to start decompressing for the window, and the time there */
+long seek_window(start_time)
+    long *start_time;
+{
+    unsigned char *index = inbuf + dataend;
+    long start = 0;
+    int n;
+    *start_time = 0;
+    if (nindex == 0)
+        return 0;
+    wfrom = unwrap(wfrom, get_le32(index));
+    wto = unwrap(wto, get_le32(index));
+    start = get_le32(index+4);
+    *start_time = get_le32(index);
+    for (n = 1; n < nindex; n++) {
+        if (get_le32(index+8*n) > wfrom)
+            break;
+        *start_time = get_le32(index+8*n);
+        start = get_le32(index+8*n+4);
+    }
+    return start;
+}
+
+void decompress(start, outbuf, outfile, mode)
+    long start;
     char *outbuf;
     FILE *outfile;
+    int mode;
 {
     char *p = outbuf;
     char *t = outbuf + BSIZE;
     int state = 0;
     int i = 0;
+    long pos = start;
+    int started = (wfrom < 0);
+    int resolved = (wfrom < 0 || nindex > 0);
+    long btime = -1;
     while (p < t) {
         char c;
-        if (fread(&c, 1, 1, infile) == 0)
+        if (pos >= dataend)
             break;
+        c = inbuf[pos++];
         if (state == 0) {    // beginning of a line
             p = outbuf;
             if (c == 0x0A) {
@@ -50,6 +153,7 @@ void decompress(infile, outbuf, outfile)
             } else {
                 int opr = (c & 0xE0);
                 int idx = (c & 0x1F);
+                if (idx > 21)  idx = 21;   // should not happen
                 if (opr == 0xA0) {
                     ++brecord[tpos[idx]];
                 } else if (opr == 0xE0) {
@@ -72,9 +176,15 @@ void decompress(infile, outbuf, outfile)
                 *p++ = '\r';
                 *p++ = '\n';
                 state = 0;
-                fwrite(outbuf, 1, (p-outbuf), outfile);
-                ++nlines;
-            } else {
+                if (started) {
+                    if (mode == OUT_FILE)
+                        outbytes += fwrite(outbuf, 1, (p-outbuf), outfile);
+                    else if (mode == OUT_ALARMS && strncmp(outbuf, "LPLTA", 5) == 0)
+                        printf("%.6s  %.*s", (btime < 0 ? "------" : brecord+1),
+                                  (int)(p-outbuf), outbuf);
+                    ++nlines;
+                }
+            } else if (p < t-2) {
                 *p++ = c;
             }
         } else if (state == 0xBB) {   // decompress B-record
@@ -83,9 +193,27 @@ void decompress(infile, outbuf, outfile)
             brecord[bpos[i++]] = c1;
             brecord[bpos[i++]] = c2;
             if (i == 12) {
-                fwrite(brecord, 1, 37, outfile);
-                ++nlines;
                 state = 0;
+                btime = day + brecord_time();
+                if (btime + 43200 < last_time) {    // past midnight
+                    day += 86400;
+                    btime += 86400;
+                }
+                last_time = btime;
+                if (! resolved) {      // version 1: the first B-record is the reference
+                    wfrom = unwrap(wfrom, btime);
+                    wto = unwrap(wto, btime);
+                    resolved = 1;
+                }
+                if (! started && btime >= wfrom)
+                    started = 1;
+                if (wto >= 0 && btime > wto)
+                    break;
+                if (started) {
+                    if (mode == OUT_FILE)
+                        outbytes += fwrite(brecord, 1, 37, outfile);
+                    ++nlines;
+                }
             }
         } else if (state <= 32) {   // template byte
             brecord[state] = c;
@@ -94,64 +222,189 @@ void decompress(infile, outbuf, outfile)
     }
 }
 
-void
+/* read the whole input file into inbuf */
+int load(filename)
+    char *filename;
+{
+    FILE *infile = fopen (filename, "rb");
+    if (infile == NULL) {
+        fprintf (stderr,
+            "error opening input file '%s'\n", filename);
+        return 0;
+    }
+    fseek(infile, 0, SEEK_END);
+    insize = ftell(infile);
+    fseek(infile, 0, SEEK_SET);
+    if (insize < 0
+    || (inbuf = malloc(insize + 8)) == NULL
+    || fread(inbuf, 1, insize, infile) != (size_t) insize) {
+        fprintf (stderr, "error reading input file '%s'\n", filename);
+        fclose (infile);
+        return 0;
+    }
+    fclose (infile);
+    read_footer();
+    return 1;
+}
+
+void start(start_time)
+    long start_time;
+{
+    strcpy(brecord, emptybrecord);
+    nlines = 0;
+    day = (start_time / 86400) * 86400;
+    last_time = start_time;
+}
+
+/* decompress each file 'reps' times, and the middle 5 minutes of it */
+void benchmark(reps, nfiles, files)
+    int reps, nfiles;
+    char **files;
+{
+    FILE *devnull = fopen("/dev/null", "wb");
+    double total_in = 0, total_out = 0, total_secs = 0;
+    int f, r;
+    if (devnull == NULL)
+        devnull = tmpfile();
+    printf("%-16s %4s %9s %9s %6s %9s %11s\n",
+           "file", "ver", "IGZ", "IGC", "ratio", "MB/s", "window ms");
+    for (f = 0; f < nfiles; f++) {
+        clock_t c0, c1;
+        long outsize, start_time, first_time, last;
+        if (! load(files[f]))
+            continue;
+        /* one pass to get the time span */
+        wfrom = wto = -1;
+        start(0);
+        decompress(0L, outbuf, devnull, OUT_NONE);
+        first_time = (nindex > 0 ? get_le32(inbuf + dataend) : 0);
+        last = last_time;
+        outbytes = 0;
+        c0 = clock();
+        for (r = 0; r < reps; r++) {
+            start(0);
+            decompress(0L, outbuf, devnull, OUT_FILE);
+        }
+        c1 = clock();
+        outsize = outbytes / reps;
+        double secs = (double)(c1 - c0) / CLOCKS_PER_SEC;
+        /* a 5-minute window in the middle of the flight */
+        wfrom = (first_time + last) / 2;
+        wto = wfrom + 300;
+        wfrom %= 86400;
+        wto %= 86400;
+        clock_t w0 = clock();
+        for (r = 0; r < reps; r++) {
+            long s;
+            long from = wfrom, to = wto;
+            s = seek_window(&start_time);
+            start(start_time);
+            decompress(s, outbuf, devnull, OUT_NONE);
+            wfrom = from;
+            wto = to;
+        }
+        clock_t w1 = clock();
+        printf("%-16.16s %4d %9ld %9ld %6.2f %9.1f %11.3f\n",
+               files[f], (nindex > 0 ? 2 : 1), insize, outsize,
+               (insize > 0 ? (double)outsize / insize : 0),
+               (secs > 0 ? (outsize * (double)reps) / secs / 1e6 : 0),
+               1000.0 * (double)(w1 - w0) / CLOCKS_PER_SEC / reps);
+        total_in += insize;
+        total_out += outsize;
+        total_secs += secs / reps;
+        free(inbuf);
+    }
+    if (total_secs > 0)
+        printf("total: %.0f bytes IGZ, %.0f bytes IGC, ratio %.2f, %.1f MB/s\n",
+               total_in, total_out, total_out / total_in, total_out / total_secs / 1e6);
+    fclose(devnull);
+}
+
+void usage()
+{
+    printf("Usage: igz2igc [-f HHMMSS [-t HHMMSS]] infile.IGZ [outfile.IGC]\n");
+    printf("       igz2igc -a infile.IGZ\n");
+    printf("       igz2igc -b N infile.IGZ ...\n");
+    exit(1);
+}
+
+int
 main (argc, argv)
     int    argc;
     char     **argv;
 {
-    char c;
-    FILE *infile, *outfile;
-
-    if (argc < 2) {
-        printf("Usage: igz2igc infile.IGZ [outfile.IGC]\n");
-        exit(1);
-    }
+    FILE *outfile;
+    int mode = OUT_FILE;
+    long s, start_time = 0;
 
     /* allocate buffers */
 
-    if ((inbuf = malloc(BSIZE)) == NULL
-    || (outbuf = malloc(BSIZE)) == NULL) {
+    if ((outbuf = malloc(BSIZE)) == NULL) {
         fprintf (stderr, "error allocating buffers\n");
         exit(1);
     }
+    emptybrecord = EMPTY_B_RECORD;
+
+    while (argc > 1 && argv[1][0] == '-') {
+        if (strcmp(argv[1], "-b") == 0 && argc > 3) {
+            benchmark(atoi(argv[2]), argc-3, argv+3);
+            exit (0);
+        } else if (strcmp(argv[1], "-a") == 0) {
+            mode = OUT_ALARMS;
+            argc -= 1;
+            argv += 1;
+        } else if (strcmp(argv[1], "-f") == 0 && argc > 2) {
+            wfrom = hhmmss(argv[2]);
+            if (wto < 0)
+                wto = wfrom + 300;
+            argc -= 2;
+            argv += 2;
+        } else if (strcmp(argv[1], "-t") == 0 && argc > 2) {
+            wto = hhmmss(argv[2]);
+            argc -= 2;
+            argv += 2;
+        } else {
+            usage();
+        }
+    }
+    if (argc < 2 || (wto >= 0 && wfrom < 0))
+        usage();
 
     /* open files */
 
-    infile = fopen (argv[1], "rb");
-    if (infile == NULL) {
-        fprintf (stderr,
-            "error opening input file '%s'\n", argv[1]);
+    if (! load(argv[1]))
         exit(1);
-    }
 
-    if (argc > 2) {
-        strcpy(outfilename, argv[2]);
+    if (mode == OUT_ALARMS) {
+        outfile = NULL;
     } else {
-        strcpy(outfilename, argv[1]);
-        int fnlen = strlen(outfilename);
-        if (outfilename[fnlen-1] != 'Z') {
-            printf("Usage: igz2igc infile.IGZ [outfile.IGC]\n");
-            exit(1);
+        if (argc > 2) {
+            strcpy(outfilename, argv[2]);
+        } else {
+            strcpy(outfilename, argv[1]);
+            int fnlen = strlen(outfilename);
+            if (outfilename[fnlen-1] != 'Z')
+                usage();
+            outfilename[fnlen-1] = 'C';
         }
-        outfilename[fnlen-1] = 'C';
-    }
 
-    outfile = fopen (outfilename, "wb");
-    if (outfile == NULL) {
-        fprintf (stderr,
-            "error opening output file '%s'\n", argv[2]);
-        exit(1);
+        outfile = fopen (outfilename, "wb");
+        if (outfile == NULL) {
+            fprintf (stderr,
+                "error opening output file '%s'\n", outfilename);
+            exit(1);
+        }
     }
 
-    emptybrecord = EMPTY_B_RECORD;
-    strcpy(brecord, emptybrecord);
-
     /* read input and convert to output */
-    decompress (infile, outbuf, outfile);
+    s = (wfrom >= 0 ? seek_window(&start_time) : 0);
+    start(start_time);
+    decompress (s, outbuf, outfile, mode);
 
-    fclose (infile);
-    fclose (outfile);
+    if (outfile)
+        fclose (outfile);
 
-    printf("output %d lines\n", nlines);
+    if (mode == OUT_FILE)
+        printf("output %ld lines\n", nlines);
     exit (0);
 }
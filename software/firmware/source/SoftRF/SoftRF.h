@@ -178,7 +178,6 @@ typedef struct CONTAINER {
     uint8_t   airborne;
     int8_t    circling;   // 1=right, -1=left
 
-    uint8_t   next;       // for linking into a list
     uint8_t   alert;      /* bitmap of issued voice/tone/ble/... alerts */
 
     int16_t   RelativeHeading;    // for voice and strobe
@@ -390,6 +389,7 @@ void shutdown(int);
 //#define ENABLE_BT_VOICE
 //#define TEST_PAW_ON_NICERF_SV610_FW466
 #define  DO_GDL90_FF_EXT
+#define  GDL90_SKIP_UNCHANGED   /* see GDL90_Export() */
 
 #define LOGGER_IS_ENABLED 0
 
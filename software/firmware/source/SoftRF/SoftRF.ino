@@ -78,6 +78,8 @@
 #include "src/system/SoC.h"
 #include "src/system/OTA.h"
 #include "src/system/Time.h"
+#include "src/system/Sched.h"
+#include "src/system/Prof.h"
 #include "src/driver/LED.h"
 #include "src/driver/GNSS.h"
 #include "src/driver/RF.h"
@@ -114,7 +116,6 @@
 #endif /* LOGGER_IS_ENABLED */
 
 #define DEBUG 0
-#define DEBUG_TIMING 0
 
 #define isTimeToDisplay() (millis() > LEDTimeMarker    + 1000)
 #define isTimeToExport()  (millis() > ExportTimeMarker + 1000)
@@ -399,6 +400,12 @@ Serial.println(settings_used);
     FlightLog_decomp();
 #endif
 
+#if defined(USE_RF_TASK)
+  RF_Task_setup();
+#endif /* USE_RF_TASK */
+
+  Prof_setup();
+
   SetupTimeMarker = millis();
 
 Serial.println("\r\n... setup() done\r\n");
@@ -467,15 +474,15 @@ void normal()
   bool rx_success = false;
   bool tx_success = false;
 
-  Baro_loop();
+  PROF_RUN(PROF_BARO, Baro_loop());
 
 #if defined(ENABLE_AHRS)
   AHRS_loop();
 #endif /* ENABLE_AHRS */
 
-  GNSS_loop();
+  PROF_RUN(PROF_GNSS, GNSS_loop());
 
-  Time_loop();   /* this is where GNSS time data is processed for Legacy protocol */
+  PROF_RUN(PROF_TIME, Time_loop());   /* this is where GNSS time data is processed for Legacy protocol */
 
   static uint32_t initial_time = 0;
 
@@ -639,11 +646,12 @@ gnss.time.hour(), gnss.time.minute(), gnss.time.second());
       // check for newly received data, usually returns false
       // >>> do this here (too?) to ensure no incoming packets are missed
       rx_tried = true;
-      rx_success = RF_Receive();
+      PROF_RUN(PROF_RX, rx_success = RF_Receive());
 if (rx_success) which_rx_try = 1;
       // if received a packet, postpone transmission until next time around the loop().
 
       if (!rx_success && RF_Transmit_Ready() && settings->relay != RELAY_ONLY) {
+          uint32_t prof_t0 = PROF_TICKS();
           // Don't bother with the encode() if can't transmit right now
           size_t s = RF_Encode(&ThisAircraft);  // returns 0 if implausible data
           if (s != 0) {
@@ -652,6 +660,7 @@ if (rx_success) which_rx_try = 1;
               if (RF_Transmit_Happened())
                 tx_success = true;
           }
+          Prof_Since(PROF_TX, prof_t0);
       }
       /* - this only actually transmits when some preset random time is reached */
 
@@ -691,7 +700,16 @@ if (rx_success) which_rx_try = 2;
 #endif
 
     /* process received data - only if we know where we are */
-    if (rx_success && validfix)  ParseData();
+    if (rx_success && validfix)  PROF_RUN(PROF_PARSE, ParseData());
+
+#if defined(USE_RF_TASK)
+    /* packets from the radio task, RF_Receive() above returns false then */
+    if (RF_Task_Active()) {
+      uint32_t prof_t0 = PROF_TICKS();
+      if (ParseQueued(validfix))
+        Prof_Since(PROF_PARSE, prof_t0);
+    }
+#endif /* USE_RF_TASK */
 
   }
 
@@ -701,7 +719,22 @@ if (rx_success) which_rx_try = 2;
 
   if (validfix) {
     /* handle the known traffic - only if we know where we are */
-    Traffic_loop();
+    SCHED_RUN(SCHED_TRAFFIC, Traffic_loop());
+  }
+
+  /* alarm output right behind the traffic, ahead of logging and exports */
+  if (Sched_Start(SCHED_ALARM)) {
+    Buzzer_loop();   /* may sound collision alarms */
+
+    Strobe_loop();
+
+#if !defined(EXCLUDE_VOICE)
+#if defined(ESP32)
+    Voice_loop();   /* may sound collision alarms */
+#endif
+#endif
+
+    Sched_Done(SCHED_ALARM);
   }
 
   if (validfix && settings->logflight != FLIGHT_LOG_NONE) {
@@ -713,20 +746,24 @@ if (rx_success) which_rx_try = 2;
     uint32_t msnow = millis();
 #if defined(ESP32)
     uint32_t ms_since_pps = (msnow - ref_time_ms);
+    // The window straddles the slot change at 300 ms, a log flush must not delay it.
     if (msnow > IGCTimeMarker && ms_since_pps > 270
-            && ms_since_pps < ((settings->debug_flags & DEBUG_SIMULATE)? 800 : 370)) {
+            && ms_since_pps < ((settings->debug_flags & DEBUG_SIMULATE)? 800 : 370)
+            && Sched_Start(SCHED_IGC)) {
       logFlightPosition();
       if (settings->logflight == FLIGHT_LOG_TRAFFIC)
           logCloseTraffic();
       IGCTimeMarker = ref_time_ms + (1000 * (uint32_t) settings->loginterval) + 320;
+      Sched_Done(SCHED_IGC);
     }
 #else
     // on T-Echo don't worry about SPI bus
-    if (msnow > IGCTimeMarker) {
+    if (msnow > IGCTimeMarker && Sched_Start(SCHED_IGC)) {
       logFlightPosition();
       if (settings->logflight == FLIGHT_LOG_TRAFFIC)
           logCloseTraffic();
       IGCTimeMarker = ref_time_ms + (1000 * (uint32_t) settings->loginterval) + 320;
+      Sched_Done(SCHED_IGC);
     }
 #endif
   }
@@ -740,28 +777,28 @@ if (rx_success) which_rx_try = 2;
     LEDTimeMarker = millis();
   }
 
-  Buzzer_loop();   /* may sound collision alarms */
-
-  Strobe_loop();
-
-#if !defined(EXCLUDE_VOICE)
-#if defined(ESP32)
-  Voice_loop();   /* may sound collision alarms */
-#endif
-#endif
-
-  if (isTimeToExport()) {
-    NMEA_Export();
-    GDL90_Export();
-
-    if (validfix) {
-      D1090_Export();
+  /* once a second, one export per pass so no single pass runs long */
+  if (Sched_Start(SCHED_EXPORT)) {
+    switch (Sched_Step(SCHED_EXPORT))
+    {
+    case 0:
+      NMEA_Export();
+      break;
+    case 1:
+      GDL90_Export();
+      break;
+    default:
+      if (validfix) {
+        D1090_Export();
+      }
+      ExportTimeMarker = millis();
+      break;
     }
-    ExportTimeMarker = millis();
+    Sched_Done(SCHED_EXPORT);
   }
 
   // Handle Air Connect
-  NMEA_loop();
+  PROF_RUN(PROF_NMEA_LOOP, NMEA_loop());
 
   //ClearExpired();    // now done in Traffic_loop() instead
 }
@@ -878,13 +915,6 @@ unsigned long TxPosUpdMarker = 0;
 void txrx_test()
 {
   bool success = false;
-#if DEBUG_TIMING
-  unsigned long baro_start_ms, baro_end_ms;
-  unsigned long tx_start_ms, tx_end_ms, rx_start_ms, rx_end_ms;
-  unsigned long parse_start_ms, parse_end_ms, led_start_ms, led_end_ms;
-  unsigned long export_start_ms, export_end_ms;
-  unsigned long oled_start_ms, oled_end_ms;
-#endif
   ThisAircraft.timestamp = OurTime;    // now();
 
   if (TxPosUpdMarker == 0 || (millis() - TxPosUpdMarker) > 4000 ) {
@@ -898,38 +928,16 @@ void txrx_test()
   ThisAircraft.speed = TXRX_TEST_SPEED;
   ThisAircraft.vs = TXRX_TEST_VS;
 
-#if DEBUG_TIMING
-  baro_start_ms = millis();
-#endif
-  Baro_loop();
-#if DEBUG_TIMING
-  baro_end_ms = millis();
-#endif
+  PROF_RUN(PROF_BARO, Baro_loop());
 
 #if defined(ENABLE_AHRS)
   AHRS_loop();
 #endif /* ENABLE_AHRS */
 
-#if DEBUG_TIMING
-  tx_start_ms = millis();
-#endif
-  RF_Transmit(RF_Encode(&ThisAircraft));
-#if DEBUG_TIMING
-  tx_end_ms = millis();
-  rx_start_ms = millis();
-#endif
-  success = RF_Receive();
-#if DEBUG_TIMING
-  rx_end_ms = millis();
-#endif
+  PROF_RUN(PROF_TX, RF_Transmit(RF_Encode(&ThisAircraft)));
+  PROF_RUN(PROF_RX, success = RF_Receive());
 
-#if DEBUG_TIMING
-  parse_start_ms = millis();
-#endif
-  if (success) ParseData();
-#if DEBUG_TIMING
-  parse_end_ms = millis();
-#endif
+  if (success) PROF_RUN(PROF_PARSE, ParseData());
 
 #if defined(ENABLE_TTN)
   TTN_loop();
@@ -937,16 +945,10 @@ void txrx_test()
 
   Traffic_loop();
 
-#if DEBUG_TIMING
-  led_start_ms = millis();
-#endif
   if (isTimeToDisplay()) {
-    LED_DisplayTraffic();
+    PROF_RUN(PROF_LED, LED_DisplayTraffic());
     LEDTimeMarker = millis();
   }
-#if DEBUG_TIMING
-  led_end_ms = millis();
-#endif
 
   Buzzer_loop();
 
@@ -958,77 +960,20 @@ void txrx_test()
 #endif
 #endif
 
-#if DEBUG_TIMING
-  export_start_ms = millis();
-#endif
   if (isTimeToExport()) {
 #if defined(USE_NMEALIB)
     NMEA_Position();
 #endif
-    NMEA_Export();
-    GDL90_Export();
-    D1090_Export();
+    PROF_RUN(PROF_EXP_NMEA, NMEA_Export());
+    PROF_RUN(PROF_EXP_GDL90, GDL90_Export());
+    PROF_RUN(PROF_EXP_D1090, D1090_Export());
     ExportTimeMarker = millis();
   }
-#if DEBUG_TIMING
-  export_end_ms = millis();
-#endif
 
-#if DEBUG_TIMING
-  oled_start_ms = millis();
-#endif
 //  SoC->Display_loop();
-#if DEBUG_TIMING
-  oled_end_ms = millis();
-#endif
-
-#if DEBUG_TIMING
-  if (baro_start_ms - baro_end_ms) {
-    Serial.print(F("Baro start: "));
-    Serial.print(baro_start_ms);
-    Serial.print(F(" Baro stop: "));
-    Serial.println(baro_end_ms);
-  }
-  if (tx_end_ms - tx_start_ms) {
-    Serial.print(F("TX start: "));
-    Serial.print(tx_start_ms);
-    Serial.print(F(" TX stop: "));
-    Serial.println(tx_end_ms);
-  }
-  if (rx_end_ms - rx_start_ms) {
-    Serial.print(F("RX start: "));
-    Serial.print(rx_start_ms);
-    Serial.print(F(" RX stop: "));
-    Serial.println(rx_end_ms);
-  }
-  if (parse_end_ms - parse_start_ms) {
-    Serial.print(F("Parse start: "));
-    Serial.print(parse_start_ms);
-    Serial.print(F(" Parse stop: "));
-    Serial.println(parse_end_ms);
-  }
-  if (led_end_ms - led_start_ms) {
-    Serial.print(F("LED start: "));
-    Serial.print(led_start_ms);
-    Serial.print(F(" LED stop: "));
-    Serial.println(led_end_ms);
-  }
-  if (export_end_ms - export_start_ms) {
-    Serial.print(F("Export start: "));
-    Serial.print(export_start_ms);
-    Serial.print(F(" Export stop: "));
-    Serial.println(export_end_ms);
-  }
-  if (oled_end_ms - oled_start_ms) {
-    Serial.print(F("OLED start: "));
-    Serial.print(oled_start_ms);
-    Serial.print(F(" OLED stop: "));
-    Serial.println(oled_end_ms);
-  }
-#endif
 
   // Handle Air Connect
-  NMEA_loop();
+  PROF_RUN(PROF_NMEA_LOOP, NMEA_loop());
 
   ClearExpired();
 }
@@ -1050,14 +995,19 @@ void gpsbridge()
 
 void loop()
 {
+  uint32_t prof_t0 = PROF_TICKS();
+
+  // How late the radio is getting the loop back
+  Sched_loop();
+
   // Do common RF stuff first
   if (settings->mode != SOFTRF_MODE_GPSBRIDGE)
-    RF_loop();
+    SCHED_RUN(SCHED_RF, RF_loop());
 
   switch (settings->mode)
   {
   case SOFTRF_MODE_NORMAL:
-    normal();
+    PROF_RUN(PROF_NORMAL, normal());
     break;
 #if !defined(EXCLUDE_TEST_MODE)
   case SOFTRF_MODE_TXRX_TEST:
@@ -1083,44 +1033,50 @@ void loop()
     gpsbridge();
     break;
   default:
-    normal();
+    PROF_RUN(PROF_NORMAL, normal());
     break;
   }
 
+  // The rest waits while the next RF slot change or transmission is close,
+  // see Sched.h
+
   // Show status info on tiny OLED display
-  SoC->Display_loop();
+  SCHED_RUN(SCHED_DISPLAY, SoC->Display_loop());
 
   // battery status LED
-  LED_loop();
+  SCHED_RUN(SCHED_LED, LED_loop());
 
   // Handle DNS
-  WiFi_loop();
+  SCHED_RUN(SCHED_WIFI, WiFi_loop());
 
   // Handle Web
-  Web_loop();
+  SCHED_RUN(SCHED_WEB, Web_loop());
 
   // Handle OTA update.
-  OTA_loop();
+  SCHED_RUN(SCHED_OTA, OTA_loop());
 
 #if LOGGER_IS_ENABLED
-  Logger_loop();
+  SCHED_RUN(SCHED_LOGGER, Logger_loop());
 #endif /* LOGGER_IS_ENABLED */
 
-  SoC->loop();
+  PROF_RUN(PROF_SOC, SoC->loop());
 
   if (SoC->Bluetooth_ops) {
-    SoC->Bluetooth_ops->loop();
+    PROF_RUN(PROF_BT, SoC->Bluetooth_ops->loop());
   }
 
-  if (SoC->USB_ops) {
-    SoC->USB_ops->loop();
-  }
-
-  if (SoC->UART_ops) {
-     SoC->UART_ops->loop();
+  if (SoC->USB_ops || SoC->UART_ops) {
+    uint32_t prof_io = PROF_TICKS();
+    if (SoC->USB_ops) {
+      SoC->USB_ops->loop();
+    }
+    if (SoC->UART_ops) {
+       SoC->UART_ops->loop();
+    }
+    Prof_Since(PROF_IO, prof_io);
   }
 
-  Battery_loop();
+  SCHED_RUN(SCHED_BATTERY, Battery_loop());
 
   SoC->Button_loop();
 
@@ -1131,5 +1087,12 @@ void loop()
   }
 #endif /* TAKE_CARE_OF_MILLIS_ROLLOVER */
 
+  Prof_loop();
+
+  // Send out the NMEA sentences gathered during this pass
+  PROF_RUN(PROF_FLUSH, NMEA_Flush());
+
+  Prof_Since(PROF_LOOP, prof_t0);
+
   yield();
 }
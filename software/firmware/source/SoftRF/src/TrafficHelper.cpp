@@ -23,6 +23,7 @@
 #include "../SoftRF.h"
 #include "system/SoC.h"
 #include "system/Time.h"
+#include "system/Prof.h"
 #include "TrafficHelper.h"
 #include "driver/Settings.h"
 #include "driver/RF.h"
@@ -125,9 +126,354 @@ ufo_t fo; // EmptyFO;                                             // fewer field
 void EmptyContainer(container_t *p) { memset(p, 0, sizeof(CONTAINER)); }
 void EmptyFO(ufo_t *p) { memset(p, 0, sizeof(UFO)); }
 
+/*
+ * Index into Container[], so that per-packet work does not grow with
+ * MAX_TRACKING_OBJECTS:
+ *   - an open-addressed (linear probing) hash table maps addr -> slot,
+ *   - empty slots are kept on a free list,
+ *   - occupied slots are kept in a queue ordered by last update,
+ *     so the head of the queue is the entry that expires first.
+ * The free list and the queue share the link arrays, a slot is on one or the other.
+ * Slots must only be filled and emptied via Traffic_Claim() and Traffic_Release().
+ *
+ * Two orderings of the occupied slots are also kept up to date: Traffic_Claim()
+ * and Traffic_Release() add and remove the slot, and the caller that fills
+ * a slot calls Traffic_Rank() whenever its distances or alarm level change:
+ *   - a max-heap of the slots that may be evicted when the table is full
+ *     (no alarm, not followed, not relayed), keyed on adjusted distance,
+ *   - traffic_by_dist[], all occupied slots sorted by (plain) distance.
+ */
+
+#define TRAFFIC_NONE  MAX_TRACKING_OBJECTS
+
+static traffic_ndx_t traffic_hash[TRAFFIC_HASH_SIZE];
+static uint32_t      traffic_key[MAX_TRACKING_OBJECTS];   /* addr the slot is hashed under */
+static traffic_ndx_t traffic_prev[MAX_TRACKING_OBJECTS];
+static traffic_ndx_t traffic_next[MAX_TRACKING_OBJECTS];
+static traffic_ndx_t traffic_head = TRAFFIC_NONE;         /* oldest occupied slot */
+static traffic_ndx_t traffic_tail = TRAFFIC_NONE;         /* newest occupied slot */
+static traffic_ndx_t traffic_free = TRAFFIC_NONE;         /* first empty slot */
+
+static traffic_ndx_t traffic_heap[MAX_TRACKING_OBJECTS];     /* farthest evictable on top */
+static traffic_ndx_t traffic_heap_pos[MAX_TRACKING_OBJECTS]; /* slot -> heap position */
+static float         traffic_heap_key[MAX_TRACKING_OBJECTS]; /* by slot */
+static int           traffic_heap_n = 0;
+
+traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
+int traffic_by_dist_n = 0;
+static traffic_ndx_t traffic_dist_pos[MAX_TRACKING_OBJECTS]; /* slot -> traffic_by_dist[] position */
+
+static inline uint32_t traffic_hash_of(uint32_t addr)
+{
+    /* Fibonacci hashing, keeps the top bits */
+    return ((uint32_t) (addr * (uint32_t) 2654435761UL)) >> (32 - TRAFFIC_HASH_BITS);
+}
+
+static void traffic_hash_insert(int i)
+{
+    uint32_t h = traffic_hash_of(traffic_key[i]);
+    while (traffic_hash[h] != TRAFFIC_NONE)
+        h = (h + 1) & (TRAFFIC_HASH_SIZE - 1);
+    traffic_hash[h] = i;
+}
+
+static void traffic_hash_remove(int i)
+{
+    uint32_t h = traffic_hash_of(traffic_key[i]);
+    while (traffic_hash[h] != i) {
+        if (traffic_hash[h] == TRAFFIC_NONE)
+            return;                        /* not hashed */
+        h = (h + 1) & (TRAFFIC_HASH_SIZE - 1);
+    }
+    traffic_hash[h] = TRAFFIC_NONE;
+    /* shift back any following entries that can no longer be reached (no tombstones) */
+    uint32_t j = h;
+    for (;;) {
+        j = (j + 1) & (TRAFFIC_HASH_SIZE - 1);
+        int n = traffic_hash[j];
+        if (n == TRAFFIC_NONE)
+            break;
+        uint32_t k = traffic_hash_of(traffic_key[n]);
+        bool stays = (h <= j) ? (h < k && k <= j) : (h < k || k <= j);
+        if (! stays) {
+            traffic_hash[h] = n;
+            traffic_hash[j] = TRAFFIC_NONE;
+            h = j;
+        }
+    }
+}
+
+/* unlink from whichever list (queue or free list) the slot is on */
+static void traffic_unlink(int i)
+{
+    int p = traffic_prev[i];
+    int n = traffic_next[i];
+    if (p != TRAFFIC_NONE)
+        traffic_next[p] = n;
+    else if (traffic_head == i)
+        traffic_head = n;
+    else
+        traffic_free = n;
+    if (n != TRAFFIC_NONE)
+        traffic_prev[n] = p;
+    else if (traffic_tail == i)
+        traffic_tail = p;
+}
+
+static void traffic_enqueue(int i)
+{
+    traffic_prev[i] = traffic_tail;
+    traffic_next[i] = TRAFFIC_NONE;
+    if (traffic_tail != TRAFFIC_NONE)
+        traffic_next[traffic_tail] = i;
+    else
+        traffic_head = i;
+    traffic_tail = i;
+}
+
+static void traffic_push_free(int i)
+{
+    traffic_prev[i] = TRAFFIC_NONE;
+    traffic_next[i] = traffic_free;
+    if (traffic_free != TRAFFIC_NONE)
+        traffic_prev[traffic_free] = i;
+    traffic_free = i;
+}
+
+static void traffic_heap_place(int pos, int i)
+{
+    traffic_heap[pos] = i;
+    traffic_heap_pos[i] = pos;
+}
+
+static void traffic_heap_sift(int pos)
+{
+    int i = traffic_heap[pos];
+    float key = traffic_heap_key[i];
+    while (pos > 0) {                          /* up */
+        int parent = (pos - 1) >> 1;
+        if (traffic_heap_key[traffic_heap[parent]] >= key)
+            break;
+        traffic_heap_place(pos, traffic_heap[parent]);
+        pos = parent;
+    }
+    for (;;) {                                 /* down */
+        int child = 2 * pos + 1;
+        if (child >= traffic_heap_n)
+            break;
+        if (child + 1 < traffic_heap_n
+             && traffic_heap_key[traffic_heap[child+1]] > traffic_heap_key[traffic_heap[child]])
+            ++child;
+        if (traffic_heap_key[traffic_heap[child]] <= key)
+            break;
+        traffic_heap_place(pos, traffic_heap[child]);
+        pos = child;
+    }
+    traffic_heap_place(pos, i);
+}
+
+static void traffic_heap_remove(int i)
+{
+    int pos = traffic_heap_pos[i];
+    if (pos == TRAFFIC_NONE)
+        return;
+    traffic_heap_pos[i] = TRAFFIC_NONE;
+    int last = traffic_heap[--traffic_heap_n];
+    if (last != i) {
+        traffic_heap_place(pos, last);
+        traffic_heap_sift(pos);
+    }
+}
+
+static bool traffic_evictable(int i)
+{
+    container_t *cip = &Container[i];
+    return (cip->alarm_level == ALARM_LEVEL_NONE
+             && cip->addr != settings->follow_id && ! cip->relayed);
+}
+
+static void traffic_heap_update(int i)
+{
+    container_t *cip = &Container[i];
+    if (! traffic_evictable(i)) {
+        traffic_heap_remove(i);                /* not to be evicted */
+        return;
+    }
+    float adj_distance = cip->adj_distance;
+    if (adj_distance < cip->distance)
+        adj_distance = cip->distance;
+    traffic_heap_key[i] = adj_distance;
+    if (traffic_heap_pos[i] == TRAFFIC_NONE)
+        traffic_heap_place(traffic_heap_n++, i);
+    traffic_heap_sift(traffic_heap_pos[i]);
+}
+
+/* move slot i within traffic_by_dist[] - distances change little between updates */
+static void traffic_dist_sort(int i)
+{
+    int pos = traffic_dist_pos[i];
+    float distance = Container[i].distance;
+    while (pos > 0 && traffic_by_dist[pos-1].distance > distance) {
+        traffic_by_dist[pos] = traffic_by_dist[pos-1];
+        traffic_dist_pos[traffic_by_dist[pos].fop - Container] = pos;
+        --pos;
+    }
+    while (pos+1 < traffic_by_dist_n && traffic_by_dist[pos+1].distance < distance) {
+        traffic_by_dist[pos] = traffic_by_dist[pos+1];
+        traffic_dist_pos[traffic_by_dist[pos].fop - Container] = pos;
+        ++pos;
+    }
+    traffic_by_dist[pos].fop = &Container[i];
+    traffic_by_dist[pos].distance = distance;
+    traffic_dist_pos[i] = pos;
+}
+
+static void traffic_dist_insert(int i)
+{
+    int pos = traffic_by_dist_n++;
+    traffic_by_dist[pos].fop = &Container[i];
+    traffic_by_dist[pos].distance = Container[i].distance;
+    traffic_dist_pos[i] = pos;
+    traffic_dist_sort(i);
+}
+
+static void traffic_dist_remove(int i)
+{
+    int pos = traffic_dist_pos[i];
+    if (pos == TRAFFIC_NONE)
+        return;
+    traffic_dist_pos[i] = TRAFFIC_NONE;
+    for (--traffic_by_dist_n; pos < traffic_by_dist_n; pos++) {
+        traffic_by_dist[pos] = traffic_by_dist[pos+1];
+        traffic_dist_pos[traffic_by_dist[pos].fop - Container] = pos;
+    }
+}
+
+/* returns the slot tracking addr, or MAX_TRACKING_OBJECTS if not found */
+int Traffic_Find(uint32_t addr)
+{
+    if (addr == 0)
+        return MAX_TRACKING_OBJECTS;
+    uint32_t h = traffic_hash_of(addr);
+    for (;;) {
+        int i = traffic_hash[h];
+        if (i == TRAFFIC_NONE)
+            return MAX_TRACKING_OBJECTS;
+        if (traffic_key[i] == addr)
+            return i;
+        h = (h + 1) & (TRAFFIC_HASH_SIZE - 1);
+    }
+}
+
+/* an empty slot, else an expired one, else MAX_TRACKING_OBJECTS */
+int Traffic_Vacant()
+{
+    if (traffic_free != TRAFFIC_NONE)
+        return traffic_free;
+    /* the queue is in the order of the updates, usually the head is the one */
+    /* - but the timestamp from a JSON feed may be older than the update     */
+    for (int i = traffic_head; i != TRAFFIC_NONE; i = traffic_next[i]) {
+        if (OurTime > Container[i].timestamp + ENTRY_EXPIRATION_TIME)
+            return i;
+    }
+    return MAX_TRACKING_OBJECTS;
+}
+
+/* the farthest slot that may be evicted, or MAX_TRACKING_OBJECTS if none */
+int Traffic_Farthest(float *adj_distance)
+{
+    /* settings->follow_id may have changed since the slot was ranked */
+    while (traffic_heap_n > 0 && ! traffic_evictable(traffic_heap[0]))
+        traffic_heap_remove(traffic_heap[0]);
+    if (traffic_heap_n == 0)
+        return MAX_TRACKING_OBJECTS;
+    int i = traffic_heap[0];
+    if (traffic_heap_key[i] <= 0)
+        return MAX_TRACKING_OBJECTS;
+    *adj_distance = traffic_heap_key[i];
+    return i;
+}
+
+/* walk the occupied slots, oldest first */
+int Traffic_First() { return traffic_head; }
+int Traffic_Next(int i) { return traffic_next[i]; }
+
+/* (re)use slot i - empty or occupied - for a new object */
+void Traffic_Claim(int i, uint32_t addr)
+{
+    if (traffic_key[i] != 0) {
+        traffic_hash_remove(i);
+        traffic_heap_remove(i);
+        traffic_dist_remove(i);
+    }
+    traffic_unlink(i);
+    EmptyContainer(&Container[i]);
+    Container[i].addr = addr;
+    traffic_key[i] = addr;
+    traffic_hash_insert(i);
+    traffic_enqueue(i);
+    traffic_dist_insert(i);
+    traffic_heap_update(i);
+}
+
+/* the distances or alarm level of slot i changed, re-sort it */
+void Traffic_Rank(int i)
+{
+    if (traffic_key[i] == 0)
+        return;
+    traffic_heap_update(i);
+    traffic_dist_sort(i);
+}
+
+/* the timestamp of slot i was updated, move it to the end of the queue */
+void Traffic_Touch(int i)
+{
+    if (traffic_tail == i || traffic_key[i] == 0)
+        return;
+    traffic_unlink(i);
+    traffic_enqueue(i);
+}
+
+void Traffic_Release(int i)
+{
+    if (traffic_key[i] == 0)
+        return;
+    traffic_hash_remove(i);
+    traffic_heap_remove(i);
+    traffic_dist_remove(i);
+    traffic_unlink(i);
+    traffic_key[i] = 0;
+    Container[i].addr = 0;
+    traffic_push_free(i);
+}
+
+/* rebuild the index from Container[] */
+void Traffic_Reindex()
+{
+    int i;
+    for (i=0; i < TRAFFIC_HASH_SIZE; i++)
+        traffic_hash[i] = TRAFFIC_NONE;
+    traffic_head = traffic_tail = traffic_free = TRAFFIC_NONE;
+    traffic_heap_n = traffic_by_dist_n = 0;
+    for (i=MAX_TRACKING_OBJECTS-1; i >= 0; i--) {
+        uint32_t addr = Container[i].addr;
+        traffic_heap_pos[i] = traffic_dist_pos[i] = TRAFFIC_NONE;
+        if (addr != 0 && Traffic_Find(addr) == MAX_TRACKING_OBJECTS) {
+            traffic_key[i] = addr;
+            traffic_hash_insert(i);
+            traffic_enqueue(i);
+            traffic_dist_insert(i);
+            traffic_heap_update(i);
+        } else {
+            traffic_key[i] = 0;
+            Container[i].addr = 0;
+            traffic_push_free(i);
+        }
+    }
+}
+
 char fo_callsign[10];
 uint8_t fo_raw[34];
-traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
 int max_alarm_level = ALARM_LEVEL_NONE;
 int8_t maxrssi;
 uint8_t adsb_acfts;
@@ -451,6 +797,49 @@ static int8_t Alarm_Vector(container_t *this_aircraft, container_t *fop)
 }
 
 
+/*
+ * For Alarm_Latest(): the relative positions at the 1-second time points
+ * are laid out as arrays, and the closest one found in a single pass.
+ */
+
+#define LATEST_STEPS  18   /* seconds projected */
+
+/* index into the 6 projected time points (+3,6,9,12,15,18 sec) for each second, */
+/* the last point is extrapolated one more second for the time-offset case       */
+static const uint8_t latest_sample[LATEST_STEPS+1] =
+    { 0,0,0, 1,1,1, 2,2,2, 3,3,3, 4,4,4, 5,5,5, 5 };
+
+/* returns the first time point with the smallest sqdist below *minsqdist, or -1 */
+static int latest_min_sqdist(const int *posx, const int *posy, int sqdz, int *minsqdist)
+{
+  int mintime = -1;
+  int min = *minsqdist;
+  for (int t=0; t<LATEST_STEPS; t++) {
+    int sqdist = posx[t]*posx[t] + posy[t]*posy[t] + sqdz;
+    if (sqdist < min) {
+      min = sqdist;
+      mintime = t;
+    }
+  }
+  *minsqdist = min;
+  return mintime;
+}
+
+/*
+ * Relative motion projected for Alarm_Latest() and Alarm_CPA(),
+ * integer math, in quarter-meters and quarter-meters per second.
+ */
+typedef struct {
+  int  dx, dy;                /* relative position now */
+  int  thisvx[6], thisvy[6];  /* velocities at the 6 projected time points */
+  int  thatvx[6], thatvy[6];
+  int  i, j;                  /* time offset into latest_sample[], that and this */
+  int  sqdz;                  /* adjusted vertical separation, squared */
+  int  cursqdist;             /* current 3D distance, squared */
+  bool gaggling;
+  bool towing;
+} latest_t;
+
 /*
  * VERY EXPERIMENTAL
  *
@@ -462,26 +851,38 @@ static int8_t Alarm_Vector(container_t *this_aircraft, container_t *fop)
  * The new 2024 protocol sends speed, direction, and turn rate explicitly instead.
  * Either way, this algorithm assumes that circling aircraft will keep circling
  * for the relevant time period (the next 19 seconds).
+ *
+ * Returns false, with the alarm level in *rval, if the projection is
+ * not needed or another method is more suitable for this target.
  */
-static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
+static bool latest_project(container_t *this_aircraft, container_t *fop,
+                           latest_t *lp, int8_t *rval)
 {
+  *rval = ALARM_LEVEL_NONE;
+
   if (fop->distance > 2*ALARM_ZONE_CLOSE) {    // 3km
-    return ALARM_LEVEL_NONE;
+    return false;
     /* save CPU cycles */
   }
 
-  if (fop->tx_type <= TX_TYPE_S)
-    return Alarm_Distance(this_aircraft, fop);    // non-directional target
+  if (fop->tx_type <= TX_TYPE_S) {
+    *rval = Alarm_Distance(this_aircraft, fop);    // non-directional target
+    return false;
+  }
 
-  if (fop->speed == 0)
-    return Alarm_Distance(this_aircraft, fop);    // ADS-B target with no velocity message yet
+  if (fop->speed == 0) {
+    *rval = Alarm_Distance(this_aircraft, fop);    // ADS-B target with no velocity message yet
+    return false;
+  }
 
-  if (fop->tx_type == TX_TYPE_TISB || fop->relayed)
-    return (Alarm_Vector(this_aircraft, fop));    // data not timely enough for this algo
+  if (fop->tx_type == TX_TYPE_TISB || fop->relayed) {
+    *rval = Alarm_Vector(this_aircraft, fop);      // data not timely enough for this algo
+    return false;
+  }
 
   float v2 = fop->speed + this_aircraft->speed;
   if (fop->distance > v2 * (ALARM_TIME_LOW * _GPS_MPS_PER_KNOT)) {
-    return ALARM_LEVEL_NONE;
+    return false;
     /* save CPU cycles */
   }
 
@@ -489,7 +890,7 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   int dz = ((vv * vv) >> 8);
   dz = (int)fabs(fop->adj_alt_diff) - dz;   // rough accounting for potential zoom-up
   if (dz > VERTICAL_SEPARATION) {
-    return ALARM_LEVEL_NONE;
+    return false;
     /* save CPU cycles */
   }
 
@@ -497,7 +898,8 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   if (fop->protocol == RF_PROTOCOL_LATEST &&
          fabs(this_aircraft->turnrate) < 2.0 && fabs(fop->turnrate) < 2.0) {
     /* neither aircraft is turning */
-    return (Alarm_Vector(this_aircraft, fop));
+    *rval = Alarm_Vector(this_aircraft, fop);
+    return false;
     // hopefully this takes care of aerotows?
     // >>> or try and use this algorithm anyway?
   }
@@ -514,13 +916,14 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   if (fop->protocol != RF_PROTOCOL_LATEST &&
          fabs(this_aircraft->turnrate) < 2.0 && fabs(fop->turnrate) < 2.0) {
     /* neither aircraft is turning */
-    return (Alarm_Vector(this_aircraft, fop));
+    *rval = Alarm_Vector(this_aircraft, fop);
+    return false;
     // hopefully this takes care of aerotows?
     // >>> or try and use this algorithm anyway?
   }
 
   // flag if both aircraft are circling in the same direction
-  bool gaggling = (abs(this_aircraft->circling + fop->circling) == 2);
+  lp->gaggling = (abs(this_aircraft->circling + fop->circling) == 2);
 
   // flag if possibly a tow operation
   bool towing = (this_aircraft->aircraft_type==AIRCRAFT_TYPE_TOWPLANE && fop->aircraft_type==AIRCRAFT_TYPE_GLIDER)
@@ -532,6 +935,7 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
     if (fabs(this_aircraft->speed - fop->speed) > 15.0)       towing = false;   // knots
   }
   // actually diverted typical towing (both non-turning) to vector method above
+  lp->towing = towing;
 
   /* Use integer math for computational speed */
 
@@ -575,7 +979,7 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   if (adjdz < 0)
     adjdz = 0;
   if (adjdz > 60)                // meters - cannot reach the 120m 3D distance threshold below
-    return (ALARM_LEVEL_NONE);
+    return false;
 
   /* may want to adjust dz over time? */
   /* - but is relative vs representative of future? */
@@ -584,72 +988,38 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   /* Project relative position second by second into the future */
   /* Time points in our ns/ew array of airspeeds are at +3,6,9,12,15,18 sec */
 
-  /* prepare second-by-second velocity vectors */
-  static int thisvx[20];
-  static int thisvy[20];
-  static int thatvx[20];
-  static int thatvy[20];
-  //int vx, vy;
-  int *px = thisvx;
-  int *py = thisvy;
+  /* velocity vectors at the 6 projected time points, quarter-meters per second */
+  int *thisvx = lp->thisvx, *thisvy = lp->thisvy;
+  int *thatvx = lp->thatvx, *thatvy = lp->thatvy;
   /* considered interpolating between the 4 points, but does not seem useful */
   int i, j;
-  if (zoom && dz > 15) {
-      for (i=0; i<6; i++) {
-         int32_t v;
-         v = this_aircraft->air_ew[i];
-         v *= factor;
-         vx = v >> 6;                   // for the 64x scaling of factor
-         v = this_aircraft->air_ns[i];
-         v *= factor;
-         vy = v >> 6;
-         for (j=0; j<3; j++) {
-           *px++ = vx;
-           *py++ = vy;    
-         }
-      }
-  } else {
-    for (i=0; i<6; i++) {
-      vx = this_aircraft->air_ew[i];  /* quarter-meters per second */
-      vy = this_aircraft->air_ns[i];
-      for (j=0; j<3; j++) {
-        *px++ = vx;
-        *py++ = vy;    
-      }
-    }
-  }
-  *px = vx;  /* extrapolate one more second */
-  *py = vy;
-
-  /* same for the other aircraft */
-  px = thatvx;
-  py = thatvy;
-  if (zoom && dz < -15) {
-    for (i=0; i<6; i++) {
-       int32_t v;
-       v = fop->air_ew[i];
-       v *= factor;
-       vx = v >> 6;
-       v = fop->air_ns[i];
-       v *= factor;
-       vy = v >> 6;
-       for (j=0; j<3; j++) {
-         *px++ = vx;
-         *py++ = vy;    
-       }
+  for (i=0; i<6; i++) {
+    if (zoom && dz > 15) {
+      int32_t v;
+      v = this_aircraft->air_ew[i];
+      v *= factor;
+      thisvx[i] = v >> 6;                 // for the 64x scaling of factor
+      v = this_aircraft->air_ns[i];
+      v *= factor;
+      thisvy[i] = v >> 6;
+    } else {
+      thisvx[i] = this_aircraft->air_ew[i];
+      thisvy[i] = this_aircraft->air_ns[i];
     }
-  } else {
-    for (i=0; i<6; i++) {
-      vx = fop->air_ew[i];
-      vy = fop->air_ns[i];
-      for (j=0; j<3; j++) {
-        *px++ = vx;
-        *py++ = vy;    
-      }
+    /* same for the other aircraft */
+    if (zoom && dz < -15) {
+      int32_t v;
+      v = fop->air_ew[i];
+      v *= factor;
+      thatvx[i] = v >> 6;
+      v = fop->air_ns[i];
+      v *= factor;
+      thatvy[i] = v >> 6;
+    } else {
+      thatvx[i] = fop->air_ew[i];
+      thatvy[i] = fop->air_ns[i];
     }
   }
-  *px = vx;
-  *py = vy;    
 
   /* 2D position of fop relative to this aircraft */
   /* - computed in Traffic_Update() */
@@ -657,12 +1027,7 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   int dx = fop->dx << 2;
   int dy = fop->dy << 2;
 
-  /* project paths over time and find minimum 3D distance */
-  int minsqdist = 200*200*4*4;
-  int mintime = ALARM_TIME_CLOSE;
-  int vxmin = 0;
-  int vymin = 0;
-  /* if projections are from different times, offset the arrays */
+  /* if projections are from different times, offset the time points */
   if (fop->projtime_ms > this_aircraft->projtime_ms + 500) {
     /* this_aircraft projection is older, shift by 1 second */
     i = 0;
@@ -679,38 +1044,30 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
     i = 0;
     j = 0;
   }
-  int t;
   adjdz <<= 3;
   // <<2 for units: convert to quarter-meters, and
   // another <<1 to consider vertical separation 2x better than horizontal distance
-  int sqdz = adjdz * adjdz;
-  //int cursqdist = dx*dx + dy*dy;        // previous version
-  int cursqdist = dx*dx + dy*dy + sqdz;   // causes more alarms
-
-  for (t=0; t<18; t++) {  /* loop over the 1-second time points prepared */
-    vx = thatvx[i] - thisvx[j];   /* relative velocity */
-    vy = thatvy[i] - thisvy[j];
-    dx += vx;   /* change in relative position over this second */
-    dy += vy;
-    /* dz += vz; */
-    int sqdist = dx*dx + dy*dy + sqdz;
-    if (sqdist < minsqdist) {
-      minsqdist = sqdist;
-      vxmin = vx;
-      vymin = vy;
-      mintime = t;
-    }
-    ++i;
-    ++j;
-  }
-
-  if (cursqdist <= minsqdist || mintime == 0) {
-      // if not getting any closer than current situation
-      //     then don't sound an alarm
-      return ALARM_LEVEL_NONE;
-  }
+  lp->sqdz = adjdz * adjdz;
+  //lp->cursqdist = dx*dx + dy*dy;                // previous version
+  lp->cursqdist = dx*dx + dy*dy + lp->sqdz;       // causes more alarms
+  lp->dx = dx;
+  lp->dy = dy;
+  lp->i = i;
+  lp->j = j;
+
+  return true;
+}
 
+/*
+ * Alarm level from the projected minimum 3D distance (squared, quarter-meters),
+ * the time it is reached (seconds after the first) and the relative velocity then.
+ */
+static int8_t latest_level(container_t *this_aircraft, container_t *fop, latest_t *lp,
+                           int minsqdist, int mintime, int vxmin, int vymin)
+{
   int8_t rval = ALARM_LEVEL_NONE;
+  bool gaggling = lp->gaggling;
+  bool towing = lp->towing;
 
   /* try and set thresholds for alarms with gaggles - and tows - in mind */
   /* squeezed between size of thermal, length of tow rope, and accuracy of prediction */
@@ -775,6 +1132,122 @@ static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
   return rval;
 }
 
+static int8_t Alarm_Latest(container_t *this_aircraft, container_t *fop)
+{
+  latest_t lp;
+  int8_t rval;
+
+  if (! latest_project(this_aircraft, fop, &lp, &rval))
+    return rval;
+
+  /* project relative position second by second into the future */
+  int posx[LATEST_STEPS];      /* relative position after t+1 seconds */
+  int posy[LATEST_STEPS];
+  int dx = lp.dx;
+  int dy = lp.dy;
+  int t;
+  for (t=0; t<LATEST_STEPS; t++) {
+    dx += lp.thatvx[latest_sample[lp.i+t]] - lp.thisvx[latest_sample[lp.j+t]];
+    dy += lp.thatvy[latest_sample[lp.i+t]] - lp.thisvy[latest_sample[lp.j+t]];
+    /* dz += vz; */
+    posx[t] = dx;
+    posy[t] = dy;
+  }
+
+  /* find minimum 3D distance */
+  int minsqdist = 200*200*4*4;
+  int mintime = ALARM_TIME_CLOSE;
+  int vxmin = 0;
+  int vymin = 0;
+  t = latest_min_sqdist(posx, posy, lp.sqdz, &minsqdist);
+  if (t >= 0) {
+    /* relative velocity during second t */
+    vxmin = lp.thatvx[latest_sample[lp.i+t]] - lp.thisvx[latest_sample[lp.j+t]];
+    vymin = lp.thatvy[latest_sample[lp.i+t]] - lp.thisvy[latest_sample[lp.j+t]];
+    mintime = t;
+  }
+
+  if (lp.cursqdist <= minsqdist || mintime == 0) {
+      // if not getting any closer than current situation
+      //     then don't sound an alarm
+      return ALARM_LEVEL_NONE;
+  }
+
+  return latest_level(this_aircraft, fop, &lp, minsqdist, mintime, vxmin, vymin);
+}
+
+/*
+ * EXPERIMENTAL
+ *
+ * "CPA" method uses the same projection as the Latest method, but instead of
+ * sampling the relative position once per second it solves for the time of
+ * closest approach within each stretch of constant relative velocity
+ * (3 seconds, or 1-2 seconds around a time offset between the projections),
+ * taking the stretches straight from the projected velocities.
+ * Integer math, time in 1/16 seconds.  The distance found is the true minimum
+ * of the piecewise-linear relative track (to within rounding), so it is at or
+ * below the one the Latest method finds at the whole seconds.
+ */
+static int8_t Alarm_CPA(container_t *this_aircraft, container_t *fop)
+{
+  latest_t lp;
+  int8_t rval;
+
+  if (! latest_project(this_aircraft, fop, &lp, &rval))
+    return rval;
+
+  int minsqdist = 200*200*4*4;
+  int mintime16 = (ALARM_TIME_CLOSE + 1) << 4;
+  int vxmin = 0;
+  int vymin = 0;
+  int px = lp.dx;                /* relative position at start of this stretch */
+  int py = lp.dy;
+  int t, start;
+  for (start=0; start<LATEST_STEPS; start=t) {
+    int a = latest_sample[lp.i+start];
+    int b = latest_sample[lp.j+start];
+    for (t=start+1; t<LATEST_STEPS; t++) {
+      if (latest_sample[lp.i+t] != a || latest_sample[lp.j+t] != b)
+        break;
+    }
+    int vx = lp.thatvx[a] - lp.thisvx[b];
+    int vy = lp.thatvy[a] - lp.thisvy[b];
+    /* closest approach at tau = -(p.v)/(v.v), clamped to this stretch */
+    int tau16 = 0;
+    int vv = vx*vx + vy*vy;
+    int dot = -(px*vx + py*vy);
+    if (dot > 0 && vv > 0) {
+      tau16 = (dot << 4) / vv;
+      if ((((dot << 4) - tau16 * vv) << 1) >= vv)
+        tau16++;                 /* round to the nearest 1/16 second */
+      if (tau16 > ((t - start) << 4))
+        tau16 = (t - start) << 4;
+    }
+    int cx = px + ((vx * tau16 + 8) >> 4);
+    int cy = py + ((vy * tau16 + 8) >> 4);
+    int sqdist = cx*cx + cy*cy + lp.sqdz;
+    if (sqdist < minsqdist) {
+      minsqdist = sqdist;
+      mintime16 = (start << 4) + tau16;
+      vxmin = vx;
+      vymin = vy;
+    }
+    px += vx * (t - start);
+    py += vy * (t - start);
+  }
+
+  /* in the terms of the Latest method: closest at or before the end of second mintime */
+  int mintime = ((mintime16 + 15) >> 4) - 1;
+
+  if (lp.cursqdist <= minsqdist || mintime <= 0) {
+      // if not getting any closer than current situation
+      //     then don't sound an alarm
+      return ALARM_LEVEL_NONE;
+  }
+
+  return latest_level(this_aircraft, fop, &lp, minsqdist, mintime, vxmin, vymin);
+}
+
 void logOneTraffic(container_t *fop, const char *label)
 {
 //#if defined(USE_SD_CARD)
@@ -843,6 +1316,30 @@ float CosLat()
 
 float InvCosLat() { return inv_cos_lat; }
 
+/*
+ * A packet taken only after an FEC repair must agree with what is already
+ * known about the sender: an address not yet in Container[], or a position
+ * out of reach since its last report, is more likely a false repair.
+ */
+bool Traffic_Plausible(const ufo_t *fop)
+{
+    int i = Traffic_Find(fop->addr);
+    if (i >= MAX_TRACKING_OBJECTS)
+        return false;
+    container_t *cip = &Container[i];
+    float age = (float) (fop->timestamp - cip->timestamp);
+    if (age < 0)
+        age = 0;
+    float dy = 111300.0f * (fop->latitude - cip->latitude);
+    float dx = 111300.0f * (fop->longitude - cip->longitude) * CosLat();
+    float reach = 100.0f * (age + 1.0f) + 500.0f;       /* 100 m/s, plus slack */
+    if (dx * dx + dy * dy > reach * reach)
+        return false;
+    if (fabs(fop->altitude - cip->altitude) > 20.0f * (age + 1.0f) + 100.0f)
+        return false;
+    return true;
+}
+
 struct {
     float distance;
     float bearing;
@@ -893,6 +1390,7 @@ void Copy_Traffic_Distances(container_t *cip)
 }
 
 // assume dx, dy, distance, bearing, alt_diff have already been computed
+/* distances and alarm level - Traffic_Rank() the slot after this */
 void Traffic_Update(container_t *fop)
 {
   if (fop->tx_type <= TX_TYPE_S) {       // non-directional target
@@ -982,6 +1480,7 @@ void Traffic_Update(container_t *fop)
   }
 }
 
+
 static float oldrange[12];
 static float newrange[12];
 static uint32_t oldrange_n[12];
@@ -1336,12 +1835,11 @@ void AddTraffic(ufo_t *fop, const char *callsign)
     }
 
     /* first check whether we are already tracking this object */
-    int i;
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    int i = Traffic_Find(fop->addr);
 
-      cip = &Container[i];
+    if (i < MAX_TRACKING_OBJECTS) {
 
-      if (cip->addr == fop->addr) {
+        cip = &Container[i];
 
         bool fop_adsb = fop->protocol == RF_PROTOCOL_GDL90 || fop->protocol == RF_PROTOCOL_ADSB_1090;
         bool cip_adsb = cip->protocol == RF_PROTOCOL_GDL90 || cip->protocol == RF_PROTOCOL_ADSB_1090;
@@ -1378,6 +1876,7 @@ void AddTraffic(ufo_t *fop, const char *callsign)
             fop->longitude == cip->longitude) {
                 cip->last_crc  = fop->last_crc;      // so 2nd time slot packet will be ignored
                 cip->timestamp = fop->timestamp;     // so it won't expire
+                Traffic_Touch(i);
                 if (do_relay)  air_relay(cip);
                 return;
         }
@@ -1406,12 +1905,13 @@ void AddTraffic(ufo_t *fop, const char *callsign)
         }
 
         CopyTraffic(cip, fop, callsign);
+        Traffic_Touch(i);
         Calc_Traffic_Distances(cip);
         // Now can update alarm_level
         Traffic_Update(cip);
+        Traffic_Rank(i);
         if (do_relay)  air_relay(cip);
         return;
-      }
     }
 
     /* new object, try and find a slot for it */
@@ -1421,33 +1921,20 @@ void AddTraffic(ufo_t *fop, const char *callsign)
         report_landed_out(fop);
     }
 
-    /* replace an empty object if found */
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].addr == 0) {
+    /* replace an empty object, or else an expired object, if found */
+    i = Traffic_Vacant();
+    if (i < MAX_TRACKING_OBJECTS) {
+        bool expired = (Container[i].addr != 0);
         cip = &Container[i];
-        //*cip = EmptyContainer;
-        EmptyContainer(cip);
+        Traffic_Claim(i, fop->addr);     // also empties the slot
         CopyTraffic(cip, fop, callsign);
         Calc_Traffic_Distances(cip);
         Traffic_Update(cip);
-        sample_range(cip);
+        Traffic_Rank(i);
+        if (! expired)
+            sample_range(cip);
         if (do_relay)  air_relay(cip);
         return;
-      }
-    }
-    /* replace an expired object if found */
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (OurTime > Container[i].timestamp + ENTRY_EXPIRATION_TIME) {
-        cip = &Container[i];
-        //*cip = EmptyContainer;
-        EmptyContainer(cip);
-        CopyTraffic(cip, fop, callsign);
-        Calc_Traffic_Distances(cip);
-        Traffic_Update(cip);
-        //sample_range(cip);
-        if (do_relay)  air_relay(cip);
-        return;
-      }
     }
 
     /* may need to replace a non-expired object:   */
@@ -1460,21 +1947,9 @@ void AddTraffic(ufo_t *fop, const char *callsign)
     /* identify the farthest-away non-"followed" object */
     /*    (distance adjusted for altitude difference)   */
     uint32_t follow_id = settings->follow_id;
-    int max_dist_ndx = MAX_TRACKING_OBJECTS;
-    float max_dist = 0;
+    float max_dist;
     float adj_distance;
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].alarm_level == ALARM_LEVEL_NONE
-          && Container[i].addr != follow_id && Container[i].relayed == false) {
-        adj_distance = Container[i].adj_distance;
-        if (adj_distance < Container[i].distance)
-            adj_distance = Container[i].distance;
-        if (adj_distance > max_dist)  {
-          max_dist_ndx = i;
-          max_dist = adj_distance;
-        }
-      }
-    }
+    int max_dist_ndx = Traffic_Farthest(&max_dist);
 
     /* replace the farthest currently-tracked object, */
     /* but only if the new object is closer (or "followed", or relayed) */;
@@ -1483,11 +1958,11 @@ void AddTraffic(ufo_t *fop, const char *callsign)
     if (max_dist_ndx < MAX_TRACKING_OBJECTS
         && (adj_distance < max_dist || fop->addr == follow_id || fop->relayed)) {
       cip = &Container[max_dist_ndx];
-      //*cip = EmptyContainer;
-      EmptyContainer(cip);
+      Traffic_Claim(max_dist_ndx, fop->addr);
       CopyTraffic(cip, fop, callsign);
       Copy_Traffic_Distances(cip);     // computed above by Stash_Traffic_Distances(fop)
       Traffic_Update(cip);
+      Traffic_Rank(max_dist_ndx);
       //sample_range(cip);   - do not sample, aircraft may be closer than max range
       if (do_relay)  air_relay(cip);
       return;
@@ -1526,7 +2001,15 @@ Serial.println(which_rx_try);
     if (protocol_decode == NULL)
         return;
 
-    if (((*protocol_decode)((void *) fo_raw, &ThisAircraft, &fo)) == false)
+    uint32_t prof_t0 = PROF_TICKS();
+    bool decoded = (*protocol_decode)((void *) fo_raw, &ThisAircraft, &fo);
+    Prof_Since(PROF_DECODE, prof_t0);
+    if (! decoded)
+        return;
+
+    bool repaired = RF_last_repaired;
+    RF_last_repaired = false;
+    if (repaired && ! Traffic_Plausible(&fo))
         return;
 
     if (fo.tx_type == TX_TYPE_NONE)   // not ADS-B or other external sources
@@ -1534,13 +2017,87 @@ Serial.println(which_rx_try);
 
     if (settings->rf_protocol == RF_PROTOCOL_ADSB_UAT)
 //  ||  settings->rf_protocol == RF_PROTOCOL_ADSB_1090)
-        AddTraffic(&fo, fo_callsign);
+        PROF_RUN(PROF_ADDTRAFFIC, AddTraffic(&fo, fo_callsign));
     else
-        AddTraffic(&fo, (char *) NULL);
+        PROF_RUN(PROF_ADDTRAFFIC, AddTraffic(&fo, (char *) NULL));
+}
+
+#if defined(USE_RF_TASK)
+/*
+ * Same as ParseData(), for the packets the radio task has received
+ * (and mostly decoded already).  Drains the queue even without a fix.
+ */
+bool ParseQueued(bool validfix)
+{
+    rf_rx_t rx;
+    bool rval = false;
+
+    while (RF_Task_Receive(&rx)) {
+
+      rval = true;
+      if (! validfix)
+        continue;
+
+      if (rx.status == RF_RX_LOOPBACK) {
+Serial.println("RF loopback is detected");
+        if (settings->nmea_p) {
+          StdOut.println(F("$PSRFE,RF loopback is detected"));
+        }
+        continue;
+      }
+
+      memcpy(fo_raw, rx.raw, rx.size);
+      if (settings->nmea_p) {
+        StdOut.print(F("$PSRFI,"));
+        StdOut.print((unsigned long) rx.timestamp); StdOut.print(F(","));
+        StdOut.print(Bin2Hex(fo_raw, rx.size)); StdOut.print(F(","));
+        StdOut.println(rx.rssi);
+      }
+
+      if (rx.status == RF_RX_UNDECODED) {
+        EmptyFO(&fo);
+        if (protocol_decode == NULL)
+            continue;
+        uint32_t prof_t0 = PROF_TICKS();
+        bool decoded = (*protocol_decode)((void *) fo_raw, &ThisAircraft, &fo);
+        Prof_Since(PROF_DECODE, prof_t0);
+        if (! decoded)
+            continue;
+        if (fo.tx_type == TX_TYPE_NONE)
+            fo.tx_type = TX_TYPE_FLARM;
+        memcpy(rx.callsign, fo_callsign, sizeof(rx.callsign));
+      } else if (rx.status == RF_RX_DECODED) {
+        fo = rx.fo;
+      } else {
+        continue;
+      }
+
+      /* left out by legacy_decode() while the task runs, it reads Container[] */
+      if (settings->rf_protocol == RF_PROTOCOL_LEGACY ||
+          settings->rf_protocol == RF_PROTOCOL_LATEST) {
+        if (legacy_duplicate(fo.addr, rx.crc))
+          continue;
+        fo.last_crc = rx.crc;
+      }
+
+      if (rx.repaired && ! Traffic_Plausible(&fo))
+        continue;
+
+      RF_last_rssi = rx.rssi;     /* for AddTraffic(), as in GDL90 */
+      if (settings->rf_protocol == RF_PROTOCOL_ADSB_UAT)
+          PROF_RUN(PROF_ADDTRAFFIC, AddTraffic(&fo, rx.callsign));
+      else
+          PROF_RUN(PROF_ADDTRAFFIC, AddTraffic(&fo, (char *) NULL));
+    }
+
+    return rval;
 }
+#endif /* USE_RF_TASK */
 
 void Traffic_setup()
 {
+  Traffic_Reindex();
+
   switch (settings->alarm)
   {
   case TRAFFIC_ALARM_NONE:
@@ -1552,6 +2109,9 @@ void Traffic_setup()
   case TRAFFIC_ALARM_LATEST:
     Alarm_Level = &Alarm_Latest;
     break;
+  case TRAFFIC_ALARM_CPA:
+    Alarm_Level = &Alarm_CPA;
+    break;
   case TRAFFIC_ALARM_DISTANCE:
   default:
     Alarm_Level = &Alarm_Distance;
@@ -1573,48 +2133,49 @@ void Traffic_loop()
     if (! isTimeToUpdateTraffic())
         return;
 
+    uint32_t prof_t0 = PROF_TICKS();
+
     container_t *mfop = NULL;
     max_alarm_level = ALARM_LEVEL_NONE;          /* global, used for visual displays */
     alarm_ahead = false;                         /* global, used for strobe pattern */
     int sound_alarm_level = ALARM_LEVEL_NONE;    /* local, used for sound alerts */
     int alarmcount = 0;
 
-    for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    for (int i=Traffic_First(), next; i < MAX_TRACKING_OBJECTS; i=next) {
 
       container_t *fop = &Container[i];
+      next = Traffic_Next(i);   /* before fop may be released */
 
-      if (fop->addr) {  /* non-empty Container slot */
-
-        // expire non-directional targets early
-        uint32_t expiration_time = (fop->tx_type <= TX_TYPE_S)? NONDIR_EXPIRATION : ENTRY_EXPIRATION_TIME;
+      // expire non-directional targets early
+      uint32_t expiration_time = (fop->tx_type <= TX_TYPE_S)? NONDIR_EXPIRATION : ENTRY_EXPIRATION_TIME;
 
-        if (OurTime <= fop->timestamp + expiration_time) {
+      if (OurTime <= fop->timestamp + expiration_time) {
 
-          if ((RF_time - fop->timestamp) >= TRAFFIC_VECTOR_UPDATE_INTERVAL)
-              continue;
+        if ((RF_time - fop->timestamp) >= TRAFFIC_VECTOR_UPDATE_INTERVAL)
+            continue;
 
-          /* determine the highest alarm level seen at the moment */
-          if (fop->alarm_level > max_alarm_level)
-              max_alarm_level = fop->alarm_level;
+        /* determine the highest alarm level seen at the moment */
+        if (fop->alarm_level > max_alarm_level)
+            max_alarm_level = fop->alarm_level;
 
-          /* determine if any traffic with alarm level low+ is "ahead" */
-          /* - this is for the strobe, increase flashing if "ahead" */
-          if (fop->alarm_level >= ALARM_LEVEL_LOW) {
-              if (abs(fop->RelativeHeading) < 45)
-                  alarm_ahead = true;
-          }
+        /* determine if any traffic with alarm level low+ is "ahead" */
+        /* - this is for the strobe, increase flashing if "ahead" */
+        if (fop->alarm_level >= ALARM_LEVEL_LOW) {
+            if (abs(fop->RelativeHeading) < 45)
+                alarm_ahead = true;
+        }
 
-          /* figure out what is the highest alarm level needing a sound alert */
-          if (fop->alarm_level > fop->alert_level
-                   && fop->alarm_level > ALARM_LEVEL_CLOSE) {
-              ++alarmcount;
-              if (fop->alarm_level > sound_alarm_level) {
-                  sound_alarm_level = fop->alarm_level;
-                  mfop = fop;
-              }
-          }
+        /* figure out what is the highest alarm level needing a sound alert */
+        if (fop->alarm_level > fop->alert_level
+                 && fop->alarm_level > ALARM_LEVEL_CLOSE) {
+            ++alarmcount;
+            if (fop->alarm_level > sound_alarm_level) {
+                sound_alarm_level = fop->alarm_level;
+                mfop = fop;
+            }
+        }
 
-        } else {   /* expired ufo */
+      } else {   /* expired ufo */
 
 // send out summary data about the aircraft
 if (fop->protocol == RF_PROTOCOL_ADSB_1090 && (settings->debug_flags & DEBUG_DEEPER)) {
@@ -1640,23 +2201,24 @@ if (fop->protocol == RF_PROTOCOL_ADSB_1090 && (settings->debug_flags & DEBUG_DEE
     Serial.println(fop->maxrssi);
   }
 }
-          sample_range(fop);
-
-          // EmptyContainer(fop);
-          fop->addr = 0;
-
-          /* implied by empty:
-          fop->addr = 0;
-          fop->alert = 0;
-          fop->alarm_level = 0;
-          fop->alert_level = 0;
-          fop->prevtime_ms = 0;
-          etc... */
-        }
+        sample_range(fop);
+
+        Traffic_Release(i);
+
+        /* implied by empty:
+        fop->addr = 0;
+        fop->alert = 0;
+        fop->alarm_level = 0;
+        fop->alert_level = 0;
+        fop->prevtime_ms = 0;
+        etc... */
       }
     }
 
+    Prof_Since(PROF_TRF_SCAN, prof_t0);
+
     if (sound_alarm_level > ALARM_LEVEL_CLOSE) {   // implies mfop != NULL
+      uint32_t prof_t1 = PROF_TICKS();
       // use alarmcount to modify the sounds
       bool notified = Buzzer_Notify(sound_alarm_level, (alarmcount > 1));
 #if !defined(EXCLUDE_VOICE)
@@ -1720,8 +2282,10 @@ if (fop->protocol == RF_PROTOCOL_ADSB_1090 && (settings->debug_flags & DEBUG_DEE
         }
 #endif
       //}
+      Prof_Since(PROF_TRF_ALARM, prof_t1);
     }
 
+    Prof_Since(PROF_TRAFFIC, prof_t0);
     UpdateTrafficTimeMarker = millis();
 }
 
@@ -1729,12 +2293,10 @@ if (fop->protocol == RF_PROTOCOL_ADSB_1090 && (settings->debug_flags & DEBUG_DEE
 //   - instead expired entries are purged in Traffic_loop()
 void ClearExpired()
 {
-  for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr &&
-         (OurTime > Container[i].timestamp + ENTRY_EXPIRATION_TIME)) {
-      //EmptyContainer(&Container[i]);
-      Container[i].addr = 0;
-    }
+  for (int i=Traffic_First(), next; i < MAX_TRACKING_OBJECTS; i=next) {
+    next = Traffic_Next(i);
+    if (OurTime > Container[i].timestamp + ENTRY_EXPIRATION_TIME)
+      Traffic_Release(i);
   }
 }
 
@@ -1762,20 +2324,6 @@ int Traffic_Count()
   return count;
 }
 
-/* this is used in Text_EPD.cpp for 'radar' display, */
-/* so don't adjust for altitude difference.          */
-
-int traffic_cmp_by_distance(const void *a, const void *b)
-{
-  traffic_by_dist_t *ta = (traffic_by_dist_t *)a;
-  traffic_by_dist_t *tb = (traffic_by_dist_t *)b;
-
-  if (ta->distance >  tb->distance) return  1;
-/*  if (ta->distance == tb->distance) return  0; */
-  if (ta->distance <  tb->distance) return -1;
-  return  0;
-}
-
 /* called (as needed) from softRF.ino normal(), or from ParseData() above, */
 /*   or every few minutes from Estimate_Wind() if ADDR_TYPE_RANDOM         */
 void generate_random_id()
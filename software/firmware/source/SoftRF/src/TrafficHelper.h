@@ -57,12 +57,40 @@ typedef struct traffic_by_dist_struct {
   float distance;
 } traffic_by_dist_t;
 
+/* Container[] slot number, MAX_TRACKING_OBJECTS stands for "none" */
+#if MAX_TRACKING_OBJECTS < 255
+typedef uint8_t  traffic_ndx_t;
+#else
+typedef uint16_t traffic_ndx_t;
+#endif
+
+/* addr -> slot hash table, kept at least twice the size of Container[] */
+#if   MAX_TRACKING_OBJECTS <= 8
+#define TRAFFIC_HASH_BITS     4
+#elif MAX_TRACKING_OBJECTS <= 16
+#define TRAFFIC_HASH_BITS     5
+#elif MAX_TRACKING_OBJECTS <= 32
+#define TRAFFIC_HASH_BITS     6
+#elif MAX_TRACKING_OBJECTS <= 64
+#define TRAFFIC_HASH_BITS     7
+#elif MAX_TRACKING_OBJECTS <= 128
+#define TRAFFIC_HASH_BITS     8
+#elif MAX_TRACKING_OBJECTS <= 256
+#define TRAFFIC_HASH_BITS     9
+#elif MAX_TRACKING_OBJECTS <= 512
+#define TRAFFIC_HASH_BITS     10
+#else
+#error "MAX_TRACKING_OBJECTS is too large"
+#endif
+#define TRAFFIC_HASH_SIZE     (1 << TRAFFIC_HASH_BITS)
+
 enum
 {
 	TRAFFIC_ALARM_NONE,
 	TRAFFIC_ALARM_DISTANCE,
 	TRAFFIC_ALARM_VECTOR,
-	TRAFFIC_ALARM_LATEST
+	TRAFFIC_ALARM_LATEST,
+	TRAFFIC_ALARM_CPA
 };
 
 enum
@@ -82,6 +110,9 @@ enum
 void air_relay(container_t *fop);
 void AddTraffic(ufo_t *fop, const char *callsign);
 void ParseData(void);
+#if defined(USE_RF_TASK)
+bool ParseQueued(bool);
+#endif
 void Traffic_setup(void);
 void Traffic_loop(void);
 void ClearExpired(void);
@@ -89,11 +120,22 @@ void Traffic_Update(container_t *fop);
 int  Traffic_Count(void);
 void logCloseTraffic(void);
 void icao_to_n(container_t *fop);
-int  traffic_cmp_by_distance(const void *, const void *);
 float Adj_alt_diff(container_t *, container_t *);
 void generate_random_id(void);
 void save_range_stats(void);
 
+int  Traffic_Find(uint32_t);
+int  Traffic_Vacant(void);
+int  Traffic_Farthest(float *);
+int  Traffic_First(void);
+int  Traffic_Next(int);
+void Traffic_Claim(int, uint32_t);
+void Traffic_Touch(int);
+void Traffic_Rank(int);
+void Traffic_Release(int);
+void Traffic_Reindex(void);
+bool Traffic_Plausible(const ufo_t *);
+
 void EmptyContainer(container_t *p);
 void EmptyFO(ufo_t *p);
 
@@ -107,7 +149,8 @@ extern container_t Container[MAX_TRACKING_OBJECTS];  // EmptyContainer;
 extern ufo_t fo;  // EmptyFO;
 extern char fo_callsign[10];
 extern uint8_t fo_raw[34];
-extern traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];
+extern traffic_by_dist_t traffic_by_dist[MAX_TRACKING_OBJECTS];  // sorted by distance
+extern int traffic_by_dist_n;
 extern int max_alarm_level;
 extern bool alarm_ahead;
 extern bool relay_waiting;
@@ -51,6 +51,7 @@ bool BTactive = false;
 #include "esp_bt.h"
 #include "esp_bt_main.h"
 #include "esp_gap_bt_api.h"
+#include "esp_gap_ble_api.h"
 
 #include "WiFi.h"   // HOSTNAME
 #include "Battery.h"
@@ -83,9 +84,27 @@ BluetoothSerial SerialBT;
 
 String BT_name;
 
-static unsigned long BLE_Notify_TimeMarker = 0;
 static unsigned long BLE_Advertising_TimeMarker = 0;
 
+BLE_TX_stats_t BLE_TX_stats = { BLE_MAX_WRITE_CHUNK_SIZE + 3, 0, 0, 0, 0, 0 };
+
+/*
+ * Every write() into BLE_FIFO_TX leaves a mark at the FIFO position it ends at,
+ * the mark is retired with the latency once the notifications have passed it.
+ * When the ring is full the write goes unmarked, the stats are a sample anyway.
+ */
+#define BLE_TX_MARKS  16
+
+static struct {
+  uint32_t      end;
+  unsigned long ms;
+} BLE_TX_marks[BLE_TX_MARKS];
+
+static uint8_t  BLE_TX_mark_head = 0;
+static uint8_t  BLE_TX_mark_tail = 0;
+static uint32_t BLE_TX_queued    = 0;     /* bytes accepted, same origin as .sent */
+static bool     BLE_TX_orphan    = false; /* a sentence went without its line end */
+
 BLEDescriptor UserDescriptor(BLEUUID((uint16_t)0x2901));
 
 class MyServerCallbacks: public BLEServerCallbacks {
@@ -101,6 +120,104 @@ class MyServerCallbacks: public BLEServerCallbacks {
     }
 };
 
+static void BLE_TX_Reset()
+{
+  BLE_FIFO_TX->flush();
+  BLE_TX_queued    = BLE_TX_stats.sent;
+  BLE_TX_mark_head = BLE_TX_mark_tail = 0;
+  BLE_TX_orphan    = false;
+}
+
+static void BLE_TX_Retire()
+{
+  while (BLE_TX_mark_tail != BLE_TX_mark_head &&
+         (int32_t) (BLE_TX_stats.sent - BLE_TX_marks[BLE_TX_mark_tail].end) >= 0) {
+    unsigned long latency = millis() - BLE_TX_marks[BLE_TX_mark_tail].ms;
+    if (latency > 0xFFFF)
+      latency = 0xFFFF;
+    if (latency > BLE_TX_stats.latency_max)
+      BLE_TX_stats.latency_max = latency;
+    /* running average over the last ~8 writes */
+    BLE_TX_stats.latency_avg += ((int) latency - (int) BLE_TX_stats.latency_avg) / 8;
+    BLE_TX_mark_tail = (BLE_TX_mark_tail + 1) % BLE_TX_MARKS;
+  }
+}
+
+/* payload size of one notification, from the MTU the peer has settled on */
+static size_t BLE_Notify_Size(uint16_t conn_id)
+{
+  uint16_t mtu = pServer->getPeerMTU(conn_id);
+
+  if (mtu < BLE_MAX_WRITE_CHUNK_SIZE + 3)
+    mtu = BLE_MAX_WRITE_CHUNK_SIZE + 3;
+  BLE_TX_stats.mtu = mtu;
+
+  return (mtu - 3 > BLE_MAX_NOTIFY_SIZE ? BLE_MAX_NOTIFY_SIZE : mtu - 3);
+}
+
+/*
+ * Queue for notification, in whole sentences: what doesn't fit is dropped
+ * from the last line end that does.  A write that leaves its line open
+ * (NMEA_Out() sends the "\r\n" separately) needs room for the line end too,
+ * and if it is dropped so is the line end that follows it.
+ */
+static size_t BLE_TX_Enqueue(const uint8_t *buffer, size_t size)
+{
+  const uint8_t *p = buffer;
+  size_t n = size;
+
+  if (!deviceConnected)     /* the FIFO is flushed on connect anyway */
+    return size;
+
+  if (BLE_TX_orphan) {
+    BLE_TX_orphan = false;
+    if (n > 0 && (p[0] == '\r' || p[0] == '\n')) {
+      const uint8_t *nl = (const uint8_t *) memchr(p, '\n', n);
+      size_t skip = (nl ? nl - p + 1 : n);
+      BLE_TX_stats.dropped += skip;
+      p += skip;
+      n -= skip;
+    }
+  }
+
+  if (n == 0)
+    return size;
+
+  bool eol = (p[n-1] == '\n');
+  size_t room = BLE_FIFO_TX->room();
+  size_t fit = n;
+
+  if (eol ? (n > room) : (n + 2 > room)) {
+    fit = 0;
+    if (eol) {
+      for (size_t i = room; i > 0; i--) {
+        if (p[i-1] == '\n') {
+          fit = i;
+          break;
+        }
+      }
+    } else {
+      BLE_TX_orphan = true;
+    }
+  }
+
+  if (fit > 0) {
+    BLE_FIFO_TX->write((const char *) p, fit);
+    BLE_TX_queued += fit;
+
+    uint8_t next = (BLE_TX_mark_head + 1) % BLE_TX_MARKS;
+    if (next != BLE_TX_mark_tail) {
+      BLE_TX_marks[BLE_TX_mark_head].end = BLE_TX_queued;
+      BLE_TX_marks[BLE_TX_mark_head].ms  = millis();
+      BLE_TX_mark_head = next;
+    }
+  }
+
+  BLE_TX_stats.dropped += n - fit;
+
+  return size;
+}
+
 class UARTCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic *pUARTCharacteristic) {
       std::string rxValue = pUARTCharacteristic->getValue();
@@ -149,10 +266,11 @@ static void ESP32_Bluetooth_setup()
       BLEDevice::init((BT_name+"-LE").c_str());
 
       /*
-       * Set the MTU of the packets sent,
-       * maximum is 500, Apple needs 23 apparently.
+       * Offer the largest MTU, the peer picks what it can do
+       * (iOS settles on 185, Android asks up to 517).
+       * Notifications are sized by what was agreed, see BLE_Notify_Size().
        */
-      // BLEDevice::setMTU(23);
+      BLEDevice::setMTU(BLE_MAX_MTU);
 
       // Create the BLE Server
       pServer = BLEDevice::createServer();
@@ -309,21 +427,33 @@ static void ESP32_Bluetooth_loop()
   case BLUETOOTH_LE_HM10_SERIAL:
     {
       // notify changed value
-      // bluetooth stack will go into congestion, if too many packets are sent
-      if (deviceConnected && (millis() - BLE_Notify_TimeMarker > 10)) { /* < 18000 baud */
-
-          static uint8_t chunk[BLE_MAX_WRITE_CHUNK_SIZE];   // >>> MB added "static"
-          size_t size = BLE_FIFO_TX->available();
-          size = size < BLE_MAX_WRITE_CHUNK_SIZE ? size : BLE_MAX_WRITE_CHUNK_SIZE;
+      // bluetooth stack will go into congestion, if too many packets are sent:
+      // send MTU sized chunks while the controller has buffers for this link
+      if (deviceConnected && BLE_FIFO_TX->available() > 0) {
+
+          static uint8_t chunk[BLE_MAX_NOTIFY_SIZE];   // >>> MB added "static"
+          uint16_t conn_id = pServer->getConnId();
+          size_t chunk_size = BLE_Notify_Size(conn_id);
+
+          for (int burst = 0; burst < BLE_MAX_NOTIFY_BURST; burst++) {
+            size_t size = BLE_FIFO_TX->available();
+            if (size == 0)
+              break;
+            if (esp_ble_get_cur_sendable_packets_num(conn_id) == 0) {
+              BLE_TX_stats.congested++;
+              break;
+            }
+            size = size < chunk_size ? size : chunk_size;
 
-          if (size > 0) {
             BLE_FIFO_TX->read((char *) chunk, size);
 
             pUARTCharacteristic->setValue(chunk, size);
             pUARTCharacteristic->notify();
+
+            BLE_TX_stats.sent += size;
           }
 
-          BLE_Notify_TimeMarker = millis();
+          BLE_TX_Retire();
       }
       // disconnecting
       if (!deviceConnected && oldDeviceConnected && (millis() - BLE_Advertising_TimeMarker > 500) ) {
@@ -336,6 +466,7 @@ static void ESP32_Bluetooth_loop()
       // connecting
       if (deviceConnected && !oldDeviceConnected) {
           // do stuff here on connecting
+          BLE_TX_Reset();     // nothing stale for the new peer
           oldDeviceConnected = deviceConnected;
           //Serial.println("BLE reconnected");
       }
@@ -432,8 +563,7 @@ static size_t ESP32_Bluetooth_write(const uint8_t *buffer, size_t size)
     break;
 #endif /* CONFIG_IDF_TARGET_ESP32S3 */
   case BLUETOOTH_LE_HM10_SERIAL:
-    rval = BLE_FIFO_TX->write((char *) buffer,
-                        (BLE_FIFO_TX->room() > size ? size : BLE_FIFO_TX->room()));
+    rval = BLE_TX_Enqueue(buffer, size);
     break;
   case BLUETOOTH_OFF:
   case BLUETOOTH_A2DP_SOURCE:
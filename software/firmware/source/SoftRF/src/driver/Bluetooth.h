@@ -60,12 +60,25 @@ extern bool BTactive;
 #define GPS2_CHARACTERISTIC_UUID        "aba27100-143b-4b81-a444-edcd0000f024"
 #define SYSTEM_CHARACTERISTIC_UUID      "aba27100-143b-4b81-a444-edcd0000f025"
 
-/* (FLAA x MAX_TRACKING_OBJECTS + GNGGA + GNRMC + FLAU) x 80 symbols */
-#define BLE_FIFO_TX_SIZE          1024
+/* (FLAA x MAX_TRACKING_OBJECTS + GNGGA + GNRMC + FLAU) x 80 symbols, x 2 */
+#define BLE_FIFO_TX_SIZE          2048
 #define BLE_FIFO_RX_SIZE          256
 
-#define BLE_MAX_WRITE_CHUNK_SIZE  20
-
+#define BLE_MAX_WRITE_CHUNK_SIZE  20    /* default ATT MTU (23) - 3 */
+#define BLE_MAX_MTU               517
+#define BLE_MAX_NOTIFY_SIZE       244   /* fits one LE data length extended PDU */
+#define BLE_MAX_NOTIFY_BURST      8     /* notifications per loop() pass */
+
+typedef struct BLE_TX_stats_struct {
+  uint16_t      mtu;            /* negotiated with the current peer */
+  uint32_t      sent;           /* bytes notified */
+  uint32_t      dropped;        /* bytes dropped, in whole sentences */
+  uint32_t      congested;      /* passes cut short by the controller */
+  uint16_t      latency_max;    /* ms from write() to notify(), per sentence */
+  uint16_t      latency_avg;    /* smoothed over ~8 writes */
+} BLE_TX_stats_t;
+
+extern BLE_TX_stats_t BLE_TX_stats;
 extern IODev_ops_t ESP32_Bluetooth_ops;
 
 #if defined(ENABLE_BT_VOICE)
@@ -30,6 +30,7 @@
 #include "Filesys.h"
 #include "../protocol/data/NMEA.h"
 #include "../system/Time.h"
+#include "../system/Prof.h"
 #include "WiFi.h"
 #include "RF.h"
 #include "Battery.h"
@@ -2353,7 +2354,7 @@ void PickGNSSFix()
           if (!isxdigit(GNSSbuf[GNSS_cnt-16+i])) break;
         }
         if (i>=14) {
-          D1090_Import(&GNSSbuf[GNSS_cnt-17]);
+          PROF_RUN(PROF_ADSB, D1090_Import(&GNSSbuf[GNSS_cnt-17]));
           GNSS_cnt -= 18;
         }
       } else if (GNSS_cnt > 30 && GNSSbuf[GNSS_cnt-31] == '*') {
@@ -2361,7 +2362,7 @@ void PickGNSSFix()
           if (!isxdigit(GNSSbuf[GNSS_cnt-30+i])) break;
         }
         if (i>=28) {
-          D1090_Import(&GNSSbuf[GNSS_cnt-31]);
+          PROF_RUN(PROF_ADSB, D1090_Import(&GNSSbuf[GNSS_cnt-31]));
           GNSS_cnt -= 32;
         }
       }
@@ -23,10 +23,12 @@
 #include "RF.h"
 #include "../system/Time.h"
 #include "../system/SoC.h"
+#include "../system/Prof.h"
 #include "../TrafficHelper.h"
 #include "Settings.h"
 #include "Battery.h"
 #include "../ui/Web.h"
+#include "../protocol/data/NMEA.h"
 #if !defined(EXCLUDE_MAVLINK)
 #include "../protocol/data/MAVLink.h"
 #endif /* EXCLUDE_MAVLINK */
@@ -52,6 +54,7 @@ uint32_t rx_packets_counter = 0;
 int8_t which_rx_try = 0;
 int8_t RF_last_rssi = 0;
 uint16_t RF_last_crc = 0;
+bool RF_last_repaired = false;  /* passed the parity checks only after ogntp_repair() */
 
 uint8_t current_RF_protocol;    // for tx - rx is always in settings->rf_protocol
 
@@ -880,7 +883,17 @@ static void sx12xx_rx_func (osjob_t* job) {
     sx12xx_receive_complete = true;
     break;
   case RF_CHECKSUM_TYPE_GALLAGER:
-    if (LDPC_Check((uint8_t  *) &LMIC.frame[0])) {
+    RF_last_repaired = false;
+    if (LDPC_Check((uint8_t  *) &LMIC.frame[0]) &&
+#if defined(USE_BASICMAC)
+        /* only the SX126x driver fills frame_err, when it undoes Manchester */
+        !ogntp_repair(&LMIC.frame[0],
+                      (rf_chip == &sx1262_ops &&
+                       LMIC.protocol->whitening == RF_WHITENING_MANCHESTER) ?
+                       &LMIC.frame_err[0] : NULL)) {
+#else
+        !ogntp_repair(&LMIC.frame[0], NULL)) {
+#endif
 #if DEBUG
       Serial.printf(" %02x%02x%02x%02x%02x%02x is wrong FEC",
         LMIC.frame[i], LMIC.frame[i+1], LMIC.frame[i+2],
@@ -1338,10 +1351,14 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
           (offset > 3 ? (rxPacket_ptr->payload[3] == cc13xx_protocol->syncword[7]) : true)) {
 
         uint8_t i, val1, val2;
+        uint8_t Err[OGNTP_PAYLOAD_SIZE + OGNTP_CRC_SIZE];
         for (i = 0; i < size; i++) {
           val1 = pgm_read_byte(&ManchesterDecode[rxPacket_ptr->payload[i + offset]]);
           i++;
           val2 = pgm_read_byte(&ManchesterDecode[rxPacket_ptr->payload[i + offset]]);
+          if ((i>>1) < sizeof(Err)) {
+            Err[i>>1] = (val1 & 0xF0) | (val2 >> 4);
+          }
           if ((i>>1) < sizeof(RxBuffer)) {
             RxBuffer[i>>1] = ((val1 & 0x0F) << 4) | (val2 & 0x0F);
 
@@ -1364,7 +1381,9 @@ void cc13xx_Receive_callback(EasyLink_RxPacket *rxPacket_ptr, EasyLink_Status st
         switch (cc13xx_protocol->crc_type)
         {
         case RF_CHECKSUM_TYPE_GALLAGER:
-          if (LDPC_Check((uint8_t  *) &RxBuffer[0]) == 0) {
+          RF_last_repaired = false;
+          if (LDPC_Check((uint8_t  *) &RxBuffer[0]) == 0 ||
+              ogntp_repair(&RxBuffer[0], Err)) {
 
             success = true;
           }
@@ -1898,7 +1917,9 @@ static bool ognrf_receive()
     RxRSSI = TRX.ReadRSSI();
 
     TRX.ReadPacket(RxBuffer, Err);
-    if (LDPC_Check((uint8_t  *) RxBuffer) == 0) {
+    RF_last_repaired = false;
+    if (LDPC_Check((uint8_t  *) RxBuffer) == 0 ||
+        ogntp_repair(RxBuffer, Err)) {
       success = true;
     }
   }
@@ -2101,18 +2122,58 @@ byte RF_setup(void)
 }
 
 
+/*
+ * Per second channel plan for the Legacy/Latest/OGNTP time slots, filled a
+ * few seconds ahead from the idle part of RF_loop(), so that the slot switch
+ * only looks up the channel.  Filled and read on the same thread as RF_loop().
+ */
+#define RF_SCHEDULE_SIZE  4                 /* seconds, power of 2 */
+
+typedef struct {
+  uint32_t time;                            /* UTC second, 0 if empty */
+  uint8_t  plan;                            /* frequency plan the channels are for */
+  uint8_t  chan[2][2];                      /* [OGN][Slot] */
+} rf_schedule_t;
+
+static rf_schedule_t RF_Schedule[RF_SCHEDULE_SIZE];
+
+static void RF_Schedule_Fill(uint32_t from)
+{
+  for (uint32_t time = from; time < from + RF_SCHEDULE_SIZE; time++) {
+    rf_schedule_t *sp = &RF_Schedule[time & (RF_SCHEDULE_SIZE - 1)];
+
+    if (sp->time != time || sp->plan != RF_FreqPlan.Plan) {
+      for (uint8_t OGN = 0; OGN < 2; OGN++) {
+        sp->chan[OGN][0] = RF_FreqPlan.getChannel((time_t) time, 0, OGN);
+        sp->chan[OGN][1] = RF_FreqPlan.getChannel((time_t) time, 1, OGN);
+      }
+      sp->plan = RF_FreqPlan.Plan;
+      sp->time = time;
+    }
+  }
+}
+
+static uint8_t RF_Schedule_Channel(uint32_t time, uint8_t Slot, uint8_t OGN)
+{
+  const rf_schedule_t *sp = &RF_Schedule[time & (RF_SCHEDULE_SIZE - 1)];
+
+  if (sp->time == time && sp->plan == RF_FreqPlan.Plan)
+    return sp->chan[OGN][Slot];
+
+  return RF_FreqPlan.getChannel((time_t) time, Slot, OGN);
+}
+
 /* original code, now only called for protocols other than Legacy: */
 void RF_SetChannel(void)
 {
-  tmElements_t  tm;
   time_t        Time;
   uint8_t       Slot;
-  uint32_t now_ms, pps_btime_ms, time_corr_neg;
+  uint32_t now_ms, ref_ms = 0;
 
   switch (settings->mode)
   {
   case SOFTRF_MODE_TXRX_TEST:
-    Time = OurTime;
+    Time_Snapshot(&Time, &ref_ms);
     RF_timing = RF_timing == RF_TIMING_2SLOTS_PPS_SYNC ?
                 RF_TIMING_INTERVAL : RF_timing;
     break;
@@ -2127,42 +2188,15 @@ void RF_SetChannel(void)
   case SOFTRF_MODE_NORMAL:
   default:
 
+    /* computed from the GNSS data in Time_loop() */
     now_ms = millis();
-    pps_btime_ms = SoC->get_PPS_TimeMarker();
-
-    if (pps_btime_ms) {
-      if (now_ms > pps_btime_ms + 1010)
-        pps_btime_ms += 1000;
-      uint32_t last_Commit_Time = now_ms - gnss.time.age();
-      if (pps_btime_ms <= last_Commit_Time) {
-        time_corr_neg = (last_Commit_Time - pps_btime_ms) % 1000;
-      } else {
-        time_corr_neg = 1000 - ((pps_btime_ms - last_Commit_Time) % 1000);
-      }
-      ref_time_ms = pps_btime_ms;
-    } else {
-      uint32_t last_RMC_Commit = now_ms - gnss.date.age();
-      time_corr_neg = 100;
-      if (gnss_chip)
-          time_corr_neg = gnss_chip->rmc_ms;
-      ref_time_ms = last_RMC_Commit - time_corr_neg;
-    }
+    Time_Snapshot(&Time, &ref_ms);
 
-    int yr    = gnss.date.year();
-    if( yr > 99)
-        yr    = yr - 1970;
-    else
-        yr    += 30;
-    tm.Year   = yr;
-    tm.Month  = gnss.date.month();
-    tm.Day    = gnss.date.day();
-    tm.Hour   = gnss.time.hour();
-    tm.Minute = gnss.time.minute();
-    tm.Second = gnss.time.second();
-
-//  Time = makeTime(tm) + (gnss.time.age() - time_corr_neg) / 1000;
-    Time = makeTime(tm) + (gnss.time.age() + time_corr_neg) / 1000;
-    OurTime = Time;
+    /* the radio task does not wait for the main loop to come round */
+    while (ref_ms != 0 && now_ms > ref_ms + 1010) {
+      ref_ms += 1000;
+      Time   += 1;
+    }
 
     break;
   }
@@ -2171,11 +2205,11 @@ void RF_SetChannel(void)
   {
   case RF_TIMING_2SLOTS_PPS_SYNC:
     if ((now_ms - ts->s0.tmarker) >= ts->interval_mid) {
-      ts->s0.tmarker = ref_time_ms + ts->s0.begin - ts->adj;
+      ts->s0.tmarker = ref_ms + ts->s0.begin - ts->adj;
       ts->current = 0;
     }
     if ((now_ms - ts->s1.tmarker) >= ts->interval_mid) {
-      ts->s1.tmarker = ref_time_ms + ts->s1.begin;
+      ts->s1.tmarker = ref_ms + ts->s1.begin;
       ts->current = 1;
     }
     Slot = ts->current;
@@ -2202,8 +2236,50 @@ void RF_SetChannel(void)
   }
 }
 
+static uint32_t RF_schedule_time = 0;
+
+#if defined(USE_RF_TASK)
+/*
+ * Optional radio task, pinned to the core the Arduino loop() does not use.
+ * It runs RF_loop(), RF_Receive() and protocol_decode(), and sends what it
+ * heard to the main loop through a single producer, single consumer ring.
+ * The main loop still encodes (the encoders compare against &ThisAircraft),
+ * RF_Encode() and RF_Transmit() hand the packet over in a one entry mailbox.
+ * Its timing goes to the PROF_TASK_* stages.
+ */
+#define RF_TASK_STACK_SIZE      4096
+#define RF_TASK_PRIORITY        3
+#define RF_TASK_CORE            0
+#define RF_TASK_QUEUE_SIZE      8           /* power of 2 */
+
+static TaskHandle_t RF_Task_Handle = NULL;
+static volatile bool RF_Task_running = false;
+
+static rf_rx_t RF_Task_Queue[RF_TASK_QUEUE_SIZE];
+static volatile uint8_t RF_Task_Queue_head = 0;   /* written by the task only */
+static volatile uint8_t RF_Task_Queue_tail = 0;   /* written by the main loop only */
+
+static byte RF_Task_TxStage[MAX_PKT_SIZE] __attribute__((aligned(sizeof(uint32_t))));
+static byte RF_Task_TxMail[MAX_PKT_SIZE]  __attribute__((aligned(sizeof(uint32_t))));
+static volatile size_t RF_Task_TxMail_size = 0;   /* non-zero while pending */
+static bool     RF_Task_TxMail_wait;
+static uint8_t  RF_Task_TxMail_protocol;
+static uint32_t RF_Task_TxMail_until;
+
+/* true when called from the main loop while the task owns the radio */
+static inline bool RF_Task_Off()
+{
+  return (RF_Task_running && xTaskGetCurrentTaskHandle() != RF_Task_Handle);
+}
+#endif /* USE_RF_TASK */
+
 void RF_loop()
 {
+#if defined(USE_RF_TASK)
+  if (RF_Task_Off())
+    return;
+#endif /* USE_RF_TASK */
+
   if (!RF_ready) {
     if (RF_FreqPlan.Plan == RF_BAND_AUTO) {
       if (ThisAircraft.latitude || ThisAircraft.longitude) {
@@ -2219,8 +2295,9 @@ void RF_loop()
 
   /* Experimental code by Moshe Braner, specific to Legacy Protocol */
   /* More correct on frequency hopping & time slots, and uses less CPU time */
-  /* - requires OurTime to be set to UTC time in seconds - can do in Time_loop() */
+  /* - requires OurTime to be set to UTC time in seconds - done in Time_loop() */
   /* - also needs time since PPS, it is stored in ref_time_ms */
+  /* - both only read here, Time_loop() may run on the other core */
 
   if (settings->rf_protocol != RF_PROTOCOL_LEGACY
    && settings->rf_protocol != RF_PROTOCOL_LATEST
@@ -2229,28 +2306,30 @@ void RF_loop()
     return;
   }
 
-  if (ref_time_ms == 0)   /* no GNSS time yet */
+  time_t   our_time;
+  uint32_t ref_ms;
+  Time_Snapshot(&our_time, &ref_ms);   // may have been updated in Time_loop since last RF_loop
+
+  if (ref_ms == 0)        /* no GNSS time yet */
     return;
 
   uint32_t now_ms = millis();
 
-  RF_time = OurTime;      // may have been updated in Time_loop since last RF_loop
-
-  if (now_ms < ref_time_ms) {   /* should not happen */
-    --OurTime;
-    ref_time_ms -= 1000;
-    return;
+  if (now_ms < ref_ms) {        /* should not happen */
+    --our_time;
+    ref_ms -= 1000;
   }
 
-  uint32_t ms_since_pps = now_ms - ref_time_ms;
-  if (ms_since_pps >= 1300) {   // should not happen since Time_loop takes care of this
-    ++OurTime;
-    ++RF_time;
-    ref_time_ms += 1000;
+  uint32_t ms_since_pps = now_ms - ref_ms;
+  while (ms_since_pps >= 1300) {   // Time_loop has not caught up yet
+    ++our_time;
+    ref_ms += 1000;
     ms_since_pps -= 1000;
   }
 
-  uint32_t slot_base_ms = ref_time_ms;
+  RF_time = our_time;
+
+  uint32_t slot_base_ms = ref_ms;
   if (ms_since_pps < 300) {  /* does not happen often, since normally RF_OK_until 300 */
     /* channel does _NOT_ change at PPS rollover in middle of slot 1 */
     /* - therefore change the reference second to the previous one: */
@@ -2266,6 +2345,12 @@ void RF_loop()
     //  rf_chip->channel(RF_current_chan);
           // if the channel has not changed this does nothing
           // otherwise it calls os_radio(RADIO_RST) etc
+
+    /* nothing time critical now: prepare the next seconds */
+    if ((uint32_t) RF_time != RF_schedule_time) {
+      RF_Schedule_Fill((uint32_t) RF_time);
+      RF_schedule_time = (uint32_t) RF_time;
+    }
     return;
   }
 
@@ -2313,9 +2398,16 @@ void RF_loop()
     RF_OK_until = slot_base_ms + 1300;
     TxTimeMarker = RF_OK_until;          /* do not transmit for now */
     TxEndMarker  = RF_OK_until;
+#if defined(USE_RF_TASK)
+    Prof_Late_Shared(PROF_TASK_SLOT);    /* RF_loop() not called before 1200 ms */
+#endif /* USE_RF_TASK */
     return;
   }
 
+#if defined(USE_RF_TASK)
+  Prof_Add_Shared(PROF_TASK_SLOT, (ms_since_pps - (RF_current_slot ? 800 : 300)) * 1000);
+#endif /* USE_RF_TASK */
+
   // transmit one packet in altprotocol (OGNTP) protocol once every 16 seconds
   if (settings->altprotocol != RF_PROTOCOL_NONE
      /* which is only possible if:
@@ -2342,7 +2434,7 @@ void RF_loop()
 
   // do this in the main protocol, for reception
   uint8_t OGN = (settings->rf_protocol == RF_PROTOCOL_OGNTP ? 1 : 0);
-  RF_current_chan = RF_FreqPlan.getChannel((time_t)RF_time, RF_current_slot, OGN);
+  RF_current_chan = RF_Schedule_Channel((uint32_t)RF_time, RF_current_slot, OGN);
   if (rf_chip)
       rf_chip->channel(RF_current_chan);
 
@@ -2352,6 +2444,10 @@ void RF_loop()
 
 bool RF_Transmit_Ready()
 {
+#if defined(USE_RF_TASK)
+    if (RF_Task_Off() && RF_Task_TxMail_size != 0)
+        return false;                      // previous packet not sent yet
+#endif /* USE_RF_TASK */
     uint32_t now_ms = millis();
     if (! TxEndMarker)                     // for other protocols
         return (now_ms > TxTimeMarker);
@@ -2365,9 +2461,38 @@ bool RF_Transmit_Happened()
     return (TxTimeMarker == RF_OK_until);
 }
 
+/*
+ * When the main loop has to be back in RF_loop() for the next slot change,
+ * or in RF_Transmit() for a pending transmission, whichever comes first.
+ * 0 if there is no slot timing to keep (other protocols, no GNSS time yet,
+ * or the radio task keeps it).  Used by Sched to fit other work around it.
+ */
+uint32_t RF_Next_Deadline()
+{
+#if defined(USE_RF_TASK)
+    if (RF_Task_Off())
+        return 0;
+#endif /* USE_RF_TASK */
+    if (!RF_ready || ref_time_ms == 0 || RF_OK_until == 0 || TxEndMarker == 0)
+        return 0;
+    uint32_t deadline = RF_OK_until;
+    uint32_t now_ms = millis();
+    if (TxTimeMarker > now_ms && TxTimeMarker < deadline
+          && settings->txpower != RF_TX_POWER_OFF)
+        deadline = TxTimeMarker;
+    return deadline;
+}
+
 size_t RF_Encode(container_t *fop, bool wait)
 {
   size_t size = 0;
+  byte *buf = &TxBuffer[0];
+
+#if defined(USE_RF_TASK)
+  if (RF_Task_Off())
+    buf = &RF_Task_TxStage[0];             // TxBuffer belongs to the radio task
+#endif /* USE_RF_TASK */
+
   if (RF_ready && protocol_encode) {
 
     if (settings->txpower == RF_TX_POWER_OFF ) {
@@ -2396,13 +2521,13 @@ size_t RF_Encode(container_t *fop, bool wait)
         current_RF_protocol == RF_PROTOCOL_OGNTP) {
       if (RF_Transmit_Ready() || (!wait && !RF_Transmit_Happened())) {
           if (current_RF_protocol != settings->rf_protocol)
-              size = (*altprotocol_encode)((void *) &TxBuffer[0], fop);
+              size = (*altprotocol_encode)((void *) buf, fop);
           else
-              size = (*protocol_encode)((void *) &TxBuffer[0], fop);
+              size = (*protocol_encode)((void *) buf, fop);
       }
     } else {
       if (millis() > TxTimeMarker) {
-        size = (*protocol_encode)((void *) &TxBuffer[0], fop);
+        size = (*protocol_encode)((void *) buf, fop);
       }
     }
   }
@@ -2414,7 +2539,7 @@ void RF_chip_reset()
 #if !defined(EXCLUDE_SX12XX)
     sx12xx_setup();
     uint8_t OGN = (current_RF_protocol == RF_PROTOCOL_OGNTP ? 1 : 0);
-    RF_current_chan = RF_FreqPlan.getChannel((time_t)RF_time, RF_current_slot, OGN);
+    RF_current_chan = RF_Schedule_Channel((uint32_t)RF_time, RF_current_slot, OGN);
     sx12xx_channel(RF_current_chan);
 //Serial.printf("reset to Prot %d at millis %d, tx ok %d - %d, gd to %d\r\n",
 //OGN, millis(), TxTimeMarker, TxEndMarker, RF_OK_until);
@@ -2428,6 +2553,21 @@ bool RF_Transmit(size_t size, bool wait)   // only called with no-wait for air-r
     if (settings->txpower == RF_TX_POWER_OFF)
       return true;
 
+#if defined(USE_RF_TASK)
+    if (RF_Task_Off()) {
+      /* the task sends it, true here only means it has been handed over */
+      if (RF_Task_TxMail_size != 0)
+        return false;
+      memcpy(RF_Task_TxMail, RF_Task_TxStage, size);
+      RF_Task_TxMail_wait     = wait;
+      RF_Task_TxMail_protocol = current_RF_protocol;
+      RF_Task_TxMail_until    = (TxEndMarker ? RF_OK_until : millis());
+      __sync_synchronize();
+      RF_Task_TxMail_size     = size;
+      return true;
+    }
+#endif /* USE_RF_TASK */
+
     RF_tx_size = size;
 
     /* Experimental code by Moshe Braner, specific to Legacy Protocol */
@@ -2523,6 +2663,11 @@ bool RF_Receive(void)
 {
   bool rval = false;
 
+#if defined(USE_RF_TASK)
+  if (RF_Task_Off())
+    return false;                          // see RF_Task_Receive()
+#endif /* USE_RF_TASK */
+
   if (RF_ready && rf_chip) {
     rval = rf_chip->receive();
   }
@@ -2535,6 +2680,10 @@ bool RF_Receive(void)
 
 void RF_Shutdown(void)
 {
+#if defined(USE_RF_TASK)
+  RF_Task_fini();
+#endif /* USE_RF_TASK */
+
   if (rf_chip) {
     rf_chip->shutdown();
   }
@@ -2555,3 +2704,179 @@ uint8_t RF_Payload_Size(uint8_t protocol)
     default:                    return 0;
   }
 }
+
+#if defined(USE_RF_TASK)
+/* the decoders that write NMEA debug sentences or the flight log stay on the main loop */
+static bool RF_Task_Can_Decode(const uint8_t *raw)
+{
+  if ((settings->debug_flags & DEBUG_LEGACY) && (settings->nmea_d || settings->nmea2_d))
+    return false;
+
+  /* the header is not encrypted, only the "latest" packets are quiet */
+  if (settings->rf_protocol == RF_PROTOCOL_LEGACY ||
+      settings->rf_protocol == RF_PROTOCOL_LATEST)
+    return (((const legacy_packet_t *) raw)->msg_type == 2);
+
+  return true;
+}
+
+static void RF_Task_Decode(void)
+{
+  uint8_t head = RF_Task_Queue_head;
+  uint32_t buf[(sizeof(RF_Task_Queue[0].raw) + 3) / 4];
+
+  if ((uint8_t) (head - RF_Task_Queue_tail) >= RF_TASK_QUEUE_SIZE) {
+    Prof_Late_Shared(PROF_TASK_DECODE);  /* queue full */
+    return;
+  }
+
+  rf_rx_t *rp = &RF_Task_Queue[head & (RF_TASK_QUEUE_SIZE - 1)];
+  size_t rx_size = RF_Payload_Size(settings->rf_protocol);
+  rx_size = rx_size > sizeof(rp->raw) ? sizeof(rp->raw) : rx_size;
+
+  memcpy(rp->raw, RxBuffer, rx_size);
+  rp->size        = rx_size;
+  rp->rssi        = RF_last_rssi;
+  rp->crc         = RF_last_crc;
+  rp->repaired    = RF_last_repaired;
+  RF_last_repaired = false;
+  rp->timestamp   = now();
+  rp->callsign[0] = '\0';
+
+  if (memcmp(RxBuffer, TxBuffer, rx_size) == 0) {
+    rp->status = RF_RX_LOOPBACK;
+  } else if (protocol_decode == NULL) {
+    rp->status = RF_RX_REJECTED;
+  } else {
+    memcpy(buf, RxBuffer, rx_size);       /* decoders decrypt in place */
+    if (! RF_Task_Can_Decode((const uint8_t *) buf)) {
+      rp->status = RF_RX_UNDECODED;
+    } else {
+      EmptyFO(&rp->fo);
+      if ((*protocol_decode)((void *) buf, &ThisAircraft, &rp->fo)) {
+        if (rp->fo.tx_type == TX_TYPE_NONE)
+          rp->fo.tx_type = TX_TYPE_FLARM;
+        if (settings->rf_protocol == RF_PROTOCOL_ADSB_UAT)
+          memcpy(rp->callsign, fo_callsign, sizeof(rp->callsign));
+        rp->status = RF_RX_DECODED;
+      } else {
+        rp->status = RF_RX_REJECTED;
+      }
+    }
+  }
+
+  __sync_synchronize();
+  RF_Task_Queue_head = head + 1;
+}
+
+static void RF_Task_Transmit(void)
+{
+  size_t size = RF_Task_TxMail_size;
+  bool sent = false;
+
+  __sync_synchronize();
+  if (RF_Task_TxMail_protocol == current_RF_protocol) {
+    memcpy(TxBuffer, RF_Task_TxMail, size);
+    sent = RF_Transmit(size, RF_Task_TxMail_wait);
+  }
+
+  if (sent) {
+    RF_Task_TxMail_size = 0;
+  } else if (RF_Task_TxMail_protocol != current_RF_protocol ||
+             (int32_t) (millis() - RF_Task_TxMail_until) >= 0) {
+    Prof_Late_Shared(PROF_TASK_TX);      /* slot over before sent */
+    RF_Task_TxMail_size = 0;
+  }
+}
+
+static void RF_Task(void *parameter)
+{
+  uint32_t t0, t1;
+
+  while (RF_Task_running) {
+    t0 = micros();
+    RF_loop();
+    t1 = micros();
+    Prof_Add_Shared(PROF_TASK_RF, t1 - t0);
+
+    if (RF_Task_TxMail_size != 0) {
+      RF_Task_Transmit();
+      t0 = micros();
+      Prof_Add_Shared(PROF_TASK_TX, t0 - t1);
+      t1 = t0;
+    }
+
+    bool success = RF_Receive();
+    t0 = micros();
+    Prof_Add_Shared(PROF_TASK_RX, t0 - t1);
+
+    if (success) {
+      RF_Task_Decode();
+      Prof_Add_Shared(PROF_TASK_DECODE, micros() - t0);
+    }
+
+    vTaskDelay(1);
+  }
+
+  RF_Task_Handle = NULL;
+  vTaskDelete(NULL);
+}
+
+bool RF_Task_setup(void)
+{
+  if (RF_Task_running || rf_chip == NULL ||
+      settings->mode != SOFTRF_MODE_NORMAL ||
+      (settings->debug_flags & DEBUG_SIMULATE))
+    return false;
+
+  if (settings->sd_card == SD_CARD_LORA) {
+    /* the SD card would share the SPI bus with the radio, from the other core */
+    Serial.println(F("RF task is not used with the SD card on the radio SPI bus"));
+    return false;
+  }
+
+  RF_Task_running = true;
+  if (xTaskCreatePinnedToCore(RF_Task, "RF", RF_TASK_STACK_SIZE, NULL,
+                              RF_TASK_PRIORITY, &RF_Task_Handle,
+                              RF_TASK_CORE) != pdPASS) {
+    RF_Task_running = false;
+    RF_Task_Handle  = NULL;
+    Serial.println(F("RF task could not be started"));
+    return false;
+  }
+
+  Serial.println(F("RF task started"));
+  return true;
+}
+
+void RF_Task_fini(void)
+{
+  if (! RF_Task_running)
+    return;
+
+  RF_Task_running = false;
+  for (int i = 0; i < 100 && RF_Task_Handle != NULL; i++)
+    delay(1);                             /* let it finish the current pass */
+}
+
+bool RF_Task_Active(void)
+{
+  return RF_Task_running;
+}
+
+/* called from the main loop: the next packet heard by the task, if any */
+bool RF_Task_Receive(rf_rx_t *rxp)
+{
+  uint8_t tail = RF_Task_Queue_tail;
+
+  if (tail == RF_Task_Queue_head)
+    return false;
+
+  __sync_synchronize();
+  memcpy(rxp, &RF_Task_Queue[tail & (RF_TASK_QUEUE_SIZE - 1)], sizeof(rf_rx_t));
+  __sync_synchronize();
+  RF_Task_Queue_tail = tail + 1;
+
+  return true;
+}
+#endif /* USE_RF_TASK */
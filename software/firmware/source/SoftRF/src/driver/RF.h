@@ -115,12 +115,41 @@ void    RF_SetChannel(void);
 void    RF_loop(void);
 bool    RF_Transmit_Ready();
 bool    RF_Transmit_Happened();
+uint32_t RF_Next_Deadline(void);
 size_t  RF_Encode(container_t *cip, bool wait=true);
 bool    RF_Transmit(size_t size, bool wait=true);
 bool    RF_Receive(void);
 void    RF_Shutdown(void);
 uint8_t RF_Payload_Size(uint8_t);
 
+#if defined(USE_RF_TASK)
+/* packets received by the radio task, in the order heard */
+enum
+{
+  RF_RX_LOOPBACK,                 /* own transmission */
+  RF_RX_UNDECODED,                /* left to protocol_decode() on the main loop */
+  RF_RX_REJECTED,                 /* protocol_decode() returned false */
+  RF_RX_DECODED
+};
+
+typedef struct rf_rx_struct {
+  ufo_t    fo;
+  uint8_t  raw[34];               /* as fo_raw[] */
+  uint8_t  size;
+  uint8_t  status;
+  int8_t   rssi;
+  uint16_t crc;                   /* RF_last_crc */
+  bool     repaired;              /* RF_last_repaired */
+  time_t   timestamp;
+  char     callsign[10];
+} rf_rx_t;
+
+bool    RF_Task_setup(void);
+void    RF_Task_fini(void);
+bool    RF_Task_Active(void);
+bool    RF_Task_Receive(rf_rx_t *);
+#endif /* USE_RF_TASK */
+
 extern byte TxBuffer[MAX_PKT_SIZE], RxBuffer[MAX_PKT_SIZE];
 extern uint32_t TxTimeMarker;
 extern uint32_t TxEndMarker;
@@ -135,6 +164,7 @@ extern bool (*protocol_decode)(void *, container_t *, ufo_t *);
 
 extern const char *Protocol_ID[];
 extern uint16_t RF_last_crc;
+extern bool RF_last_repaired;
 extern int8_t RF_last_rssi;
 extern int8_t which_rx_try;
 
@@ -162,6 +162,7 @@ static void init_stgdesc()
   stgdesc[STG_GDL90_IN]   = { "gdl90_in",   (char*)&settings->gdl90_in,   esp_only(STG_UINT1) };
   stgdesc[STG_GDL90]      = { "gdl90",      (char*)&settings->gdl90,      STG_UINT1 };
   stgdesc[STG_D1090]      = { "d1090",      (char*)&settings->d1090,      STG_UINT1 };
+  stgdesc[STG_D1090_FMT]  = { "d1090_fmt",  (char*)&settings->d1090_fmt,  STG_UINT1 };
   stgdesc[STG_RELAY]      = { "relay",      (char*)&settings->relay,      STG_UINT1 };
   stgdesc[STG_EXPIRE]     = { "expire",     (char*)&settings->expire,     STG_INT1 };
   stgdesc[STG_PFLAA_CS]   = { "pflaa_cs",   (char*)&settings->pflaa_cs,   STG_UINT1 };
@@ -216,7 +217,7 @@ static void init_stgdesc()
   stgcomment[STG_BAND]       = "1=EU 2=US ...";
   stgcomment[STG_ACFT_TYPE]  = "1=GL 2=TOWPL 6=HG 7=PG 0=landed out";
   stgcomment[STG_ID_METHOD]  = "1=ICAO 2=device";
-  stgcomment[STG_ALARM]      = "3=Latest 2=Vector 1=Dist";
+  stgcomment[STG_ALARM]      = "3=Latest 4=CPA 2=Vector 1=Dist";
   stgcomment[STG_HRANGE]     = "km";
   stgcomment[STG_VRANGE]     = "x100m";
   stgcomment[STG_TXPOWER]    = "0=off 1=low 2=full";
@@ -247,6 +248,7 @@ static void init_stgdesc()
 //stgcomment[STG_GDL90_IN]   = destinations;
 //stgcomment[STG_GDL90]      = destinations;
 //stgcomment[STG_D1090]      = destinations;
+  stgcomment[STG_D1090_FMT]  = "0=text 1=Beast binary";
   stgcomment[STG_RELAY]      = "0=off 1=landed 2=ADS-B 3=only";
   stgcomment[STG_EXPIRE]     = "secs no-rx report 1-30";
   stgcomment[STG_PFLAA_CS]   = yesno;
@@ -878,6 +880,7 @@ void Settings_defaults(bool keepsome)
   settings->hrange1090  = 27;   // km
   settings->vrange1090  = 20;   // 2000m
   settings->compflash   = false;
+  settings->d1090_fmt   = D1090_FMT_TEXT;
   settings->expire      = EXPORT_EXPIRATION_TIME;   // 5 secs
   settings->pflaa_cs    = true;
   settings->leapsecs    = 18;   // <<< hardcoded!
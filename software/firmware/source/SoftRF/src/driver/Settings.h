@@ -108,6 +108,12 @@ enum
 	BAUD_2000000 = 7
 };
 
+enum
+{
+	D1090_FMT_TEXT=0,   // "*<hex>;" lines, as on the dump1090 raw port
+	D1090_FMT_BEAST     // binary, as on the dump1090 Beast port
+};
+
 enum
 {
 	TCP_MODE_SERVER=0,
@@ -205,6 +211,7 @@ enum stgidx {
 //#endif
     STG_GDL90,
     STG_D1090,
+    STG_D1090_FMT,
     STG_RELAY,
     STG_EXPIRE,
     STG_PFLAA_CS,
@@ -382,6 +389,7 @@ typedef struct Settings {
     bool     no_track;
     uint8_t  gdl90;         // output destination
     uint8_t  d1090;
+    uint8_t  d1090_fmt;     // text or binary (Beast)
     //uint8_t  json;
     int8_t   geoid;
     int8_t   leapsecs;
@@ -51,8 +51,6 @@ void  Voice_fini()        {}
 
 #include "../protocol/data/NMEA.h"
 
-extern bool loopTaskWDTEnabled;
-
 static uint32_t VoiceTimeMarker = 0;
 
 bool invert = false;
@@ -123,28 +121,57 @@ static bool setup_i2s()
   return true;
 }
 
-static uint8_t sample[4] = {0,0,0,0};
-
-// a wrapper for i2s_write() that handles buffer-overflow
-static void i2s_writesample()
+/*
+ * The words are played by a task of their own, so that the main loop is not
+ * held up while an alarm is spoken: Voice_Notify() only queues the message,
+ * the task feeds the I2S DMA buffers in blocks and sleeps while they are full.
+ */
+#define VOICE_QUEUE_LEN   4      // messages
+#define VOICE_MSG_LEN     48
+#define VOICE_BLOCK       256    // samples per i2s_write()
+#define VOICE_DRAIN_MS    (dmabufcount*dmabuflen/8)   // all DMA buffers at 8 kHz
+#define VOICE_STACK_SIZE  3072
+#define VOICE_PRIORITY    2
+#define VOICE_CORE        0      // the Arduino loop() runs on core 1
+
+static QueueHandle_t Voice_Queue = NULL;
+static TaskHandle_t  Voice_Task_Handle = NULL;
+static volatile bool Voice_running = false;
+static volatile bool Voice_busy = false;     // a message is being played
+
+static uint8_t frames[VOICE_BLOCK*4];        // 16-bit left & right per sample
+
+// send n samples from frames[] to I2S, sleeps while the DMA buffers are full
+static void i2s_writeframes(int n)
 {
-  char *data = (char *) sample;
   size_t written;
-  i2s_write(i2s_num, (const char *)data, 4, &written, 100);
-  if (written < 4) {
-      //yield();
-      delay(128);
-      i2s_write(i2s_num, (const char *)(data+written), 4-written, &written, 100);
+  i2s_write(i2s_num, (const char *) frames, n*4, &written, portMAX_DELAY);
+}
+
+static void setframe(int j, uint8_t data)
+{
+  frames[4*j] = frames[4*j+2] = 0;
+  frames[4*j+1] = frames[4*j+3] = data;
+}
+
+// ramp up or down to reduce click
+static void ramp(bool up)
+{
+  for (int i=0; i<1024; i+=VOICE_BLOCK) {
+    for (int j=0; j<VOICE_BLOCK; j++)
+      setframe(j, (up ? (i+j) : (1024-i-j)) >> 3);
+    i2s_writeframes(VOICE_BLOCK);
   }
 }
 
 // send silent "word" to I2S
 static void silence()
 {
-  sample[1] = sample[3] = (settings->voice==VOICE_INT? 128 : 0);
+  for (int j=0; j<VOICE_BLOCK; j++)
+    setframe(j, (settings->voice==VOICE_INT? 128 : 0));
   int size = 6*1024;  // 750 mS
-  while (size-- > 0)
-    i2s_writesample();
+  for ( ; size > 0; size -= VOICE_BLOCK)
+    i2s_writeframes(VOICE_BLOCK);
 }
 
 static bool play_i2s(const char *word)
@@ -154,13 +181,8 @@ static bool play_i2s(const char *word)
 
   bool internal_dac = (settings->voice == VOICE_INT);
 
-  // ramp up to reduce click
-  if (internal_dac) {
-    for (int i=0; i<1024; i++) {
-       sample[1] = sample[3] = (i >> 3);
-       i2s_writesample();
-    }
-  }
+  if (internal_dac)
+    ramp(true);
 
   bool is_a_file = true;
 
@@ -171,59 +193,52 @@ static bool play_i2s(const char *word)
 
   } else {
 
-    bool wdt_status = loopTaskWDTEnabled;
-    if (wdt_status)
-      disableLoopWDT();
-
     if (word2wav(word) == false)
        is_a_file = false;  // playing the default WAV
 
-    int size = 32000;
-    while (size-- > 0) {
-        uint8_t data;
-        if (read_wav_byte(data) == 0)    // EOF
-            break;
-        if (internal_dac) {
-           // Need to shift 8-bit samples into MSB of 16-bit ints.
-           sample[1] = sample[3] = data;
-        } else {
-           // For external I2S convert from 8-bit unsigned to 16-bit signed.
-           sample[1] = sample[3] = (data ^ 0x80);
-        }
-        i2s_writesample();
+    // Need to shift 8-bit samples into MSB of 16-bit ints.
+    // For external I2S convert from 8-bit unsigned to 16-bit signed.
+    uint8_t flip = (internal_dac ? 0 : 0x80);
+    uint8_t data[VOICE_BLOCK];
+    int n;
+    while ((n = read_wav(data, VOICE_BLOCK)) > 0) {
+        for (int j=0; j<n; j++)
+            setframe(j, data[j] ^ flip);
+        i2s_writeframes(n);
     }
-
-    if (wdt_status)
-      enableLoopWDT();
   }
 
-  // ramp down to reduce click
-  if (internal_dac) {
-    for (int i=1024; i>0; i--) {
-       sample[1] = sample[3] = (i >> 3);
-       i2s_writesample();
-    }
-  }
-
-  delay(dmabufsize/32);    // wait long enough for the buffer to be flushed
+  if (internal_dac)
+    ramp(false);
 
   return is_a_file;
 }
 
-static void TTS(const char *msg)
+static void Voice_Task(void *parameter)
 {
-    if (SOC_GPIO_PIN_VOICE == SOC_UNUSED_PIN)
-      return;
-
-    i2s_set_dac_mode(I2S_DAC_CHANNEL_RIGHT_EN);    // enable audio output via GPIO 25 DAC
-
-    VoiceTimeMarker = millis();
+  char message[VOICE_MSG_LEN];
+  bool dac_on = false;
+
+  while (Voice_running) {
+
+    // after a message keep the DAC on until the DMA buffers have played out,
+    // unless the next message follows
+    if (xQueueReceive(Voice_Queue, message,
+          (dac_on ? pdMS_TO_TICKS(VOICE_DRAIN_MS) : portMAX_DELAY)) != pdTRUE) {
+        i2s_set_dac_mode(I2S_DAC_CHANNEL_DISABLE);
+        dac_on = false;
+        continue;
+    }
+    if (! Voice_running)
+        break;
 
-    char message[80];
-    strcpy(message, msg);
+    Voice_busy = true;
+    if (! dac_on) {
+        i2s_set_dac_mode(I2S_DAC_CHANNEL_RIGHT_EN);  // enable audio output via GPIO 25 DAC
+        dac_on = true;
+    }
 
     char *word = strtok (message, " ");
-
     while (word != NULL)
     {
         bool is_a_file = play_i2s(word);
@@ -233,8 +248,34 @@ static void TTS(const char *msg)
     }
 
     (void) play_i2s(NULL);   // silence "word"
-    delay(dmabufsize/32);    // wait for the buffer to be flushed (again)
+
+    if (uxQueueMessagesWaiting(Voice_Queue) == 0)
+        Voice_busy = false;
+  }
+
+  if (dac_on)
     i2s_set_dac_mode(I2S_DAC_CHANNEL_DISABLE);
+  Voice_Task_Handle = NULL;
+  vTaskDelete(NULL);
+}
+
+static bool TTS(const char *msg)
+{
+    if (SOC_GPIO_PIN_VOICE == SOC_UNUSED_PIN)
+      return false;
+
+    if (Voice_Queue == NULL)
+      return false;
+
+    char message[VOICE_MSG_LEN];
+    strncpy(message, msg, sizeof(message));
+    message[sizeof(message)-1] = '\0';
+
+    if (xQueueSend(Voice_Queue, message, 0) != pdTRUE)
+      return false;
+
+    VoiceTimeMarker = millis();
+    return true;
 }
 
 void Voice_test(int reason)
@@ -247,8 +288,7 @@ void Voice_test(int reason)
         reason == REASON_EXT_SYS_RST ||
         reason == REASON_SOFT_RESTART) {
          TTS("traffic eleven high");
-         delay(3000);
-         TTS("danger ahead level");
+         TTS("danger ahead level");     // queued, follows after the silence
     } else if (reason == REASON_WDT_RST) {
          TTS("high low high");
     } else {
@@ -256,7 +296,7 @@ void Voice_test(int reason)
     }
 }
 
-static void Traffic_Voice_Msg(container_t *fop, bool multi_alarm)
+static bool Traffic_Voice_Msg(container_t *fop, bool multi_alarm)
 {
     int oclock = fop->RelativeHeading + 15;
     if (oclock < 0)     oclock += 360;
@@ -314,7 +354,7 @@ static void Traffic_Voice_Msg(container_t *fop, bool multi_alarm)
         (fop->adj_alt_diff > 0 ? "high" : fop->adj_alt_diff < 0 ? "low" : "level"),
         (multi_alarm? " traffic" : ""));
 
-    TTS(message);
+    return TTS(message);
 }
 
 void Voice_setup(void)
@@ -353,6 +393,19 @@ void Voice_setup(void)
 
   if (num_wav_files < 17)      // have not successfully read WAV data from SPIFFS yet
     parse_wav_tar();           // then try and do that
+
+  Voice_Queue = xQueueCreate(VOICE_QUEUE_LEN, VOICE_MSG_LEN);
+  if (Voice_Queue == NULL)
+    return;
+  Voice_running = true;
+  if (xTaskCreatePinnedToCore(Voice_Task, "Voice", VOICE_STACK_SIZE, NULL,
+                              VOICE_PRIORITY, &Voice_Task_Handle, VOICE_CORE) != pdPASS) {
+     Serial.println(F("Voice task failed, no voice"));
+     Voice_running = false;
+     Voice_Task_Handle = NULL;
+     vQueueDelete(Voice_Queue);
+     Voice_Queue = NULL;
+  }
 }
 
 bool Voice_Notify(container_t *fop, bool multi_alarm)
@@ -366,22 +419,44 @@ bool Voice_Notify(container_t *fop, bool multi_alarm)
   if (fop->alarm_level < ALARM_LEVEL_LOW)
       return false;
 
-  Traffic_Voice_Msg(fop, multi_alarm);
-
-  return true;
+  return Traffic_Voice_Msg(fop, multi_alarm);
 }
 
 void Voice_loop(void)
 {
-  if (VoiceTimeMarker != 0 && millis() - VoiceTimeMarker > VOICEMS) {
+  // the next notification may follow once the previous one has been spoken
+  if (VoiceTimeMarker != 0 && millis() - VoiceTimeMarker > VOICEMS
+        && Voice_busy == false && uxQueueMessagesWaiting(Voice_Queue) == 0) {
       VoiceTimeMarker = 0;
   }
 }
 
+// drop the queued messages and let the one playing finish, before waves.tar changes
+void Voice_flush(void)
+{
+  if (Voice_Task_Handle == NULL)
+      return;
+  xQueueReset(Voice_Queue);
+  for (int i=0; i<3000 && Voice_busy; i++)
+      delay(1);
+}
+
 void Voice_fini(void)
 {
   VoiceTimeMarker = 0;
-  if (i2s_installed) {
+  if (Voice_Task_Handle != NULL) {
+      char message[VOICE_MSG_LEN] = "";
+      Voice_running = false;
+      xQueueReset(Voice_Queue);
+      xQueueSend(Voice_Queue, message, 0);    // wake it up
+      for (int i=0; i<3000 && Voice_Task_Handle != NULL; i++)
+          delay(1);                           // let it finish the current word
+  }
+  if (Voice_Queue != NULL && Voice_Task_Handle == NULL) {
+      vQueueDelete(Voice_Queue);
+      Voice_Queue = NULL;
+  }
+  if (i2s_installed && Voice_Task_Handle == NULL) {
       // stop & destroy i2s driver
       i2s_driver_uninstall(i2s_num);
       i2s_installed = false;
@@ -29,6 +29,7 @@ void Voice_setup(void);
 void Voice_test(int);
 bool Voice_Notify(container_t *, bool);
 void Voice_loop(void);
+void Voice_flush(void);
 void Voice_fini(void);
 
 // these are in waves.cpp:
@@ -36,7 +37,7 @@ extern int num_wav_files;
 void clear_waves(void);
 int parse_wav_tar(void);
 bool word2wav(const char *word);
-int read_wav_byte(uint8_t &data);
+int read_wav(uint8_t *buf, int len);
 
 #endif /* ESP32 */
 #endif /* EXCLUDE_VOICE */
@@ -8,6 +8,7 @@
 #include "../../SoftRF.h"
 #include "../system/SoC.h"
 #include "Filesys.h"
+#include "Settings.h"
 #include "Voice.h"
 
 //#include "SPIFFS.h"
@@ -201,47 +202,27 @@ const uint8_t defaultwav[DEFAULTSIZE] PROGMEM = {
 127,128,128,127,127,129,127,127,128,128,127,128,128,128,127,127,129,127
 };
 
-// these will be offsets into the waves.tar file:
-static uint32_t offsets[17] = {
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0
-};
+/*
+ * Index of the words found in waves.tar, built once by parse_wav_tar().
+ * As many clips as fit are also kept in memory, in the order of words[]
+ * (the most used ones first): all of them with PSRAM, else WAV_CACHE_RAM
+ * bytes worth.  The others are read from the file in WAV_BLOCK chunks.
+ */
+#define TAR_BLOCK      512
+#define WAV_BLOCK      (2*TAR_BLOCK)
+#define WAV_CACHE_RAM  (16*1024)    /* without PSRAM */
 
-// these will be the file sizes in the waves.tar file:
-static int wavsize[17] = {
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0
-};
+typedef struct {
+    uint32_t offset;          // of the samples in waves.tar, 0 if not found
+    int size;                 // number of samples
+    const uint8_t *data;      // cached samples, or NULL
+} wav_clip_t;
+
+static wav_clip_t clips[17];
+
+static uint8_t *wav_pool = NULL;      // allocated once, clips point into it
+static size_t wav_pool_size = 0;
+static size_t wav_pool_used = 0;
 
 static const char *words[17] PROGMEM = {
     "traffic",
@@ -266,97 +247,178 @@ static const char *words[17] PROGMEM = {
 // public
 int num_wav_files = 0;
 
+static uint32_t wordoffset = 0;
+static int wordsize = 0;
+static const uint8_t *wordp = NULL;   // default or cached samples
+static File tarfile;
+static uint8_t wavblock[WAV_BLOCK];
+static int blocklen = 0;
+static int blockpos = 0;
+static int blockskip = 0;
+static const char *wordname = NULL;
+static const char *wordsrc = NULL;
+static uint32_t word_us = 0;          // when word2wav() was called
+
+/*
+ * The voice task plays the words, the web server may clear them
+ * (waves.tar upload, SPIFFS format) from the main loop meanwhile.
+ * Created by the first clear_waves(), in parse_wav_tar() from
+ * Voice_setup(), before the voice task starts.
+ */
+static SemaphoreHandle_t wav_mutex = NULL;
+
+static void wav_lock()
+{
+    if (wav_mutex == NULL)
+        wav_mutex = xSemaphoreCreateMutex();
+    if (wav_mutex != NULL)
+        xSemaphoreTake(wav_mutex, portMAX_DELAY);
+}
+
+static void wav_unlock()
+{
+    if (wav_mutex != NULL)
+        xSemaphoreGive(wav_mutex);
+}
+
 // public
 void clear_waves()
 {
+    wav_lock();
+    // stop the word being played, the pool is kept for parse_wav_tar()
+    if (wordoffset > 0)
+        tarfile.close();
+    wordoffset = 0;
+    wordsize = 0;
+    wordp = NULL;
     for (int i=0; i<17; i++) {
-       offsets[i] = 0;
-       wavsize[i] = 0;
+       clips[i].offset = 0;
+       clips[i].size = 0;
+       clips[i].data = NULL;
     }
     num_wav_files = 0;
+    wav_pool_used = 0;
+    wav_unlock();
 }
 
-static uint32_t wordoffset = 0;
-static int wordsize = 0;
-static const uint8_t *defaultp = NULL;
-static File tarfile;
-
-// public
-bool word2wav(const char *word) {
+static bool word2wav_locked(const char *word) {
 
     if (wordoffset > 0)
         tarfile.close();
     wordoffset = 0;
     wordsize = 0;
-    defaultp = NULL;
+    wordp = NULL;
+    word_us = micros();
+    wordname = word;
 
     if (num_wav_files == 0) {
         Serial.println("word2wav: no WAV files");
-        defaultp = defaultwav;
+        wordp = defaultwav;
         wordsize = DEFAULTSIZE;
+        wordsrc = "default";
         return false;
     }
 
     for (int i=0; i<17; i++) {
-        if (strcmp(word,words[i])==0 && offsets[i] > 0) {
+        if (strcmp(word,words[i])==0 && clips[i].offset > 0) {
+            if (clips[i].data != NULL) {
+                wordp = clips[i].data;
+                wordsize = clips[i].size;
+                wordsrc = "RAM";
+                return true;
+            }
             tarfile = FILESYS.open("/waves.tar", "r");
             if (!tarfile) {
                 Serial.println(F("Failed to open waves.tar"));
                 break;
             }
-            uint32_t offset = offsets[i];
-            if (! tarfile.seek(offset, SeekSet)) {
+            // read whole blocks, from the start of the tar block
+            uint32_t offset = clips[i].offset;
+            if (! tarfile.seek(offset & ~(TAR_BLOCK-1), SeekSet)) {
                 Serial.println(F("Failed to fseek to wav position"));
                 tarfile.close();
                 break;
             }
+            blocklen = blockpos = 0;
+            blockskip = (offset & (TAR_BLOCK-1));
             wordoffset = offset;
-            wordsize = wavsize[i];
-            Serial.printf("word2wav: '%s' found -> %d bytes\n", word, wordsize);
+            wordsize = clips[i].size;
+            wordsrc = "file";
             return true;
         }
     }
 
     Serial.printf("word2wav: '%s' not found\n", word);
-    defaultp = defaultwav;
+    wordp = defaultwav;
     wordsize = DEFAULTSIZE;
+    wordsrc = "default";
     return false;
 }
 
-// public: read one byte from WAV file
-//  - at EOF returns false
-int read_wav_byte(uint8_t &data)
+// public
+bool word2wav(const char *word) {
+    wav_lock();
+    bool rval = word2wav_locked(word);
+    wav_unlock();
+    return rval;
+}
+
+// public: read up to len bytes of the current word
+//  - returns the number of bytes read, 0 at EOF
+int read_wav(uint8_t *buf, int len)
 {
-    int rval = 0;
+    int n = 0;
+
+    wav_lock();
 
-    if (wordsize <= 0)
+    if (len > wordsize)
+        len = wordsize;
+    if (len <= 0) {
+        wav_unlock();
         return 0;
+    }
 
-    if (defaultp != NULL) {   // playing the default built-in word
-        data = *defaultp++;
-        --wordsize;
-        rval = -1;
+    if (wordp != NULL) {   // playing the default built-in word, or a cached one
+        memcpy_P(buf, wordp, len);
+        wordp += len;
+        n = len;
     } else if (wordoffset > 0) {    // playing a file
-        if (tarfile.available()) {
-            data = tarfile.read();
-            --wordsize;
-            rval = 1;
-        } else {
-            wordsize = 0;
+        while (n < len) {
+            if (blockpos >= blocklen) {
+                blocklen = tarfile.read(wavblock, WAV_BLOCK);
+                blockpos = blockskip;
+                blockskip = 0;
+                if (blocklen <= blockpos)
+                    break;
+            }
+            int k = blocklen - blockpos;
+            if (k > len - n)
+                k = len - n;
+            memcpy(buf + n, wavblock + blockpos, k);
+            blockpos += k;
+            n += k;
         }
-    } else {
-        wordsize = 0;
     }
 
+    if (word_us != 0) {
+        if (settings->debug_flags & DEBUG_DEEPER)
+            Serial.printf("word2wav: '%s' %d bytes from %s, first sample after %lu us\n",
+                wordname, wordsize, wordsrc, (unsigned long) (micros() - word_us));
+        word_us = 0;
+    }
+
+    wordsize = (n < len ? 0 : wordsize - n);
+
     if (wordsize <= 0) {
         if (wordoffset > 0)
             tarfile.close();
         wordoffset = 0;
         wordsize = 0;
-        defaultp = NULL;
+        wordp = NULL;
     }
 
-    return rval;
+    wav_unlock();
+    return n;
 }
 
 
@@ -421,7 +483,29 @@ typedef struct wavProperties_s {
     uint16_t bitsPerSample;
 } wavProperties_t;
 
-/* parse waves.tar in FILESYS, store found offsets */
+/* keep the samples in memory while there is room, in the order of words[] */
+static int cache_clips(File &tarfile)
+{
+    for (int i=0; i<17; i++) {
+        if (clips[i].offset == 0 || clips[i].size <= 0)
+            continue;
+        if (wav_pool_used + clips[i].size > wav_pool_size)
+            continue;      // a shorter one further down may still fit
+        uint8_t *cache = wav_pool + wav_pool_used;
+        if (! tarfile.seek(clips[i].offset, SeekSet))
+            continue;
+        if (tarfile.read(cache, clips[i].size) != (size_t) clips[i].size)
+            continue;
+        clips[i].data = cache;
+        wav_pool_used += clips[i].size;
+    }
+    Serial.printf("Found %d wav files, %d bytes cached\n",
+        num_wav_files, (int)wav_pool_used);
+    tarfile.close();
+    return num_wav_files;
+}
+
+/* parse waves.tar in FILESYS, store found offsets, then cache what fits */
 // public
 int parse_wav_tar()
 {
@@ -431,6 +515,7 @@ int parse_wav_tar()
     uint32_t offset = 0;
     uint32_t filesize, foundfilesize, foundoffset;
     bool is_a_wav_file;
+    int ndx = 17;
 
     clear_waves();
 
@@ -450,6 +535,18 @@ int parse_wav_tar()
         return 0;
     }      
 
+    if (wav_pool == NULL) {
+        if (psramFound()) {
+            wav_pool_size = tarfile.size();
+            wav_pool = (uint8_t *) ps_malloc(wav_pool_size);
+        } else {
+            wav_pool_size = WAV_CACHE_RAM;
+            wav_pool = (uint8_t *) malloc(wav_pool_size);
+        }
+        if (wav_pool == NULL)
+            wav_pool_size = 0;
+    }
+
     Serial.println(F("Parsing waves.tar..."));
 
     while (true) {
@@ -458,18 +555,13 @@ int parse_wav_tar()
         if (bytes_read < 512) {
             Serial.printf("Short read TAR header: got %d bytes\n",
                 (int)bytes_read);
-            tarfile.close();
-            return num_wav_files;
-        }
-        if (is_end_of_archive(buff)) {
-            Serial.printf("Found %d wav files\n", num_wav_files);
-            tarfile.close();
-            return num_wav_files;
+            return cache_clips(tarfile);
         }
+        if (is_end_of_archive(buff))
+            return cache_clips(tarfile);
         if (!verify_checksum(buff)) {
             Serial.println(F("Checksum failure"));
-            tarfile.close();
-            return num_wav_files;
+            return cache_clips(tarfile);
         }
         filesize = parseoct(buff + 124, 12);
         switch (buff[156]) {
@@ -500,14 +592,17 @@ int parse_wav_tar()
                 is_a_wav_file = false;
             if (is_a_wav_file == false)
                 break;
+            for (ndx=0; ndx<17; ndx++) {
+                if (strcmp(name,words[ndx])==0)
+                    break;
+            }
             // read the first file block and examine the WAV header
             bytes_read = tarfile.read((uint8_t *)buff, 512);
             offset += 512;
             if (bytes_read < 512) {
                 Serial.printf("Short read WAV header: got %d bytes\n",
                     (int)bytes_read);
-                tarfile.close();
-                return num_wav_files;
+                return cache_clips(tarfile);
             }
             if (filesize < 512)
                 bytes_read = filesize;
@@ -521,38 +616,32 @@ int parse_wav_tar()
                 is_a_wav_file = false;
             break;
         }
-        // read through (and ignore) the rest of the WAV data
+        // read through the rest of the WAV data
         while (filesize > 0) {
             bytes_read = tarfile.read((uint8_t *)buff, 512);
             offset += 512;
             if (bytes_read < 512) {
                 Serial.printf("Short read WAV data: got %d bytes\n",
                     (int)bytes_read);
-                tarfile.close();
-                return num_wav_files;
+                return cache_clips(tarfile);
             }
             if (filesize < 512)
                 bytes_read = filesize;
             filesize -= bytes_read;
         }
-        int i;
         if (is_a_wav_file) {
-            for (i=0; i<17; i++) {
-                if (strcmp(name,words[i])==0) {
-                    Serial.println(F("matched"));
-                    ++num_wav_files;
-                    // skip WAV header and also drop last 40 bytes
-                    wavsize[i] = (int) foundfilesize - 84;
-                    offsets[i] = foundoffset + 44;
-                    break;
-                }
-            }
-            if (i==17)  // not found
+            if (ndx < 17) {
+                Serial.println(F("matched"));
+                ++num_wav_files;
+                // skip WAV header and also drop last 40 bytes
+                clips[ndx].size = (int) foundfilesize - 84;
+                clips[ndx].offset = foundoffset + 44;
+            } else {  // not found
                 Serial.println(F("not matched"));
+            }
         }
     }
-    tarfile.close();
-    return num_wav_files;
+    return cache_clips(tarfile);
 }
 
 /**********************************************************/
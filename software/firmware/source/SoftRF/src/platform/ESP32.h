@@ -446,6 +446,10 @@ struct rst_info {
 //#define USE_GDL90_MSL
 #define USE_OGN_ENCRYPTION
 #define USE_EGM96           /* geoid lookup table in SPIFFS file */
+//#define USE_RF_TASK       /* radio and decoding in a task on core 0 */
+#if defined(USE_RF_TASK) && (defined(CONFIG_FREERTOS_UNICORE) || defined(ENABLE_TTN))
+#undef USE_RF_TASK          /* needs a second core, and TTN_loop() drives the radio */
+#endif
 
 //#define EXCLUDE_GNSS_UBLOX    /* Neo-6/7/8 */
 #define ENABLE_UBLOX_RFS        /* revert factory settings (when necessary)  */
@@ -722,8 +722,7 @@ void once_per_second_task_CPP(void)
         abs((long) (a->even_cprtime - a->odd_cprtime)) <= MODE_S_INTERACTIVE_TTL * 1000 ) {
       if (es1090_decode(a, &ThisAircraft, &fo)) {
         memset(fo.raw, 0, sizeof(fo.raw));
-        Traffic_Update(&fo);
-        Traffic_Add(&fo);
+        AddTraffic(&fo, (char *) NULL);
       }
     }
   }
@@ -64,11 +64,13 @@
 #include "../driver/Battery.h"
 #include "../driver/Bluetooth.h"
 #include "../system/Time.h"
+#include "../system/Prof.h"
 
 #include "TCPServer.h"
 
 #include <stdio.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include <iostream>
 
@@ -145,6 +147,22 @@ hardware_info_t hw_info = {
 unsigned long ExportTimeMarker = 0;
 
 std::string input_line;
+static bool stdin_eof = false;
+/* stdin is read once per epoll readiness, so it is left in blocking mode */
+static bool stdin_polled = false;   /* false for regular files, always readable */
+static bool stdin_ready  = false;
+static bool stdin_more   = false;   /* lines left for the next pass */
+
+/*
+ * main() sleeps in epoll_wait() until there is GNSS input on stdin, a
+ * traffic client connects or sends data, or the loop timer expires.
+ * The timer is armed for whatever is due first: the RF slot change or
+ * transmission (RF_Next_Deadline()), the next export, or the next look
+ * at the radio, which can only be polled over SPI.
+ */
+#define RPI_RX_POLL_MS      20
+#define RPI_MAX_EVENTS      16
+#define RPI_MAX_LINES       16      /* stdin lines per pass */
 
 TCPServer Traffic_TCP_Server;
 
@@ -570,16 +588,43 @@ const SoC_ops_t RPi_ops = {
   NULL
 };
 
-static bool inputAvailable()
+/* next complete line from stdin (without the '\n'), does not block */
+static bool RPi_ReadLine(std::string &line)
 {
-  struct timeval tv;
-  fd_set fds;
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
-  FD_ZERO(&fds);
-  FD_SET(STDIN_FILENO, &fds);
-  select(STDIN_FILENO+1, &fds, NULL, NULL, &tv);
-  return (FD_ISSET(0, &fds));
+  static std::string stdin_buf;
+  static size_t scanned = 0;
+  char buf[1024];
+
+  while (true) {
+    size_t nl = stdin_buf.find('\n', scanned);
+    if (nl != std::string::npos) {
+      line.assign(stdin_buf, 0, nl);
+      stdin_buf.erase(0, nl + 1);
+      scanned = 0;
+      return true;
+    }
+    scanned = stdin_buf.size();
+    if (stdin_eof) {
+      if (stdin_buf.empty())
+        return false;
+      line.swap(stdin_buf);
+      stdin_buf.clear();
+      scanned = 0;
+      return true;
+    }
+    if (! stdin_ready)
+      return false;
+    ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+    if (stdin_polled)
+      stdin_ready = false;      /* another read() could block */
+    if (n == 0) {
+      stdin_eof = true;
+      continue;
+    }
+    if (n < 0)
+      return false;
+    stdin_buf.append(buf, n);
+  }
 }
 
 static void parseNMEA(const char *str, int len)
@@ -616,8 +661,14 @@ static void parseNMEA(const char *str, int len)
 
 static void RPi_PickGNSSFix()
 {
-  if (inputAvailable()) {
-    std::getline(std::cin, input_line);
+  int lines = 0;
+
+  /* a file on stdin is always readable, take it a few lines at a time */
+  stdin_more = false;
+  while (! stdin_more && RPi_ReadLine(input_line)) {
+    if (++lines >= RPI_MAX_LINES)
+      stdin_more = true;
+
     const char *str = input_line.c_str();
     int len = input_line.length();
 
@@ -667,8 +718,10 @@ static void RPi_PickGNSSFix()
 
 static void RPi_ReadTraffic()
 {
-  string traffic_input = Traffic_TCP_Server.getMessage();
-  if (traffic_input != "") {
+  string traffic_input;
+
+  /* drain all the messages queued since the last pass */
+  while (Traffic_TCP_Server.popMessage(traffic_input)) {
     const char *str = traffic_input.c_str();
     int len = traffic_input.length();
 
@@ -717,56 +770,58 @@ static void RPi_ReadTraffic()
     } else if (str[0] == 'q') {
       if (len >= 4 && str[1] == 'u' && str[2] == 'i' && str[3] == 't') {
         Traffic_TCP_Server.detach();
+        fprintf( stderr, "Traffic input: %lu messages, %lu bytes, %lu dropped\n",
+                 TCPServer::MessagesQueued, TCPServer::BytesReceived,
+                 TCPServer::MessagesDropped );
         fprintf( stderr, "Program termination.\n" );
         exit(EXIT_SUCCESS);
       }
     }
-
-    Traffic_TCP_Server.clean();
   }
 }
 
 void normal_loop()
 {
     /* Read GNSS data from standard input */
-    RPi_PickGNSSFix();
+    PROF_RUN(PROF_GNSS, RPi_PickGNSSFix());
 
     /* Read NMEA data from GNSS module on GPIO pins */
 //    PickGNSSFix();
 
-    RPi_ReadTraffic();
+    PROF_RUN(PROF_IO, RPi_ReadTraffic());
 
-    RF_loop();
+    PROF_RUN(PROF_RF, RF_loop());
 
     ThisAircraft.timestamp = now();
 
     if (isValidFix()) {
-      RF_Transmit(RF_Encode(&ThisAircraft), true);
+      PROF_RUN(PROF_TX, RF_Transmit(RF_Encode(&ThisAircraft), true));
     }
 
-    bool success = RF_Receive();
+    bool success;
+    PROF_RUN(PROF_RX, success = RF_Receive());
 
-    if (success && isValidFix()) ParseData();
+    if (success && isValidFix()) PROF_RUN(PROF_PARSE, ParseData());
 
     if (isValidFix()) {
       Traffic_loop();
     }
 
     if (isTimeToExport()) {
-      NMEA_Export();
+      PROF_RUN(PROF_EXP_NMEA, NMEA_Export());
 
       if (isValidFix()) {
-        GDL90_Export();
-        D1090_Export();
+        PROF_RUN(PROF_EXP_GDL90, GDL90_Export());
+        PROF_RUN(PROF_EXP_D1090, D1090_Export());
         JSON_Export();
       }
       ExportTimeMarker = millis();
     }
 
     // Handle Air Connect
-    NMEA_loop();
+    PROF_RUN(PROF_NMEA_LOOP, NMEA_loop());
 
-    SoC->Display_loop();
+    PROF_RUN(PROF_DISPLAY, SoC->Display_loop());
 
     ClearExpired();
 }
@@ -774,59 +829,66 @@ void normal_loop()
 void relay_loop()
 {
     /* Read GNSS data from standard input */
-    RPi_PickGNSSFix();
+    PROF_RUN(PROF_GNSS, RPi_PickGNSSFix());
 
     /* Read NMEA data from GNSS module on GPIO pins */
 //    PickGNSSFix();
 
-    RPi_ReadTraffic();
+    PROF_RUN(PROF_IO, RPi_ReadTraffic());
 
-    RF_loop();
+    PROF_RUN(PROF_RF, RF_loop());
 
-    for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+    ufo_t *rp = JSON_Raw_Peek();
+    if (rp != NULL) {
       size_t size = RF_Payload_Size(settings->rf_protocol);
-      size = size > sizeof(Container[i].raw) ? sizeof(Container[i].raw) : size;
+      size = size > sizeof(rp->raw) ? sizeof(rp->raw) : size;
 
-      if (memcmp (Container[i].raw, EmptyFO.raw, size) != 0) {   // <<< TBD this needs work
-        // Raw data
-        size_t tx_size = sizeof(TxBuffer) > size ? size : sizeof(TxBuffer);
-        memcpy(TxBuffer, Container[i].raw, tx_size);
+      // Raw data
+      size_t tx_size = sizeof(TxBuffer) > size ? size : sizeof(TxBuffer);
+      memcpy(TxBuffer, rp->raw, tx_size);
 
-        if (tx_size > 0) {
-          /* Follow duty cycle rule */
-          if (RF_Transmit(tx_size, true /* false */)) {
+      if (tx_size > 0) {
+        bool sent;
+        /* Follow duty cycle rule */
+        PROF_RUN(PROF_TX, sent = RF_Transmit(tx_size, true /* false */));
+        if (sent) {
 #if 0
-            String str = Bin2Hex(TxBuffer, tx_size);
-            printf("%s\n", str.c_str());
+          String str = Bin2Hex(TxBuffer, tx_size);
+          printf("%s\n", str.c_str());
 #endif
-            //Container[i] = EmptyFO;
-            EmptyFO(&Container[i]);
-          }
+          JSON_Raw_Pop();
         }
-      } else if (isValidFix() &&
-                 Container[i].addr &&
-                 Container[i].latitude  != 0.0 &&
-                 Container[i].longitude != 0.0 &&
-                 Container[i].altitude  != 0.0 &&
-                 Container[i].distance < (ALARM_ZONE_NONE * 2) ) {
+      }
+    }
+
+    int next;
+    for (int i = Traffic_First(); i < MAX_TRACKING_OBJECTS; i = next) {
+      next = Traffic_Next(i);     /* before the slot may be released */
+
+      if (isValidFix() &&
+          Container[i].latitude  != 0.0 &&
+          Container[i].longitude != 0.0 &&
+          Container[i].altitude  != 0.0 &&
+          Container[i].distance < (ALARM_ZONE_NONE * 2) ) {
 
-        fo = Container[i];
-        fo.timestamp = now(); /* GNSS date&time */
+        container_t relayed = Container[i];
+        relayed.timestamp = now(); /* GNSS date&time */
 
+        bool sent;
         /* Follow duty cycle rule */
-        if (RF_Transmit(RF_Encode(&fo), true /* false */)) {
+        PROF_RUN(PROF_TX, sent = RF_Transmit(RF_Encode(&relayed), true /* false */));
+        if (sent) {
 #if 0
           printf("%06X %f %f %f %d %d %d\n",
-              fo.addr,
-              fo.latitude,
-              fo.longitude,
-              fo.altitude,
-              fo.addr_type,
-              (int) fo.vs,
-              fo.aircraft_type);
+              relayed.addr,
+              relayed.latitude,
+              relayed.longitude,
+              relayed.altitude,
+              relayed.addr_type,
+              (int) relayed.vs,
+              relayed.aircraft_type);
 #endif
-          //Container[i] = EmptyFO;
-          EmptyFO(&Container[i]);
+          Traffic_Release(i);
         }
       }
     }
@@ -838,19 +900,12 @@ unsigned long TxPosUpdMarker = 0;
 void txrx_test_loop()
 {
   bool success = false;
-#if DEBUG_TIMING
-  unsigned long baro_start_ms, baro_end_ms;
-  unsigned long tx_start_ms, tx_end_ms, rx_start_ms, rx_end_ms;
-  unsigned long parse_start_ms, parse_end_ms, led_start_ms, led_end_ms;
-  unsigned long export_start_ms, export_end_ms;
-  unsigned long oled_start_ms, oled_end_ms;
-#endif
 
   setTime(time(NULL));
 
-  RPi_ReadTraffic();
+  PROF_RUN(PROF_IO, RPi_ReadTraffic());
 
-  RF_loop();
+  PROF_RUN(PROF_RF, RF_loop());
 
   ThisAircraft.timestamp = now();
 
@@ -866,84 +921,97 @@ void txrx_test_loop()
   ThisAircraft.speed = TXRX_TEST_SPEED;
   ThisAircraft.vs = TXRX_TEST_VS;
 
-#if DEBUG_TIMING
-  tx_start_ms = millis();
-#endif
+  PROF_RUN(PROF_TX, RF_Transmit(RF_Encode(&ThisAircraft), true));
 
-  RF_Transmit(RF_Encode(&ThisAircraft), true);
+  PROF_RUN(PROF_RX, success = RF_Receive());
 
-#if DEBUG_TIMING
-  tx_end_ms = millis();
-  rx_start_ms = millis();
-#endif
-  success = RF_Receive();
-#if DEBUG_TIMING
-  rx_end_ms = millis();
-#endif
-
-#if DEBUG_TIMING
-  parse_start_ms = millis();
-#endif
-  if (success) ParseData();
-#if DEBUG_TIMING
-  parse_end_ms = millis();
-#endif
+  if (success) PROF_RUN(PROF_PARSE, ParseData());
 
   Traffic_loop();
 
-#if DEBUG_TIMING
-  export_start_ms = millis();
-#endif
   if (isTimeToExport()) {
     NMEA_Position();
-    NMEA_Export();
-    GDL90_Export();
-    D1090_Export();
+    PROF_RUN(PROF_EXP_NMEA, NMEA_Export());
+    PROF_RUN(PROF_EXP_GDL90, GDL90_Export());
+    PROF_RUN(PROF_EXP_D1090, D1090_Export());
     ExportTimeMarker = millis();
   }
-#if DEBUG_TIMING
-  export_end_ms = millis();
-#endif
-
-#if DEBUG_TIMING
-  if (tx_end_ms - tx_start_ms) {
-    Serial.print(F("TX start: "));
-    Serial.print(tx_start_ms);
-    Serial.print(F(" TX stop: "));
-    Serial.println(tx_end_ms);
-  }
-  if (rx_end_ms - rx_start_ms) {
-    Serial.print(F("RX start: "));
-    Serial.print(rx_start_ms);
-    Serial.print(F(" RX stop: "));
-    Serial.println(rx_end_ms);
-  }
-  if (parse_end_ms - parse_start_ms) {
-    Serial.print(F("Parse start: "));
-    Serial.print(parse_start_ms);
-    Serial.print(F(" Parse stop: "));
-    Serial.println(parse_end_ms);
-  }
-
-  if (export_end_ms - export_start_ms) {
-    Serial.print(F("Export start: "));
-    Serial.print(export_start_ms);
-    Serial.print(F(" Export stop: "));
-    Serial.println(export_end_ms);
-  }
-#endif
 
   // Handle Air Connect
-  NMEA_loop();
+  PROF_RUN(PROF_NMEA_LOOP, NMEA_loop());
 
   ClearExpired();
 }
 
 
-void * traffic_tcpserv_loop(void * m)
+static bool RPi_Watch(int epfd, int fd)
 {
-  pthread_detach(pthread_self());
-  Traffic_TCP_Server.receive();
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events  = EPOLLIN;
+  ev.data.fd = fd;
+  /* fails for regular files, which are always readable anyway */
+  return (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0);
+}
+
+/* ms until the loop has something to do, without input */
+static uint32_t RPi_Next_Due()
+{
+  uint32_t now_ms = millis();
+  int32_t due = RPI_RX_POLL_MS;
+
+  if (stdin_more)
+    return 0;
+
+  uint32_t deadline = RF_Next_Deadline();
+  if (deadline != 0 && (int32_t) (deadline - now_ms) < due)
+    due = (int32_t) (deadline - now_ms);
+  if ((int32_t) (ExportTimeMarker + 1001 - now_ms) < due)
+    due = (int32_t) (ExportTimeMarker + 1001 - now_ms);
+
+  return (due > 0 ? due : 0);
+}
+
+/* wait for input or the next due time, and take care of the TCP clients */
+static void RPi_Wait(int epfd, int tfd)
+{
+  struct epoll_event events[RPI_MAX_EVENTS];
+  struct itimerspec timer;
+  static bool stdin_watched = true;
+
+  /* one shot; an all zero it_value would disarm it */
+  uint32_t due = RPi_Next_Due();
+  memset(&timer, 0, sizeof(timer));
+  timer.it_value.tv_sec  = due / 1000;
+  timer.it_value.tv_nsec = (due % 1000) * 1000000L + 1;
+  timerfd_settime(tfd, 0, &timer, NULL);
+
+  int n = epoll_wait(epfd, events, RPI_MAX_EVENTS, -1);
+
+  for (int i = 0; i < n; i++) {
+    int fd = events[i].data.fd;
+
+    if (fd == tfd) {
+      uint64_t expirations;
+      (void) read(tfd, &expirations, sizeof(expirations));
+    } else if (fd == Traffic_TCP_Server.sockfd) {
+      int client = Traffic_TCP_Server.Accept();
+      if (client >= 0)
+        RPi_Watch(epfd, client);
+    } else if (fd == STDIN_FILENO) {
+      stdin_ready = true;
+    } else {
+      /* a closed socket leaves the epoll set by itself */
+      (void) Traffic_TCP_Server.Read(fd);
+    }
+  }
+
+  /* stdin itself is read by RPi_PickGNSSFix() */
+  if (stdin_eof && stdin_watched) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+    stdin_watched = false;
+  }
 }
 
 int main()
@@ -993,20 +1061,32 @@ int main()
 
   Traffic_setup();
   NMEA_setup();
+  Prof_setup();
 
   Traffic_TCP_Server.setup(JSON_SRV_TCP_PORT);
 
-  pthread_t traffic_tcpserv_thread;
-  if ( pthread_create(&traffic_tcpserv_thread, NULL, traffic_tcpserv_loop, (void *)0) != 0) {
-    fprintf( stderr, "pthread_create(traffic_tcpserv_thread) Failed\n\n" );
+  int epfd = epoll_create1(0);
+  int tfd  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+  if (epfd < 0 || tfd < 0) {
+    fprintf( stderr, "epoll/timerfd setup Failed\n\n" );
     exit(EXIT_FAILURE);
   }
 
+  RPi_Watch(epfd, tfd);
+  stdin_polled = RPi_Watch(epfd, STDIN_FILENO);
+  stdin_ready  = ! stdin_polled;
+  RPi_Watch(epfd, Traffic_TCP_Server.sockfd);
+
   SoC->post_init();
 
   SoC->WDT_setup();
 
   while (true) {
+    RPi_Wait(epfd, tfd);
+
+    /* the pass starts once there is something to do */
+    uint32_t prof_t0 = PROF_TICKS();
+
     switch (settings->mode)
     {
     case SOFTRF_MODE_TXRX_TEST:
@@ -1017,10 +1097,17 @@ int main()
       break;
     case SOFTRF_MODE_NORMAL:
     default:
-      normal_loop();
+      PROF_RUN(PROF_NORMAL, normal_loop());
       break;
     }
 
+    /* sum up the stages once a minute, as $PSRFP */
+    Prof_loop();
+
+    PROF_RUN(PROF_FLUSH, NMEA_Flush());
+
+    Prof_Since(PROF_LOOP, prof_t0);
+
 #if defined(TAKE_CARE_OF_MILLIS_ROLLOVER)
     /* take care of millis() rollover on a long term run */
     if (millis() > (47 * 24 * 3600 * 1000UL)) {
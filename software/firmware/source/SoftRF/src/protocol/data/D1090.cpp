@@ -33,15 +33,36 @@
 #include "../../driver/Settings.h"
 #include "../../TrafficHelper.h"
 
-#define ADDR_TO_HEX_STR(s, c) (s += ((c) < 0x10 ? "0" : "") + String((c), HEX))
+/*
+ * Each aircraft is exported as four DF17 frames, encoded into a fixed buffer
+ * - as "*<28 hex digits>;" lines, or in binary (Beast) format:
+ *   <1A> '3' <6 bytes MLAT time> <signal> <14 bytes>, with any 1A byte doubled
+ */
+#define D1090_FRAMES        4
+#define D1090_HEX_SIZE      (1 + 2 * sizeof(frame_data_t) + 3)
+#define D1090_BEAST_SIZE    (2 + 2 * (6 + 1 + sizeof(frame_data_t)))  /* worst case */
+#define D1090_BUF_SIZE      (D1090_FRAMES * D1090_BEAST_SIZE)
+
+#define BEAST_ESC           0x1A
+#define BEAST_MODE_S_LONG   '3'
+
+static uint8_t D1090_Buf[D1090_BUF_SIZE];
 
-#define DF17_FRAME_TO_HEX_STR(s)                        \
-      ({                                                \
-        for (int i=0; i < sizeof(frame_data_t); i++) {  \
-          byte c = df17.msg[i];                         \
-          s += (c < 0x10 ? "0" : "") + String(c, HEX);  \
-        }                                               \
-      })
+static const char D1090_hex[] = "0123456789ABCDEF";
+
+/*
+ * CPR encodings of the last position exported from each Container[] slot,
+ * reused while the aircraft (e.g. a landed one, or a stale report) stays put
+ */
+typedef struct {
+  uint32_t   addr;
+  float      latitude;
+  float      longitude;
+  cpr_pair_t even;
+  cpr_pair_t odd;
+} d1090_cpr_t;
+
+static d1090_cpr_t D1090_CPR[MAX_TRACKING_OBJECTS];
 
 #if defined(ENABLE_D1090_INPUT)
 #include "../radio/ES1090.h"
@@ -88,11 +109,55 @@ static void D1090_Out(byte *buf, size_t size)
   }
 }
 
+static size_t D1090_Frame(uint8_t *buf, const frame_data_t *df17)
+{
+  uint8_t *p = buf;
+
+  if (settings->d1090_fmt == D1090_FMT_BEAST) {
+    *p++ = BEAST_ESC;
+    *p++ = BEAST_MODE_S_LONG;
+    for (int i=0; i < 6; i++)
+      *p++ = 0;               /* no MLAT timestamp */
+    *p++ = 0xFF;              /* signal level */
+    for (int i=0; i < sizeof(frame_data_t); i++) {
+      uint8_t c = df17->msg[i];
+      *p++ = c;
+      if (c == BEAST_ESC)
+        *p++ = c;
+    }
+  } else {
+    *p++ = '*';
+    for (int i=0; i < sizeof(frame_data_t); i++) {
+      uint8_t c = df17->msg[i];
+      *p++ = D1090_hex[c >> 4];
+      *p++ = D1090_hex[c & 0x0F];
+    }
+    *p++ = ';';
+    *p++ = '\r';
+    *p++ = '\n';
+  }
+
+  return (p - buf);
+}
+
+static void D1090_CallSign(char *callsign, ufo_t *fop)
+{
+  const char *prefix = GDL90_CallSign_Prefix[fop->protocol];
+  char *p = callsign;
+
+  if (prefix) {
+    while (*prefix && p < callsign + 2)
+      *p++ = *prefix++;
+  }
+  for (int shift = 20; shift >= 0; shift -= 4)
+    *p++ = D1090_hex[(fop->addr >> shift) & 0x0F];
+  *p = '\0';
+}
+
 void D1090_Export()
 {
   frame_data_t df17;
   float distance;
-  String str;
   time_t this_moment = OurTime;
 
 #if defined(ENABLE_D1090_INPUT) || \
@@ -104,8 +169,7 @@ void D1090_Export()
         abs((long) (a->even_cprtime - a->odd_cprtime)) <= MODE_S_INTERACTIVE_TTL * 1000 ) {
       if (es1090_decode(a, &ThisAircraft, &fo)) {
         memset(fo.raw, 0, sizeof(fo.raw));
-        Traffic_Update(&fo);
-        Traffic_Add(&fo);
+        AddTraffic(&fo, (char *) NULL);
       }
     }
   }
@@ -135,49 +199,45 @@ void D1090_Export()
           }
           altitude *= _GPS_FEET_PER_METER;
 
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_EVEN, DF17);
-
-          str = "*";
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
-
-          df17 = make_air_position_frame(11, Container[i].addr,
-            Container[i].latitude, Container[i].longitude,
-            altitude, CPR_ODD, DF17);
+          d1090_cpr_t *cpr = &D1090_CPR[i];
+          if (cpr->addr      != Container[i].addr     ||
+              cpr->latitude  != Container[i].latitude ||
+              cpr->longitude != Container[i].longitude) {
+            cpr->addr      = Container[i].addr;
+            cpr->latitude  = Container[i].latitude;
+            cpr->longitude = Container[i].longitude;
+            cpr->even = cpr_encode(cpr->latitude, cpr->longitude, CPR_EVEN, AIR_POS);
+            cpr->odd  = cpr_encode(cpr->latitude, cpr->longitude, CPR_ODD,  AIR_POS);
+          }
+          unsigned int ealt = encode_altitude(altitude);
+          size_t size = 0;
 
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
+          df17 = _make_air_position_frame(11, Container[i].addr,
+            cpr->even.YZ, cpr->even.XZ, ealt, CPR_EVEN, DF17);
+          size += D1090_Frame(D1090_Buf + size, &df17);
 
-          String callsign = String(GDL90_CallSign_Prefix[Container[i].protocol]);
-        
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >> 16) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr >>  8) & 0xFF);
-          ADDR_TO_HEX_STR(callsign, (Container[i].addr      ) & 0xFF);
+          df17 = _make_air_position_frame(11, Container[i].addr,
+            cpr->odd.YZ, cpr->odd.XZ, ealt, CPR_ODD, DF17);
+          size += D1090_Frame(D1090_Buf + size, &df17);
 
-          callsign.toUpperCase();
+          char callsign[9];
+          D1090_CallSign(callsign, &Container[i]);
 
           df17 = make_aircraft_identification_frame(Container[i].addr,
-            (unsigned char*) callsign.c_str(),
+            (unsigned char*) callsign,
             Category_Set_D,
             AT_TO_GDL90(Container[i].aircraft_type),
             DF17);
-
-          DF17_FRAME_TO_HEX_STR(str);
-          str += ";\r\n*";
+          size += D1090_Frame(D1090_Buf + size, &df17);
 
           df17 = make_velocity_frame(Container[i].addr,
             Container[i].speed * cos(D2R * Container[i].course),
             Container[i].speed * sin(D2R * Container[i].course),
             Container[i].vs,
             DF17);
+          size += D1090_Frame(D1090_Buf + size, &df17);
 
-          DF17_FRAME_TO_HEX_STR(str);
-          str.toUpperCase();
-          str += ";\r\n";
-
-          D1090_Out((byte *) str.c_str(), str.length());
+          D1090_Out(D1090_Buf, size);
         }
       }
     }
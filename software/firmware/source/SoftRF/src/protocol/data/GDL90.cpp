@@ -20,7 +20,6 @@
  */
 
 #include <TimeLib.h>
-#include <lib_crc.h>
 #include <protocol.h>
 
 #include "../../system/SoC.h"
@@ -166,15 +165,59 @@ static uint32_t pack24bit(uint32_t num)
   return( ((num & 0xff0000) >> 16) | (num & 0x00ff00) | ((num & 0xff) << 16) );
 }
 
+/* CRC-CCITT table, as used by update_crc_gdl90() in libraries/CRC */
+static const uint16_t GDL90_crc_table[256] PROGMEM = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+  0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+  0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+  0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+  0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+  0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+  0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+  0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+  0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+  0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+  0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+  0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+  0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+  0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+  0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+  0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+  0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+  0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+  0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+  0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+  0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+  0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+  0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+  0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+  0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+  0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+  0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+  0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+  0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+  0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+  0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+  0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+};
+
+#if !defined(pgm_read_word)     /* e.g. Raspberry Pi */
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
+
+/* same result as update_crc_gdl90() byte by byte, without a call per byte */
+#define GDL90_CRC_STEP(crc, c) \
+  ((uint16_t) (pgm_read_word(&GDL90_crc_table[(crc) >> 8]) ^ ((crc) << 8) ^ (uint8_t) (c)))
+
 uint16_t GDL90_calcFCS(uint8_t msg_id, uint8_t *msg, int size)
 {
   uint16_t crc16 = 0x0000;  /* seed value */
 
-  crc16 = update_crc_gdl90(crc16, msg_id);   // in firmware\source\libraries\CRC\
+  crc16 = GDL90_CRC_STEP(crc16, msg_id);
 
   for (int i=0; i < size; i++)
   {
-    crc16 = update_crc_gdl90(crc16, msg[i]);
+    crc16 = GDL90_CRC_STEP(crc16, msg[i]);
   }    
 
   return(crc16);
@@ -367,7 +410,8 @@ static size_t makeHeartbeat(uint8_t *buf)
   return(ptr-buf);
 }
 
-static size_t makeType10and20(uint8_t *buf, uint8_t id, container_t *aircraft)
+static size_t makeType10and20(uint8_t *buf, uint8_t id, container_t *aircraft,
+                              uint16_t *fcsp = NULL)
 {
 // >>>  generate output for testing - report ownship as traffic
   if (settings->debug_flags & DEBUG_SIMULATE)
@@ -377,6 +421,9 @@ static size_t makeType10and20(uint8_t *buf, uint8_t id, container_t *aircraft)
   uint8_t *msg = (uint8_t *) msgType10and20(aircraft);
   uint16_t fcs = GDL90_calcFCS(id, msg, sizeof(GDL90_Msg_Traffic_t));
   uint8_t fcs_lsb, fcs_msb;
+
+  if (fcsp)
+    *fcsp = fcs;
   
   fcs_lsb = fcs        & 0xFF;
   fcs_msb = (fcs >> 8) & 0xFF;
@@ -435,8 +482,8 @@ static size_t makeFFid(uint8_t *buf)
 }
 #endif
 
-#define makeOwnershipReport(b,a)  makeType10and20(b, GDL90_OWNSHIP_MSG_ID, a)
-#define makeTrafficReport(b,a)    makeType10and20(b, GDL90_TRAFFIC_MSG_ID, a)
+#define makeOwnershipReport(b,a)    makeType10and20(b, GDL90_OWNSHIP_MSG_ID, a)
+#define makeTrafficReport(b,a,f)    makeType10and20(b, GDL90_TRAFFIC_MSG_ID, a, f)
 
 static void GDL90_Out(byte *buf, size_t size)
 {
@@ -491,35 +538,93 @@ static void GDL90_Out(byte *buf, size_t size)
   }
 }
 
+/*
+ * All the messages of one export are packed into as few writes as fit,
+ * for UDP that is one datagram per GDL90_PACKET_SIZE bytes instead of
+ * one per message - EFBs on a crowded WiFi channel lose fewer of them.
+ */
+#if defined(ESP32) || defined(RASPBERRY_PI)
+#define GDL90_PACKET_SIZE   1400    /* a UDP payload that fits one MTU */
+#else
+#define GDL90_PACKET_SIZE   256
+#endif
+
+/* start and stop flags, ID, and the worst case of escaping body and FCS */
+#define GDL90_MAX_MSG_SIZE  (3 + 2 * (sizeof(GDL90_Msg_FF_ID_t) + 2))
+
+static uint8_t GDL90_Packet[GDL90_PACKET_SIZE];
+static size_t  GDL90_PacketLen = 0;
+
+static size_t GDL90_Packet_Limit()
+{
+#if defined(BLE_FIFO_TX_SIZE)
+  if (settings->gdl90 == DEST_BLUETOOTH)     /* leave room in the BLE TX FIFO */
+    return BLE_FIFO_TX_SIZE / 4;
+#endif
+  return GDL90_PACKET_SIZE;
+}
+
+static void GDL90_Flush()
+{
+  GDL90_Out(GDL90_Packet, GDL90_PacketLen);
+  GDL90_PacketLen = 0;
+}
+
+/* where to build the next message, sending the packet first if it is full */
+static uint8_t *GDL90_Room()
+{
+  if (GDL90_PacketLen + GDL90_MAX_MSG_SIZE > GDL90_Packet_Limit())
+    GDL90_Flush();
+  return (GDL90_Packet + GDL90_PacketLen);
+}
+
+#if defined(GDL90_SKIP_UNCHANGED)
+/*
+ * A traffic report that is identical (same FCS) to the one last sent for
+ * that Container[] slot is skipped, but still re-sent every
+ * GDL90_REFRESH_SECS so that the EFB does not expire the target.
+ */
+#define GDL90_REFRESH_SECS  4
+
+typedef struct {
+  uint32_t addr;
+  uint16_t fcs;
+  time_t   sent;
+} gdl90_sent_t;
+
+static gdl90_sent_t GDL90_Sent[MAX_TRACKING_OBJECTS];
+#endif /* GDL90_SKIP_UNCHANGED */
+
 void GDL90_Export()
 {
   size_t size;
   float distance;
   time_t this_moment = OurTime;
-//  uint8_t *buf = (uint8_t *) (sizeof(UDPpacketBuffer) < UDP_PACKET_BUFSIZE ?
-//                              NMEABuffer : UDPpacketBuffer);
-  uint8_t *buf = (uint8_t *) NMEABuffer;
+  uint8_t *buf;
+  uint16_t fcs;
 
   if (settings->gdl90 != DEST_NONE) {
-    size = makeHeartbeat(buf);
-    GDL90_Out(buf, size);
+    GDL90_PacketLen = 0;
+
+    size = makeHeartbeat(GDL90_Room());
+    GDL90_PacketLen += size;
 
 #if defined(DO_GDL90_FF_EXT)
-    size = makeFFid(buf);
-    GDL90_Out(buf, size);
+    size = makeFFid(GDL90_Room());
+    GDL90_PacketLen += size;
 #endif /* DO_GDL90_FF_EXT */
 
 #if defined(ENABLE_AHRS)
-    size = AHRS_GDL90(buf);
-    GDL90_Out(buf, size);
+    size = AHRS_GDL90(GDL90_Room());
+    GDL90_PacketLen += size;
 #endif /* ENABLE_AHRS */
 
     if (isValidFix()) {
-      size = makeOwnershipReport(buf, &ThisAircraft);
-      GDL90_Out(buf, size);
+      size = makeOwnershipReport(GDL90_Room(), &ThisAircraft);
+      GDL90_PacketLen += size;
 
-      size = makeGeometricAltitude(buf, &ThisAircraft);
-      GDL90_Out(buf, size);
+      size = makeGeometricAltitude(GDL90_Room(), &ThisAircraft);
+      GDL90_PacketLen += size;
 
       for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
 
@@ -531,12 +636,24 @@ void GDL90_Export()
           distance = Container[i].distance;
 
           if (distance < ALARM_ZONE_NONE) {
-            size = makeTrafficReport(buf, &Container[i]);
-            GDL90_Out(buf, size);
+            buf = GDL90_Room();
+            size = makeTrafficReport(buf, &Container[i], &fcs);
+#if defined(GDL90_SKIP_UNCHANGED)
+            gdl90_sent_t *sent = &GDL90_Sent[i];
+            if (sent->addr == Container[i].addr && sent->fcs == fcs &&
+                this_moment - sent->sent < GDL90_REFRESH_SECS)
+              continue;         /* leave it out of the packet */
+            sent->addr = Container[i].addr;
+            sent->fcs  = fcs;
+            sent->sent = this_moment;
+#endif /* GDL90_SKIP_UNCHANGED */
+            GDL90_PacketLen += size;
           }
         }
       }
     }
+
+    GDL90_Flush();
   }
 }
 
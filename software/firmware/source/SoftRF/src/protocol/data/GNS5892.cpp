@@ -13,6 +13,7 @@
 
 #include <math.h>
 #include <protocol.h>
+#include <mode-s.h>
 #include "../../../SoftRF.h"
 #include "../../system/SoC.h"
 #include "../../system/Time.h"
@@ -27,9 +28,19 @@
 #include "IGC.h"
 
 static adsfo_t fo1090;  // EmptyFO1090;
-static char buf1090[256];
 static unsigned char msg[14];
 
+// sentences from the GNS5892 are collected by frame5892() into a queue,
+// one slot of which is the sentence being received, and parsed from there
+#define GNS5892_FRAMES      16    // power of 2
+#define GNS5892_FRAME_SIZE  48    // longest ADS-B sentence is 31 chars
+#define GNS5892_BUDGET_MS   10    // time for parsing per gns5892_loop() call
+
+static char frame1090[GNS5892_FRAMES][GNS5892_FRAME_SIZE];
+static uint8_t frame1090_len[GNS5892_FRAMES];
+static uint8_t frame1090_head = 0;  // oldest complete sentence
+static uint8_t frame1090_tail = 0;  // sentence being received
+
 static void EmptyFO1090(adsfo_t *p) { memset(p, 0, sizeof(ADSBFO)); }
 
 typedef struct mmstruct {
@@ -71,6 +82,7 @@ static uint8_t ac_type_table[16] =
 };
 
 uint32_t adsb_packets_counter = 0;
+uint32_t adsb_dropped_counter = 0;    // sentences lost since parsing fell behind
 
 // data structures for collecting statistics on RSSI vs. distance
 
@@ -312,39 +324,6 @@ void show_zone_stats()
     set_zone_thresholds(true);
 }
 
-// truncated CRC table, for 56 bit messages only, and skipped the CRC bits, leaving 32
-static uint32_t mode_s_checksum_table[] = {
-  0x018567, 0xff38b7, 0x80665f, 0xbfc92b, 0xa01e91, 0xaff54c, 0x57faa6, 0x2bfd53,
-  0xea04ad, 0x8af852, 0x457c29, 0xdd4410, 0x6ea208, 0x375104, 0x1ba882, 0x0dd441,
-  0xf91024, 0x7c8812, 0x3e4409, 0xe0d800, 0x706c00, 0x383600, 0x1c1b00, 0x0e0d80,
-  0x0706c0, 0x038360, 0x01c1b0, 0x00e0d8, 0x00706c, 0x003836, 0x001c1b, 0xfff409
-};
-
-static uint32_t mode_s_checksum( int n ) {
-  int bits = n * 8;
-  if (bits != 56) {
-//Serial.println("no CRC - bits!=56");
-      return 0;
-  }
-  uint32_t crc = 0;
-  int j;
-  bits -= 24;   // skip the CRC bits
-  int byte = 0;
-  int bitmask = (1 << 7);
-  for(j = 0; j < bits; /*j++*/) {
-    if (msg[byte] & bitmask)
-      crc ^= mode_s_checksum_table[j];
-    j++;
-    if ((j & 0x7) == 0) {
-      byte++;
-      bitmask = (1 << 7);
-    } else {
-      bitmask >>= 1;
-    }
-  }
-  return crc;
-}
-
 uint32_t addr_from_crc( int n )
 {
   static uint32_t last_crc = 0;
@@ -357,7 +336,8 @@ uint32_t addr_from_crc( int n )
   if (crc == last_crc)          // very likely same aircraft at same altitude
       return last_val;          // save CPU cycles, return the same ICAO ID
   last_crc = crc;
-  uint32_t crc2 = mode_s_checksum(n);
+  // for 56 bit messages only, the libmodes byte-wise CRC
+  uint32_t crc2 = (n == 7 ? mode_s_checksum(msg, 56) : 0);
   if (crc2 != 0) {
       last_val = (crc ^ crc2);   // should result overlaid ICAO ID
       return last_val;
@@ -700,17 +680,15 @@ static void CPRRelative_setup()
 
 static int find_traffic_by_addr(uint32_t addr)
 {
-    for (int i=0; i<MAX_TRACKING_OBJECTS; i++) {
-        if (Container[i].addr == addr) {
-            if (Container[i].protocol == RF_PROTOCOL_ADSB_1090)
-                return i;      // found
-            if (Container[i].relayed == 0
-                && OurTime <= Container[i].timestamp + ENTRY_EXPIRATION_TIME)
-                return -1;     // already tracked via other means
-            // was tracked via other means, but expired - clear this slot
-            Container[i].addr = 0;
-            return MAX_TRACKING_OBJECTS;
-        }
+    int i = Traffic_Find(addr);
+    if (i < MAX_TRACKING_OBJECTS) {
+        if (Container[i].protocol == RF_PROTOCOL_ADSB_1090)
+            return i;      // found
+        if (Container[i].relayed == 0
+            && OurTime <= Container[i].timestamp + ENTRY_EXPIRATION_TIME)
+            return -1;     // already tracked via other means
+        // was tracked via other means, but expired - clear this slot
+        Traffic_Release(i);
     }
     return MAX_TRACKING_OBJECTS;    // not found
 }
@@ -718,42 +696,18 @@ static int find_traffic_by_addr(uint32_t addr)
 // make room for a new entry
 static int add_traffic_by_dist(float alt_diff)
 {
-    int i;
-    // replace an empty object if found
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].addr == 0) {
+    // replace an empty object, or else an expired object, if found
+    int i = Traffic_Vacant();
+    if (i < MAX_TRACKING_OBJECTS)
         return i;
-      }
-    }
-    // replace an expired object if found
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (OurTime > Container[i].timestamp + ENTRY_EXPIRATION_TIME) {
-        return i;
-      }
-    }
     /* identify the farthest-away non-"followed" object */
     /*    (distance adjusted for altitude difference)   */
-    uint32_t follow_id = settings->follow_id;
-    int max_dist_ndx = MAX_TRACKING_OBJECTS;
-    float max_dist = 0;
-    float adj_distance;
-    for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      container_t *cip = &Container[i];
-      if (cip->alarm_level == ALARM_LEVEL_NONE
-          && cip->addr != follow_id && cip->relayed == false) {
-        adj_distance = cip->adj_distance;
-        if (adj_distance < cip->distance)
-            adj_distance = cip->distance;
-        if (adj_distance > max_dist)  {
-          max_dist_ndx = i;
-          max_dist = adj_distance;
-        }
-      }
-    }
+    float max_dist;
+    int max_dist_ndx = Traffic_Farthest(&max_dist);
     if (max_dist_ndx < MAX_TRACKING_OBJECTS) {
         // may replace the farthest object
-        adj_distance = fo1090.distance + VERTICAL_SLOPE * fabs(alt_diff);
-        if (adj_distance < max_dist || fo1090.addr == follow_id)
+        float adj_distance = fo1090.distance + VERTICAL_SLOPE * fabs(alt_diff);
+        if (adj_distance < max_dist || fo1090.addr == settings->follow_id)
             return max_dist_ndx;
     }
     return MAX_TRACKING_OBJECTS;
@@ -788,9 +742,7 @@ static void update_traffic_position(int index)
         if (index == MAX_TRACKING_OBJECTS)    // no room
             return;
         cip = &Container[index];
-        //*cip = EmptyContainer;
-        EmptyContainer(cip);
-        cip->addr      = fo1090.addr;
+        Traffic_Claim(index, fo1090.addr);    // also empties the slot
         cip->addr_type = ADDR_TYPE_ICAO;
         icao_to_n(cip);                           // compute USA N-number from ICAO ID
         cip->protocol  = RF_PROTOCOL_ADSB_1090;
@@ -831,8 +783,10 @@ static void update_traffic_position(int index)
     cip->rssi      = mm.rssi;
     cip->timestamp    = OurTime;
     cip->positiontime = OurTime;
+    Traffic_Touch(index);
     cip->gnsstime_ms  = millis();
     Traffic_Update(cip);
+    Traffic_Rank(index);
 
 /* also send data out via NMEA */
 if (settings->debug_flags & DEBUG_DEEPER) {
@@ -871,13 +825,22 @@ if (settings->debug_flags & DEBUG_DEEPER) {
 // ME (message body): 56 bits
 // PI (CRC etc): 24 bits
 
-// assume the data is always valid and uppercase
-//int hex2bin(char c) {
-//    if (c >= 'A')  return (0xA + (c - 'A'));
-//    return (c - '0');
-//}
-// make this inline:
-#define hex2bin(c) (((c)>='A')? (0xA+((c)-'A')) : ((c)-'0'))
+// value of each hex digit, 0xFF for other chars
+// - frame5892() drops sentences with non-hex chars, so parse() can assume valid data
+static uint8_t hex_table[256];
+
+static void hex_table_setup()
+{
+    memset(hex_table, 0xFF, sizeof(hex_table));
+    for (int c = 0; c < 10; c++)
+        hex_table['0' + c] = c;
+    for (int c = 0; c < 6; c++) {
+        hex_table['A' + c] = 0xA + c;
+        hex_table['a' + c] = 0xA + c;
+    }
+}
+
+#define hex2bin(c) (hex_table[(uint8_t)(c)])
 
 
 // decode Gillham ("Gray") coded altitude
@@ -984,9 +947,7 @@ void update_mode_s_traffic(int i)
         if (i == MAX_TRACKING_OBJECTS)    // no room
             return;
         cip = &Container[i];
-        //*cip = EmptyContainer;
-        EmptyContainer(cip);
-        cip->addr = fo1090.addr;
+        Traffic_Claim(i, fo1090.addr);    // also empties the slot
         cip->addr_type = ADDR_TYPE_ICAO;
         icao_to_n(cip);                   // compute USA N-number from ICAO ID
         cip->protocol  = RF_PROTOCOL_ADSB_1090;
@@ -1022,8 +983,10 @@ void update_mode_s_traffic(int i)
     cip->rssi = mm.rssi;
     cip->timestamp   = OurTime;
     cip->mode_s_time = OurTime;
+    Traffic_Touch(i);
     cip->gnsstime_ms = millis();
     Traffic_Update(cip);
+    Traffic_Rank(i);
 
 if (settings->debug_flags & DEBUG_DEEPER) {
 if (settings->nmea_d || settings->nmea2_d) {
@@ -1229,8 +1192,10 @@ static bool parse_position(int index)
     int32_t abslatdiff = abs(cprlatdiff);
     if (abslatdiff > maxcprdiff) {        // since even just lat diff is too far
         if (fo1090.addr != settings->follow_id) {
-            if (index < MAX_TRACKING_OBJECTS)    // found
+            if (index < MAX_TRACKING_OBJECTS) {  // found
                 Container[index].distance = 99999;
+                Traffic_Rank(index);
+            }
             return false;                // no need to compute slant distance
         }
     }
@@ -1280,8 +1245,10 @@ static bool parse_position(int index)
       if (fo1090.addr != settings->follow_id) {
         // reject some too-far traffic based on lon-diff alone
         if (abslondiff > maxcprdiff && fo1090.addr != settings->follow_id) {
-            if (index < MAX_TRACKING_OBJECTS)     // found
+            if (index < MAX_TRACKING_OBJECTS) {   // found
                 Container[index].distance = 99999;
+                Traffic_Rank(index);
+            }
             return false;
         }
         // weed out remaining too-far using pre-computed squared-hypotenuse
@@ -1292,8 +1259,10 @@ static bool parse_position(int index)
         abslondiff >>= 4;
         if (abslatdiff*abslatdiff + abslondiff*abslondiff > maxcprdiff_sq
                                        && fo1090.addr != settings->follow_id) {
-            if (index < MAX_TRACKING_OBJECTS)    // found
+            if (index < MAX_TRACKING_OBJECTS) {  // found
                 Container[index].distance = 99999;
+                Traffic_Rank(index);
+            }
             return false;
         }
       }
@@ -1318,6 +1287,7 @@ static bool parse_position(int index)
                 Container[index].distance = fo1090.distance;
                 Container[index].dx = x;
                 Container[index].dy = y;
+                Traffic_Rank(index);
                 // but leave its timestamp alone, let it expire
             }
             return false;
@@ -1748,6 +1718,7 @@ void gns5892_setup()
       set_zone_thresholds(false);
 
   CPRRelative_setup();
+  hex_table_setup();
 
   pause5892();
   delay(200);
@@ -1779,6 +1750,49 @@ void gns5892_test_mode()
     play5892();
 }
 
+// move all the input available into the queue of sentences
+static void frame5892()
+{
+  static int n = 0;      // chars so far in the sentence being received
+  char *buf = frame1090[frame1090_tail];
+  uint8_t chunk[64];
+  int avail;
+
+  while ((avail = Serial2.available()) > 0) {
+    if (avail > (int) sizeof(chunk))
+        avail = sizeof(chunk);
+    avail = Serial2.readBytes(chunk, avail);
+    for (int k = 0; k < avail; k++) {
+      char c = chunk[k];
+      if (c=='*' || c=='+' || c=='#') {
+          buf[0] = c;            // start new sentence, drop any preceding data
+          n = 1;
+      } else if (n == 0) {       // wait for a valid starting char
+          continue;
+      } else if (c==';' || c=='\r' || c=='\n') {   // completed sentence
+          if (n > 14) {
+              uint8_t next = (frame1090_tail + 1) & (GNS5892_FRAMES - 1);
+              if (next == frame1090_head) {
+                  ++adsb_dropped_counter;      // queue is full
+              } else {
+                  frame1090_len[frame1090_tail] = n;
+                  frame1090_tail = next;
+                  buf = frame1090[next];
+              }
+          }
+          n = 0;
+      } else if (buf[0] == '#') {
+          if (n < GNS5892_FRAME_SIZE)  // truncate long responses
+              buf[n++] = c;
+      } else if (n < GNS5892_FRAME_SIZE && hex2bin(c) < 16) {
+          buf[n++] = c;
+      } else {
+          n = 0;                 // invalid, start over
+      }
+    }
+  }
+}
+
 // called from NMEA.cpp NMEA_loop() when appropriate
 void gns5892_loop()
 {
@@ -1798,52 +1812,31 @@ void gns5892_loop()
       playtime = millis();
   }
 
-  int avail = Serial2.available();
-  if (avail <= 0)
+  frame5892();
+  if (frame1090_head == frame1090_tail)
       return;
-  if (avail > (GNS5892_INPUT_BUF_SIZE - 256))    // input buffer is getting full
-      Serial2.readBytes(buf1090, 256);           // discard some input data
-
-  static bool input_complete = false;
-  static int n = 0;  // inputchars
-  if (input_complete)
-      n = 0;          // start a new input sentence
-  input_complete = false;
-  while (Serial2.available()) {  // loop until a full sentence or no more data
-      char c = Serial2.read();
-      if (c=='*' || c=='+' || c=='#') {
-          buf1090[0] = c;            // start new sentence, drop any preceding data
-          n = 1;
-      } else if (n == 0) {      // wait for a valid starting char
-          continue;
-      } else if (c==';' || c=='\r' || c=='\n') {   // completed sentence
-          if (n > 14 /* && n <= 32 */ ) {
-              input_complete = true;
-              break;
+
+  uint32_t start = millis();
+  do {
+      char *buf = frame1090[frame1090_head];
+      int n = frame1090_len[frame1090_head];
+
+      if (buf[0] == '*' || buf[0] == '+') {    // ADS-B data received
+          (void) parse(buf, n);
+      } else if (buf[0] == '#') {                 // response to commands
+          Serial.write(buf, n);                   // copy to console
+          Serial.println("");
+          if (buf[1]=='4' && buf[2]=='9') {   // response to "play"
+              rx1090found = true;
+              Serial.println(F(">>> GNS5892 module responded:"));
+              char cmd[16];
+              snprintf(cmd, 16, "#39-00-00-%02X", settings->rx1090x);  // set comparator offset
+              send5892(cmd);
           }
-          n = 0;                 // invalid, start over
-      } else {
-          buf1090[n++] = c;
       }
-  }
-  yield();
-  if (! input_complete || n == 0)
-      return;
-
-  if (buf1090[0] == '*' || buf1090[0] == '+') {    // ADS-B data received
-      (void) parse(buf1090, n);
+      frame1090_head = (frame1090_head + 1) & (GNS5892_FRAMES - 1);
       yield();
-  } else if (buf1090[0] == '#') {                 // response to commands
-      Serial.write(buf1090, n);                   // copy to console
-      Serial.println("");
-      if (buf1090[1]=='4' && buf1090[2]=='9') {   // response to "play"
-          rx1090found = true;
-          Serial.println(F(">>> GNS5892 module responded:"));
-          char buf[16];
-          snprintf(buf, 16, "#39-00-00-%02X", settings->rx1090x);  // set comparator offset
-          send5892(buf);
-      }
-  }
+  } while (frame1090_head != frame1090_tail && millis() - start < GNS5892_BUDGET_MS);
 
   NMEA_bridge_sent = true;   // not really sent, but substantial processing
 }
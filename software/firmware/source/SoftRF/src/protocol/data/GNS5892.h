@@ -29,5 +29,6 @@ void gns5892_test_mode(void);
 
 extern bool gns5892_found;
 extern uint32_t adsb_packets_counter;
+extern uint32_t adsb_dropped_counter;
 
 #endif /* GNS5892_H */
@@ -63,9 +63,14 @@ size_t compfilePosition = 0;
 //#define EXAMPLE_B_RECORD           "B1751494352910N07215306WA0012300123\r\n"
 //static const char emptybrecord[] = "B~~~~^^~~~~^^^~~~~~~^^^~~~~~^^~~~^^\r\n";
 static char brecord_format[] = "B1751494352910N07215306WA%05d%05d\r\n";
-#define B_RECORD_SIZE 38
-   // sizeof(emptybrecord) - the null char at end is included in sizeof()
 static char compbrecord[B_RECORD_SIZE];     // for compression
+// time -> offset index of the compressed file, written into its footer
+static uint32_t igz_index[IGZ_INDEX_MAX][2];
+static int igz_nindex = 0;
+static int igz_stride = 1;        // index every igz_stride'th block
+static int igz_blocks = 0;
+static uint32_t igz_day = 0;
+static uint32_t igz_last_time = 0;
 #define PRE_POS_NUM   8    // number of pre-stored B-records
 #define DATA_BLOCK_SIZE 3000
 #define G_RECORD_SIZE 38   // 2 * (G+16+\r\n) - or, if compressed, 2 * (0x0A+G+16+\n), same size
@@ -81,13 +86,13 @@ static int num_pre_positions = 0;
 static int pre_positions_head = 0;
 static int pre_positions_next = 0;
 
+// the four LK8000 key sets hash the same data, so they run as one 4-lane MD5
 #if defined(ESP32)
-static MD5_CTX md5_buf[8];   // do not malloc() since PSRAM access is slow for this
+static MD5x4_CTX md5_buf[1];   // do not malloc() since PSRAM access is slow for this
 #else
-static MD5_CTX *md5_buf = NULL;   // will malloc() it in setup()
+static MD5x4_CTX *md5_buf = NULL;   // will malloc() it in setup()
 #endif
-static MD5_CTX *md5_a, *md5_b, *md5_c, *md5_d;
-static MD5_CTX *md5_a_copy, *md5_b_copy, *md5_c_copy, *md5_d_copy;
+static MD5x4_CTX *md5x4;
 
 /*
  * Compress flight logs
@@ -109,28 +114,338 @@ Decompression algorithm:  Read first byte of each line to classify it:
 * If 0xC0, read next byte into B-record template at index=(byte & 0x1F)
 * Else, read compressed B-record (fixed-length, 6 bytes = 12 digits) (combine with template)
 This relies on the digits being 0-9, thus a value > 9 in either nibble is not compressed digits.
+
+Version 2 (seekable):
+* Each block written by compressblock() starts with an empty template, so the first
+      B-record of the block sets all 22 template positions (a "keyframe"),
+      and decompression can start at any block boundary.
+* After the G-records there is a fixed-size binary footer (IGZ_FOOTER_SIZE bytes):
+      IGZ_INDEX_MAX index entries of { uint32 time, uint32 offset } (little-endian),
+      uint16 number of entries used, uint16 version (2), "IGZ2".
+      The time is the first B-record of the block in seconds since midnight (UTC)
+      of the first B-record in the file, i.e., it goes past 86400 after midnight.
+      The offset is where the block starts in the file.
+  The next block overwrites the G-records and the footer.
+  Version 1 files have no footer and are still read as before.
+  The footer is only written with IGZ_WRITE_INDEX defined, the igz2igc.exe
+  shipped in software/app would append it to its output.
 */
 
 static uint8_t tpos[22] = {1,2,3,4,7,8,9,10,14,15,16,17,18,19,23,24,25,26,27,30,31,32};
 static uint8_t bpos[12] = { 5, 6, 11, 12, 13, 20, 21, 22, 28, 29, 33, 34 };
 
+static void clear_brecord(char *brecord)
+{
+    //strcpy(brecord, emptybrecord);
+    memset(brecord,0,B_RECORD_SIZE);
+    brecord[0] = 'B';
+    brecord[35] = '\r';
+    brecord[36] = '\n';
+    //brecord[37] = '\0';
+}
+
+// seconds since midnight, from the HHMMSS in a B-record
+static uint32_t brecord_time(const char *brecord)
+{
+    return (3600 * (10*(brecord[1]-'0') + (brecord[2]-'0'))
+            + 60 * (10*(brecord[3]-'0') + (brecord[4]-'0'))
+                 + (10*(brecord[5]-'0') + (brecord[6]-'0')));
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] | ((uint32_t)p[1] << 8)
+         | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+static void put_le32(char *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+// start an incremental decompression of an IGZ file
+bool IGZ_open(igz_stream_t *z, const char *filename)
+{
+    z->file = FILESYS.open(filename, FILE_READ);
+    if (! z->file)
+        return false;
+    z->inpos = 0;
+    z->inlen = 0;
+    z->state = 0;
+    z->i = 0;
+    clear_brecord(z->brecord);
+    z->left = z->file.size();
+    z->nindex = 0;
+    z->day = 0;
+    z->last_time = 0;
+    z->ref_time = 0;
+    z->from = 0;
+    z->to = 0xFFFFFFFF;
+    z->seek_pending = false;
+    z->started = true;
+    z->windowed = false;
+    z->done = false;
+    z->line_out = true;
+    // look for a version 2 footer
+    uint8_t trailer[8];
+    if (z->left >= IGZ_FOOTER_SIZE
+          && z->file.seek(z->left - sizeof(trailer))
+          && z->file.read(trailer, sizeof(trailer)) == sizeof(trailer)
+          && memcmp(trailer+4, IGZ_MAGIC, 4) == 0) {
+        z->nindex = trailer[0] | (trailer[1] << 8);
+        if (z->nindex > IGZ_INDEX_MAX)
+            z->nindex = 0;
+        z->left -= IGZ_FOOTER_SIZE;
+    }
+    z->dataend = z->left;
+    z->file.seek(0);
+    return true;
+}
+
+// read index entry n of a version 2 file
+static bool IGZ_index_entry(igz_stream_t *z, int n, uint32_t *time, uint32_t *offset)
+{
+    uint8_t entry[8];
+    if (! z->file.seek(z->dataend + 8*n) || z->file.read(entry, 8) != 8)
+        return false;
+    *time = get_le32(entry);
+    *offset = get_le32(entry+4);
+    return true;
+}
+
+// UTC seconds since midnight to the running time of the file
+static uint32_t IGZ_unwrap(igz_stream_t *z, uint32_t tod)
+{
+    if (tod + 43200 < z->ref_time)    // after midnight
+        tod += 86400;
+    return tod;
+}
+
+/*
+ * Limit the B, K, E and comment records to the ones from 'from' to 'to'
+ * (UTC seconds since midnight).  The header records (A, H, I, J, C) and the
+ * G-records are always output.  On a version 2 file the reading goes on,
+ * after the header records, from the last block that starts before 'from'.
+ * Call after IGZ_open().
+ */
+void IGZ_window(igz_stream_t *z, uint32_t from, uint32_t to)
+{
+    z->windowed = true;
+    z->started = false;
+    z->from = from;
+    z->to = to;
+    uint32_t time, offset;
+    if (z->nindex == 0 || ! IGZ_index_entry(z, 0, &time, &offset)) {
+        z->file.seek(0);
+        return;                  // version 1: filter while reading it all
+    }
+    z->ref_time = time;          // the first B-record in the file
+    z->from = IGZ_unwrap(z, from);
+    z->to = IGZ_unwrap(z, to);
+    z->windowed = false;         // resolved
+    z->day = 0;                  // reading starts at the top of the file
+    z->last_time = time;
+    uint32_t first = offset;
+    uint32_t start_time = time;
+    uint32_t start = offset;
+    for (int n=1; n < z->nindex; n++) {
+        if (! IGZ_index_entry(z, n, &time, &offset) || time > z->from)
+            break;
+        start_time = time;
+        start = offset;
+    }
+    z->file.seek(0);             // for the header records
+    z->seek_to = start;
+    z->seek_time = start_time;
+    z->seek_pending = (start != first);
+}
+
+// the header records are out, go on from the block found by IGZ_window()
+static void IGZ_seek_block(igz_stream_t *z)
+{
+    z->seek_pending = false;
+    z->file.seek(z->seek_to);
+    z->left = z->dataend - z->seek_to;
+    z->inpos = 0;
+    z->inlen = 0;
+    z->day = (z->seek_time / 86400) * 86400;
+    z->last_time = z->seek_time;
+    clear_brecord(z->brecord);   // the block starts with a keyframe
+}
+
+// past the window: go on from the G-records at the end of the data, if they are there
+static void IGZ_seek_tail(igz_stream_t *z)
+{
+    uint32_t tail = 4 * G_RECORD_SIZE;
+    uint8_t c[2];
+    if (z->dataend >= tail
+          && z->file.seek(z->dataend - tail)
+          && z->file.read(c, 2) == 2 && c[0] == 0x0A && c[1] == 'G') {
+        z->file.seek(z->dataend - tail);
+        z->left = tail;
+        z->inpos = 0;
+        z->inlen = 0;
+    } else {
+        z->file.seek(z->dataend - z->left);    // read through, as it was
+    }
+}
+
+void IGZ_close(igz_stream_t *z)
+{
+    z->file.close();
+}
+
+// a B-record was decoded, check its time against the window
+static void IGZ_window_check(igz_stream_t *z)
+{
+    uint32_t t = z->day + brecord_time(z->brecord);
+    if (t + 43200 < z->last_time) {   // past midnight
+        z->day += 86400;
+        t += 86400;
+    }
+    z->last_time = t;
+    if (z->windowed) {           // version 1 file, the first B-record is the reference
+        z->ref_time = t;
+        z->from = IGZ_unwrap(z, z->from);
+        z->to = IGZ_unwrap(z, z->to);
+        z->windowed = false;
+    }
+    if (! z->started && t >= z->from)
+        z->started = true;
+    if (t > z->to && ! z->done) {
+        z->done = true;
+        IGZ_seek_tail(z);
+    }
+}
+
+// decode one compressed byte, append any resulting text at p (37 bytes at most)
+static char *IGZ_decode(igz_stream_t *z, uint8_t c, char *p)
+{
+    char *brecord = z->brecord;
+    bool emit = (z->started && ! z->done);
+    if (z->state == 0) {    // beginning of a line
+        if (c == 0x0A) {
+            z->state = 0xAB;
+        } else if (c == 0x0C) {
+            z->line_out = emit;
+            if (emit) {
+                memcpy(p,"LPLT",4);
+                p += 4;
+            }
+            z->state = 0xAA;
+        } else {
+            int opr = (c & 0xE0);
+            int idx = (c & 0x1F);
+            if (idx > 21)  idx = 21;   // should not happen
+            if (opr == 0xA0) {
+                ++brecord[tpos[idx]];
+            } else if (opr == 0xE0) {
+                --brecord[tpos[idx]];
+            } else if (opr == 0xC0) {
+                z->state = tpos[idx];
+                // will read next byte into template at that position
+            } else {
+                // read a compressed B-record, starting with current byte
+                z->i = 0;
+                char c1 = '0' + (c & 0x0F);
+                char c2 = '0' + ((c & 0xF0) >> 4);
+                brecord[bpos[z->i++]] = c1;
+                brecord[bpos[z->i++]] = c2;
+                z->state = 0xBB;   // will read 5 more bytes
+            }
+        }
+    } else if (z->state == 0xAA || z->state == 0xAB) {  // verbatim
+        if (z->state == 0xAB) {    // the record type: header and G-records always go out
+            z->line_out = (emit || memchr("AHIJCG", c, 6) != NULL);
+            z->state = 0xAA;
+        }
+        if (c == '\n') {      // end of line
+            if (z->line_out) {
+                *p++ = '\r';
+                *p++ = '\n';
+            }
+            z->state = 0;
+        } else if (z->line_out) {
+            *p++ = c;
+        }
+    } else if (z->state == 0xBB) {   // decompress B-record
+        char c1 = '0' + (c & 0x0F);
+        char c2 = '0' + ((c & 0xF0) >> 4);
+        if (z->i < 11) {
+            brecord[bpos[z->i++]] = c1;
+            brecord[bpos[z->i++]] = c2;
+        }
+        if (z->i >= 12) {
+            if (z->windowed || ! z->started || z->to != 0xFFFFFFFF)
+                IGZ_window_check(z);
+            if (z->started && ! z->done) {
+                memcpy(p, brecord, 37);
+                p += 37;
+            }
+            z->state = 0;
+        }
+    } else if (z->state <= 32) {   // template byte (following opr==0xC0)
+        brecord[z->state] = c;
+        z->state = 0;
+    }
+    return p;
+}
+
+// decompress into out[], up to outsize bytes (at least IGZ_MIN_OUT), returns 0 at the end
+size_t IGZ_read(igz_stream_t *z, char *out, size_t outsize)
+{
+    char *p = out;
+    char *t = out + (outsize - (IGZ_MIN_OUT-1));  // room for the longest output of one byte
+    while (p < t) {
+        if (z->inpos >= z->inlen) {
+            if (z->left == 0)
+                break;
+            int n = z->file.read(z->inbuf,
+                        (z->left < sizeof(z->inbuf)? z->left : sizeof(z->inbuf)));
+            if (n <= 0)
+                break;
+            z->left -= n;
+            z->inlen = n;
+            z->inpos = 0;
+        }
+        uint8_t c = z->inbuf[z->inpos];
+        if (z->seek_pending && z->state == 0 && c != 0x0A && c != 0x0C) {
+            IGZ_seek_block(z);     // the first B-record: headers are done
+            continue;
+        }
+        ++z->inpos;
+        p = IGZ_decode(z, c, p);
+    }
+    return (p - out);
+}
+
 // decompress a flash file (into PSRAMbuf on T-Beam)
 bool decompressfile(char *filename)
 {
-    compfile = FILESYS.open(filename, FILE_READ);
-    if (! compfile) {
+    static igz_stream_t z;
+    if (! IGZ_open(&z, filename)) {
         Serial.println("Failed to open compressed file for decompression");
         return false;
     }
 #if defined(ESP32)
-    if (! PSRAMbuf)
+    if (! PSRAMbuf) {
+        IGZ_close(&z);
         return false;
+    }
     char *p = PSRAMbuf;
-    char *t = PSRAMbuf + (PSRAMbufSize - 40);
+    char *t = PSRAMbuf + PSRAMbufSize;
+    size_t n;
+    while (t - p >= IGZ_MIN_OUT && (n = IGZ_read(&z, p, t - p)) > 0)
+        p += n;
+    IGZ_close(&z);
+    PSRAMbufUsed = (p - PSRAMbuf);
 #elif defined(ARDUINO_ARCH_NRF52)
     uint32_t free_kb = (IGCFS_is_mounted? IGCFS_free_kb() : 0);
-    if (free_kb < 50+((6*compfile.size())>>10)) {
-        compfile.close();
+    if (free_kb < 50+((6*z.file.size())>>10)) {
+        IGZ_close(&z);
         Serial.println("Not enough file space for decompression");
         return false;
     }
@@ -148,106 +463,22 @@ bool decompressfile(char *filename)
     outfilename[strlen(outfilename)-1] = 'C';   // overwriting 'X'
     File outfile = IGCFILESYS.open(outfilename, FILE_WRITE);
     if (! outfile) {
-        compfile.close();
+        IGZ_close(&z);
         Serial.println("Failed to open IGC file for decompression");
         return false;
     }
-    char *p = data_block_buf;
-    char *t = p + DATA_BLOCK_SIZE;  // there is also the prepositioning buf space above that
-#endif
-    char brecord[B_RECORD_SIZE];
-    //strcpy(brecord, emptybrecord);
-    memset(brecord,0,B_RECORD_SIZE);
-    brecord[0] = 'B';
-    brecord[35] = '\r';
-    brecord[36] = '\n';
-    //brecord[37] = '\0';
-    int state = 0;
-    int i = 0;
-    while (compfile.available()) {
-#if defined(ESP32)
-        if (p >= t)
-            break;
-#elif defined(ARDUINO_ARCH_NRF52)
-        if (p >= t) {
-            size_t outsize = p - data_block_buf;
-            if (outfile.write((uint8_t *)data_block_buf, outsize) < outsize) {
-                compfile.close();
-                outfile.close();
-                IGCFILESYS.remove(outfilename);
-                Serial.println("Failed to write to IGC file in decompression");
-                return false;
-            }
-            p = data_block_buf;
-        }
-#endif
-        uint8_t c = compfile.read();
-        if (state == 0) {    // beginning of a line
-            if (c == 0x0A) {
-                state = 0xAA;
-            } else if (c == 0x0C) {
-                strcpy(p,"LPLT");
-                p += 4;
-                state = 0xAA;
-            } else {
-                int opr = (c & 0xE0);
-                int idx = (c & 0x1F);
-                if (idx > 21)  idx = 21;   // should not happen
-                if (opr == 0xA0) {
-                    ++brecord[tpos[idx]];
-                } else if (opr == 0xE0) {
-                    --brecord[tpos[idx]];
-                } else if (opr == 0xC0) {
-                    state = tpos[idx];
-                    // will read next byte into template at that position
-                } else {
-                    // read a compressed B-record, starting with current byte
-                    i = 0;
-                    char c1 = '0' + (c & 0x0F);
-                    char c2 = '0' + ((c & 0xF0) >> 4);
-                    brecord[bpos[i++]] = c1;
-                    brecord[bpos[i++]] = c2;
-                    state = 0xBB;   // will read 5 more bytes
-                }
-            }
-        } else if (state == 0xAA) {  // verbatim
-            if (c == '\n') {      // end of line
-                *p++ = '\r';
-                *p++ = '\n';
-                state = 0;
-            } else {
-                *p++ = c;
-            }
-        } else if (state == 0xBB) {   // decompress B-record
-            char c1 = '0' + (c & 0x0F);
-            char c2 = '0' + ((c & 0xF0) >> 4);
-            if (i < 11) {
-                brecord[bpos[i++]] = c1;
-                brecord[bpos[i++]] = c2;
-            }
-            if (i >= 12) {
-                memcpy(p, brecord, 37);
-                p += 37;
-                state = 0;
-            }
-        } else if (state <= 32) {   // template byte (following opr==0xC0)
-            brecord[state] = c;
-            state = 0;
-        }
-    }
-    compfile.close();
-#if defined(ESP32)
-    PSRAMbufUsed = (p - PSRAMbuf);
-#elif defined(ARDUINO_ARCH_NRF52)
-    if (p > data_block_buf) {
-        size_t outsize = p - data_block_buf;
+    // there is also the prepositioning buf space above DATA_BLOCK_SIZE
+    size_t outsize;
+    while ((outsize = IGZ_read(&z, data_block_buf, DATA_BLOCK_SIZE)) > 0) {
         if (outfile.write((uint8_t *)data_block_buf, outsize) < outsize) {
+            IGZ_close(&z);
             outfile.close();
             IGCFILESYS.remove(outfilename);
-            Serial.println("Failed last write to IGC file in decompression");
+            Serial.println("Failed to write to IGC file in decompression");
             return false;
         }
     }
+    IGZ_close(&z);
     outfile.close();
     Serial.println("... OK, deleting .IGX file");
     IGCFILESYS.remove(filename);
@@ -293,7 +524,7 @@ void FlightLog_setup()
         Serial.println("Failed to allocate data_block_buf");
         return;
     }
-    md5_buf = (MD5_CTX *) malloc(8*sizeof(MD5_CTX));   // about 1500 bytes total
+    md5_buf = (MD5x4_CTX *) malloc(sizeof(MD5x4_CTX));   // about 140 bytes
     if (! md5_buf) {
         FlightLogFail = true;
         Serial.println("Failed to allocate MD5_buf");
@@ -304,15 +535,7 @@ void FlightLog_setup()
     //Serial.printf("flightlog data_block size: %d\r\n", DATA_BLOCK_SIZE + B_RECORD_SIZE*PRE_POS_NUM);
     pre_positions_buf = &data_block_buf[DATA_BLOCK_SIZE];
 
-    MD5_CTX *p = md5_buf;
-    md5_a = p++;
-    md5_b = p++;
-    md5_c = p++;
-    md5_d = p++;
-    md5_a_copy = p++;
-    md5_b_copy = p++;
-    md5_c_copy = p++;
-    md5_d_copy = p;
+    md5x4 = md5_buf;
 }
 
 #if defined(ARDUINO_ARCH_NRF52)
@@ -447,10 +670,10 @@ void reopenFlightLog()
     }
 }
 
-size_t write_g_record(MD5_CTX *md5, size_t data_position)
+size_t write_g_record(const unsigned char *hash, size_t data_position)
 {
-    MD5::MD5Final(md5);
-    char *digest = MD5::make_digest(md5);
+    char digest[33];
+    MD5::make_digest(hash, digest);
     if (strlen(digest) == 32) {
         char *buf = &data_block_buf[data_position];
         buf[0] = 'G';
@@ -464,22 +687,67 @@ size_t write_g_record(MD5_CTX *md5, size_t data_position)
 
 void MD5_update(const char *data, size_t size)
 {
-    MD5::MD5Update(md5_a, data, size);
-    MD5::MD5Update(md5_b, data, size);
-    MD5::MD5Update(md5_c, data, size);
-    MD5::MD5Update(md5_d, data, size);
+    MD5::MD5x4Update(md5x4, data, size);
+}
+
+// add the block starting at compfilePosition to the index, if it has a B-record
+static void igz_index_block(const char *brecord)
+{
+    uint32_t t = igz_day + brecord_time(brecord);
+    if (t + 43200 < igz_last_time) {    // past midnight
+        igz_day += 86400;
+        t += 86400;
+    }
+    igz_last_time = t;
+    if ((igz_blocks++ % igz_stride) != 0)
+        return;
+    if (igz_nindex >= IGZ_INDEX_MAX) {
+        // full: keep every other entry, and index half as often from now on
+        for (int i=0; i < IGZ_INDEX_MAX/2; i++) {
+            igz_index[i][0] = igz_index[2*i][0];
+            igz_index[i][1] = igz_index[2*i][1];
+        }
+        igz_nindex = IGZ_INDEX_MAX/2;
+        igz_stride *= 2;
+        igz_blocks = 1;
+    }
+    igz_index[igz_nindex][0] = t;
+    igz_index[igz_nindex][1] = compfilePosition;
+    ++igz_nindex;
+}
+
+#if defined(IGZ_WRITE_INDEX)
+// append the version 2 footer (always IGZ_FOOTER_SIZE bytes)
+static size_t igz_footer(char *outbuf)
+{
+    char *p = outbuf;
+    for (int i=0; i < IGZ_INDEX_MAX; i++) {
+        put_le32(p,   (i < igz_nindex? igz_index[i][0] : 0));
+        put_le32(p+4, (i < igz_nindex? igz_index[i][1] : 0));
+        p += 8;
+    }
+    *p++ = igz_nindex;
+    *p++ = igz_nindex >> 8;
+    *p++ = 2;            // version
+    *p++ = 0;
+    memcpy(p, IGZ_MAGIC, 4);
+    return IGZ_FOOTER_SIZE;
 }
+#define IGZ_TRAILER_SIZE  IGZ_FOOTER_SIZE
+#else
+#define IGZ_TRAILER_SIZE  0
+#endif /* IGZ_WRITE_INDEX */
 
 void compressblock(size_t insize)
 {
 #if defined(ESP32)
     // output to unused space in PSRAMbuf, then write to flash all at once
     // - since PSRAMbuf is much larger than SPIFFS there will always be space, but check:
-    if (PSRAMbufUsed + insize + 1024 > PSRAMbufSize)
+    if (PSRAMbufUsed + insize + 1024 + IGZ_FOOTER_SIZE > PSRAMbufSize)
         return;
     char *outbuf = PSRAMbuf + PSRAMbufUsed;
 #elif defined(ARDUINO_ARCH_NRF52)
-    char *outbuf = (char *) malloc(insize+400);
+    char *outbuf = (char *) malloc(insize+400+IGZ_FOOTER_SIZE);
     if (! outbuf) {
         failFlightLog();
         Serial.println("Cannot allocate compression buffer");
@@ -492,8 +760,11 @@ void compressblock(size_t insize)
     char *t = data_block_buf + insize;
     size_t outsize = 0;
     bool compress = true;
+    bool indexed = false;
     int i;
     uint8_t b[4];
+    // start each block with a keyframe: the first B-record will set the whole template
+    clear_brecord(compbrecord);
     while (p < t) {
 #if defined(ARDUINO_ARCH_NRF52)
         if (outsize > insize+350) {  // should not happen
@@ -507,6 +778,10 @@ void compressblock(size_t insize)
         char c = *p++;
         if (compress) {    // beginning of a record
             if (c == 'B') {
+                if (! indexed) {
+                    igz_index_block(q);
+                    indexed = true;
+                }
                 // compare with previous B-record
                 // output any needed template changes
                 for (i=0; i<22; i++) {
@@ -550,6 +825,11 @@ void compressblock(size_t insize)
     }
     yield();
 
+    size_t datasize = outsize;
+#if defined(IGZ_WRITE_INDEX)
+    outsize += igz_footer(outbuf + outsize);
+#endif
+
     // write data block to file all at once
     if (compfile.write((uint8_t *)outbuf, outsize) < outsize) {  // failed
         compfileOpen = false;
@@ -558,11 +838,11 @@ void compressblock(size_t insize)
 #endif
         Serial.println("write to flash flight log failed");
     } else {
-        compfilePosition += (outsize - 4*G_RECORD_SIZE);  // overwrite this G record next time
+        compfilePosition += (datasize - 4*G_RECORD_SIZE);  // overwrite this G record next time
         Serial.print("Wrote ");
         Serial.print(outsize);
         Serial.print(" bytes to compressed flight log in flash, total ");
-        Serial.println(compfilePosition + 4*G_RECORD_SIZE);
+        Serial.println(compfilePosition + 4*G_RECORD_SIZE + IGZ_TRAILER_SIZE);
     }
 #if defined(ARDUINO_ARCH_NRF52)
     free(outbuf);
@@ -589,18 +869,14 @@ void completeFlightLog()
     }
 #endif
 
-    // finalize a *copy* of the MD5 context - keep the main context un-finalized
-    *md5_a_copy = *md5_a;
-    *md5_b_copy = *md5_b;
-    *md5_c_copy = *md5_c;
-    *md5_d_copy = *md5_d;
+    // finalize a snapshot of the MD5 context - keep the main context un-finalized
+    unsigned char hash[4][16];
+    MD5::MD5x4Final(md5x4, hash);
     size_t size = data_block_used;
     // append G-records within the data_block_buf
     // - this may spill into the pre-positioning area
-    size = write_g_record(md5_a_copy, size);
-    size = write_g_record(md5_b_copy, size);
-    size = write_g_record(md5_c_copy, size);
-    size = write_g_record(md5_d_copy, size);
+    for (int i=0; i<4; i++)
+        size = write_g_record(hash[i], size);
 
     // send the new data (including the new G-record) to file and/or PSRAM
     // then (temporarily) close the file
@@ -870,15 +1146,17 @@ bool writeIGCHeader()
     return true;  
 }
 
+// LK8000 keys:
+static const uint32_t lk8000_keys[4][4] = {
+    { 0x63e54c01, 0x25adab89, 0x44baecfe, 0x60f25476 },
+    { 0x41e24d03, 0x23b8ebea, 0x4a4bfc9e, 0x640ed89a },
+    { 0x61e54e01, 0x22cdab89, 0x48b20cfe, 0x62125476 },
+    { 0xc1e84fe8, 0x21d1c28a, 0x438e1a12, 0x6c250aee }
+};
+
 void init_md5()
 {
-#define ul (unsigned long)
-    // LK8000 keys:
-    MD5::MD5Initialize(md5_a, ul 0x63e54c01, ul 0x25adab89, ul 0x44baecfe, ul 0x60f25476);
-    MD5::MD5Initialize(md5_b, ul 0x41e24d03, ul 0x23b8ebea, ul 0x4a4bfc9e, ul 0x640ed89a);
-    MD5::MD5Initialize(md5_c, ul 0x61e54e01, ul 0x22cdab89, ul 0x48b20cfe, ul 0x62125476);
-    MD5::MD5Initialize(md5_d, ul 0xc1e84fe8, ul 0x21d1c28a, ul 0x438e1a12, ul 0x6c250aee);
-#undef ul
+    MD5::MD5x4Initialize(md5x4, lk8000_keys);
 }
 
 // XCsoar keys:
@@ -945,14 +1223,14 @@ void openFlightLog()
                 return;
 #endif
             }
-            // the B-record needs to be initialized once for the file,
-            // afterwards it will be preserved between compressblock() calls
-            //strcpy(compbrecord, emptybrecord);
-            memset(compbrecord,0,B_RECORD_SIZE);
-            compbrecord[0] = 'B';
-            compbrecord[35] = '\r';
-            compbrecord[36] = '\n';
-            //compbrecord[37] = '\0';
+            // the B-record template is reset by each compressblock() call,
+            // the time index is kept for the whole file
+            clear_brecord(compbrecord);
+            igz_nindex = 0;
+            igz_stride = 1;
+            igz_blocks = 0;
+            igz_day = 0;
+            igz_last_time = 0;
         }
 
     } else {  // ESP32 and (! PSRAMbuf) or NRF52 and not settings->compflash
@@ -1241,10 +1519,10 @@ void clearPSRAMlog()
 
 // run a test of MD5 machinery
 // this processes the text as-is, including commas
-void test_final(MD5_CTX *md5)
+void test_final(const unsigned char *hash)
 {
-    MD5::MD5Final(md5);
-    char *digest = MD5::make_digest(md5);
+    char digest[33];
+    MD5::make_digest(hash, digest);
     char buf[40];
     buf[0] = 'G';
     strncpy(&buf[1], digest, 16);
@@ -1260,10 +1538,24 @@ void MD5_test()
 #if defined(ESP32)
     if (SD_is_mounted == false)  return;
 #endif
-    //MD5::make_hash(md5_a, "abcdefghijklmnopqrstuvwxyz");
-    //Serial.println("MD5 should be:   c3fcd3d76192e4007dfb496cca67e13b");
-    //Serial.print("MD5 computed as: ");
-    //Serial.println(MD5::make_digest(md5_a));
+    unsigned char hash[4][16];
+    // RFC 1321 test vector, in all four lanes
+    static const uint32_t rfc_iv[4][4] = {
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 },
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 },
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 },
+        { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 }
+    };
+    MD5::MD5x4Initialize(md5x4, rfc_iv);
+    MD5_update("abcdefghijklmnopqrstuvwxyz", 26);
+    MD5::MD5x4Final(md5x4, hash);
+    for (int i=0; i<4; i++) {
+        char digest[33];
+        if (strcmp(MD5::make_digest(hash[i], digest), "c3fcd3d76192e4007dfb496cca67e13b") != 0) {
+            Serial.print("MD5 test vector failed in lane ");
+            Serial.println(i);
+        }
+    }
     init_md5();
 #if defined(ESP32)
     String filename = "/logs/";   // SD_BASEPATH;
@@ -1274,16 +1566,34 @@ void MD5_test()
     File file = IGCFILESYS.open(filename.c_str(), FILE_READ);
     if (! file)  return;
     Serial.println("MD5 test:");
-    const char *cp;
+    // the single-lane MD5 is the reference for the G-records
+    MD5_CTX *ref = (MD5_CTX *) malloc(4*sizeof(MD5_CTX));
+    if (ref) {
+        for (int i=0; i<4; i++)
+            MD5::MD5Initialize(&ref[i], lk8000_keys[i][0], lk8000_keys[i][1],
+                                        lk8000_keys[i][2], lk8000_keys[i][3]);
+    }
     char buf[128];
     while (getline(file, buf, sizeof(buf))) {
-        MD5_update(buf, strlen(cp));
+        size_t len = strlen(buf);
+        MD5_update(buf, len);
+        if (ref) {
+            for (int i=0; i<4; i++)
+                MD5::MD5Update(&ref[i], buf, len);
+        }
         yield();
     }
     file.close();
-    test_final(md5_a);
-    test_final(md5_b);
-    test_final(md5_c);
-    test_final(md5_d);
+    MD5::MD5x4Final(md5x4, hash);
+    for (int i=0; i<4; i++) {
+        test_final(hash[i]);
+        if (ref) {
+            MD5::MD5Final(&ref[i]);
+            if (memcmp(ref[i].hash, hash[i], 16) != 0)
+                Serial.println("- differs from the single-lane MD5");
+        }
+    }
+    if (ref)
+        free(ref);
 }
 
@@ -3,6 +3,45 @@
 
 #if defined(IGCFILESYS)
 
+#define B_RECORD_SIZE 38
+   // sizeof(emptybrecord) - the null char at end is included in sizeof()
+
+// seekable (version 2) IGZ footer, see compressblock()
+// - only written with IGZ_WRITE_INDEX, software/app/igz2igc.exe predates it
+//#define IGZ_WRITE_INDEX
+#define IGZ_INDEX_MAX    64
+#define IGZ_FOOTER_SIZE  (8*IGZ_INDEX_MAX + 8)
+#define IGZ_MAGIC        "IGZ2"
+
+// incremental decompression of an IGZ file, see decompressfile()
+typedef struct igz_stream_struct {
+    File     file;
+    uint32_t left;        // compressed bytes not yet read
+    uint32_t dataend;     // where the footer starts (or the file size)
+    uint16_t nindex;      // index entries in the footer (0 if version 1)
+    uint16_t inpos;
+    uint16_t inlen;
+    uint8_t  inbuf[256];
+    uint8_t  state;
+    uint8_t  i;
+    char     brecord[B_RECORD_SIZE];
+    // time window, see IGZ_window()
+    uint32_t day;
+    uint32_t last_time;
+    uint32_t ref_time;
+    uint32_t from;
+    uint32_t to;
+    uint32_t seek_to;     // block to go on from after the header records
+    uint32_t seek_time;
+    bool     seek_pending;
+    bool     started;
+    bool     windowed;    // from and to not yet resolved
+    bool     done;
+    bool     line_out;    // the verbatim line being decoded is output
+} igz_stream_t;
+
+#define IGZ_MIN_OUT  40   // smallest buffer to hand to IGZ_read()
+
 void makeLogNameDate(char *buf);  // needs buf[4]
 void FlightLog_setup();
 void openFlightLog();
@@ -10,6 +49,10 @@ size_t PSRAMavailable();
 void clearPSRAMlog();
 void suspendFlightLog();
 bool decompressfile(char *filename);
+bool IGZ_open(igz_stream_t *z, const char *filename);
+size_t IGZ_read(igz_stream_t *z, char *out, size_t outsize);
+void IGZ_close(igz_stream_t *z);
+void IGZ_window(igz_stream_t *z, uint32_t from, uint32_t to);
 void resumeFlightLog();
 void logFlightPosition();
 void completeFlightLog();
@@ -127,6 +127,31 @@ void JSON_Export()
   jsonDoc.clear();
 }
 
+/*
+ * JSON traffic goes into the table directly, as it always has, and not
+ * through AddTraffic() with its relay, duplicate and source preference rules:
+ * the same aircraft, else an empty slot, else an expired one.  There is one
+ * slot per address, an aircraft also heard by other means keeps that entry.
+ */
+static void json_store(ufo_t *fop)
+{
+    Traffic_Update(fop);
+
+    int j = Traffic_Find(fop->addr);
+    if (j < MAX_TRACKING_OBJECTS) {
+        if (Container[j].protocol != fop->protocol)
+            return;
+    } else {
+        j = Traffic_Vacant();
+        if (j >= MAX_TRACKING_OBJECTS)
+            return;
+        Traffic_Claim(j, fop->addr);
+    }
+    Container[j] = *fop;
+    Traffic_Touch(j);
+    Traffic_Rank(j);
+}
+
 void parsePING(JsonObject root)
 {
   ping_aircraft_t *aircraft_array;
@@ -216,42 +241,7 @@ void parsePING(JsonObject root)
         fo.no_track = false;
         fo.rssi = 0;
 
-        Traffic_Update(&fo);
-
-        int j;
-
-        /* Try to find and update an entry with the same aircraft ID */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == fo.addr && Container[j].protocol == fo.protocol) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0) {
-              // && memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        json_store(&fo);
       }
     }
 
@@ -414,42 +404,7 @@ void parseD1090(JsonObject root)
         fo.no_track = false;
         fo.rssi = aircraft_array[i].rssi;
 
-        Traffic_Update(&fo);
-
-        int j;
-
-        /* Try to find and update an entry with the same aircraft ID */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == fo.addr && Container[j].protocol == fo.protocol) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0) {
-              // && memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
-        }
+        json_store(&fo);
       }
     }
 
@@ -476,6 +431,32 @@ void parseD1090(JsonObject root)
   }
 }
 
+#define JSON_RAW_QUEUE_SIZE  8
+
+static ufo_t JSON_Raw_Queue[JSON_RAW_QUEUE_SIZE];
+static int   JSON_Raw_head  = 0;
+static int   JSON_Raw_count = 0;
+
+/* the oldest raw packet not sent yet, if any - expired ones are dropped */
+ufo_t *JSON_Raw_Peek()
+{
+  while (JSON_Raw_count > 0) {
+    ufo_t *rp = &JSON_Raw_Queue[JSON_Raw_head];
+    if (now() - rp->timestamp <= ENTRY_EXPIRATION_TIME)
+      return rp;
+    JSON_Raw_Pop();
+  }
+  return NULL;
+}
+
+void JSON_Raw_Pop()
+{
+  if (JSON_Raw_count == 0)
+    return;
+  JSON_Raw_head = (JSON_Raw_head + 1) % JSON_RAW_QUEUE_SIZE;
+  JSON_Raw_count--;
+}
+
 void parseRAW(JsonObject root)
 {
 
@@ -510,27 +491,10 @@ void parseRAW(JsonObject root)
         fo.timestamp = timestamp;
         fo.protocol = RF_PROTOCOL_ADSB_1090;
 
-        int j;
-
-        /* Fill a free entry if able */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (Container[j].addr == 0) {
-               // && memcmp(Container[j].raw, EmptyFO.raw, sizeof(EmptyFO.raw)) == 0) {
-            Container[j] = fo;
-            break;
-          }
-        }
-
-        if (j < MAX_TRACKING_OBJECTS) {
-            continue;
-        }
-
-        /* Overwrite expired entry */
-        for (j=0; j < MAX_TRACKING_OBJECTS; j++) {
-          if (timestamp - Container[j].timestamp > ENTRY_EXPIRATION_TIME) {
-            Container[j] = fo;
-            break;
-          }
+        /* not traffic (no address), only kept until relay_loop() sends it */
+        if (JSON_Raw_count < JSON_RAW_QUEUE_SIZE) {
+            JSON_Raw_Queue[(JSON_Raw_head + JSON_Raw_count) % JSON_RAW_QUEUE_SIZE] = fo;
+            JSON_Raw_count++;
         }
       }
     }
@@ -783,6 +747,10 @@ void parseSettings(JsonObject root)
       eeprom_block.field.settings.alarm = TRAFFIC_ALARM_DISTANCE;
     } else if (!strcmp(alarm_s,"VECTOR")) {
       eeprom_block.field.settings.alarm = TRAFFIC_ALARM_VECTOR;
+    } else if (!strcmp(alarm_s,"LATEST")) {
+      eeprom_block.field.settings.alarm = TRAFFIC_ALARM_LATEST;
+    } else if (!strcmp(alarm_s,"CPA")) {
+      eeprom_block.field.settings.alarm = TRAFFIC_ALARM_CPA;
     }
   }
 
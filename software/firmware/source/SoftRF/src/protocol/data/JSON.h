@@ -85,6 +85,8 @@ extern void parseUISettings(JsonObject);
 extern void parseD1090(JsonObject);
 extern void parsePING(JsonObject);
 extern void parseRAW(JsonObject);
+extern ufo_t *JSON_Raw_Peek(void);
+extern void JSON_Raw_Pop(void);
 extern byte getVal(char);
 
 #endif /* JSONHELPER_H */
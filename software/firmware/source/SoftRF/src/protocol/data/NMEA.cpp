@@ -29,6 +29,7 @@
 #include "../../system/SoC.h"
 // which does #include "../../SoftRF.h"
 #include "../../system/Time.h"
+#include "../../system/Prof.h"
 #include "../../driver/WiFi.h"
 #include "../../driver/Settings.h"
 #include "../../driver/RF.h"
@@ -594,6 +595,87 @@ void NMEA_setup()
 #endif /* ENABLE_AHRS */
 
   sendPFLAV(true);
+  NMEA_Flush();
+}
+
+/* one write (or one UDP datagram) of a batch of sentences */
+static void NMEA_Write(uint8_t dest, const char *buf, size_t size)
+{
+  switch (dest)
+  {
+  case DEST_UART:
+    if (SoC->UART_ops)
+      SoC->UART_ops->write((const byte*) buf, size);
+    else
+      Serial.write(buf, size);
+    break;
+  case DEST_UART2:
+    if (has_serial2)
+      Serial2.write(buf, size);
+    break;
+#if !defined(EXCLUDE_WIFI)
+  case DEST_UDP:
+    SoC->WiFi_transmit_UDP(UDP_NMEA_Output_Port, (byte *) buf, size);
+    break;
+  case DEST_TCP:
+#if defined(NMEA_TCP_SERVICE)
+    if (TCP_active)
+      WiFi_transmit_TCP(buf, size);
+#endif
+    break;
+#endif
+#if defined(ARDUINO_ARCH_NRF52)
+  case DEST_USB:
+    if (SoC->USB_ops)
+      SoC->USB_ops->write((const byte *) buf, size);
+    break;
+#endif
+  case DEST_BLUETOOTH:
+    if (BTactive && SoC->Bluetooth_ops)
+      SoC->Bluetooth_ops->write((const byte *) buf, size);
+    break;
+  case DEST_NONE:
+  default:
+    break;
+  }
+  yield();
+}
+
+/*
+ * Output is gathered per destination and sent by NMEA_Flush(),
+ * which is called once per pass of the main loop,
+ * or earlier when the batch would not fit.
+ */
+typedef struct nmea_outbuf_struct {
+  uint8_t  dest;
+  uint16_t len;
+  char     data[NMEA_OUTBUF_SIZE];
+} nmea_outbuf_t;
+
+static nmea_outbuf_t NMEA_OutBuf[NMEA_OUTBUFS];
+
+/* largest batch to hand to a destination in one go */
+static size_t NMEA_Batch_Limit(uint8_t dest)
+{
+#if defined(BLE_FIFO_TX_SIZE)
+  if (dest == DEST_BLUETOOTH)     /* leave room in the BLE TX FIFO */
+    return BLE_FIFO_TX_SIZE / 4;
+#endif
+  return NMEA_OUTBUF_SIZE;
+}
+
+static void NMEA_Flush_Buf(nmea_outbuf_t *ob)
+{
+  if (ob->len > 0) {
+    NMEA_Write(ob->dest, ob->data, ob->len);
+    ob->len = 0;
+  }
+}
+
+void NMEA_Flush()
+{
+  for (int i = 0; i < NMEA_OUTBUFS; i++)
+    NMEA_Flush_Buf(&NMEA_OutBuf[i]);
 }
 
 void NMEA_Out(uint8_t dest, const char *buf, size_t size, bool nl)
@@ -620,85 +702,56 @@ if (NMEA_Source != DEST_NONE) {     // only external sources
   switch (dest)
   {
   case DEST_UART:
-    {
-      if (NMEA_Source == DEST_USB)   // do not echo USB to UART
-        return; 
-      if (SoC->UART_ops) {
-        SoC->UART_ops->write((const byte*) buf, size);
-        if (nl)
-          SoC->UART_ops->write((const byte *) "\r\n", 2);
-      } else {
-        Serial.write(buf, size);
-        if (nl)
-          Serial.write((const byte *) "\r\n",2);
-      }
-    }
+    if (NMEA_Source == DEST_USB)    // do not echo USB to UART
+      return;
     break;
-  case DEST_UART2:
-    {
-      if (has_serial2) {
-        Serial2.write(buf, size);
-        if (nl)
-          Serial2.write((const byte *) "\r\n",2);
-      }
-    }
-    break;
-#if !defined(EXCLUDE_WIFI)
-  case DEST_UDP:
-    {
-      size_t udp_size = size;
-
-      if (size > sizeof(UDPpacketBuffer) - 2)
-        udp_size = sizeof(UDPpacketBuffer) - 2;
-      memcpy(UDPpacketBuffer, buf, udp_size);
-
-      if (nl) {
-        UDPpacketBuffer[udp_size++] = '\r';
-        UDPpacketBuffer[udp_size++] = '\n';
-      }
-
-      SoC->WiFi_transmit_UDP(UDP_NMEA_Output_Port, (byte *) UDPpacketBuffer, udp_size);
-    }
-    break;
-  case DEST_TCP:
-    {
-#if defined(NMEA_TCP_SERVICE)
-      if (TCP_active) {
-        WiFi_transmit_TCP(buf, size);
-        if (nl)
-          WiFi_transmit_TCP("\r\n", 2);
-      }
-#endif
-    }
-    break;
-#endif
 #if defined(ARDUINO_ARCH_NRF52)
   case DEST_USB:
-    {
-      if (NMEA_Source == DEST_UART)   // do not echo UART to USB
-        return; 
-      if (SoC->USB_ops) {
-        SoC->USB_ops->write((const byte *) buf, size);
-        if (nl)
-          SoC->USB_ops->write((const byte *) "\r\n", 2);
-      }
-    }
+    if (NMEA_Source == DEST_UART)   // do not echo UART to USB
+      return;
     break;
 #endif
-  case DEST_BLUETOOTH:
-    {
-      if (BTactive && SoC->Bluetooth_ops) {
-        SoC->Bluetooth_ops->write((const byte *) buf, size);
-        if (nl)
-          SoC->Bluetooth_ops->write((const byte *) "\r\n", 2);
-      }
-    }
-    break;
   case DEST_NONE:
+    return;
   default:
     break;
   }
-  yield();
+
+  /* the de-echo checks above depend on NMEA_Source, so they cannot wait */
+
+  nmea_outbuf_t *ob = NULL;
+  for (int i = 0; i < NMEA_OUTBUFS; i++) {
+    if (NMEA_OutBuf[i].len > 0 && NMEA_OutBuf[i].dest == dest) {
+      ob = &NMEA_OutBuf[i];
+      break;
+    }
+    if (ob == NULL && NMEA_OutBuf[i].len == 0)
+      ob = &NMEA_OutBuf[i];
+  }
+
+  size_t total = size + (nl ? 2 : 0);
+  size_t limit = NMEA_Batch_Limit(dest);
+
+  if (ob == NULL || total > limit) {
+    /* no batch available, or too big for one: keep the order, write through */
+    if (ob != NULL)
+      NMEA_Flush_Buf(ob);
+    NMEA_Write(dest, buf, size);
+    if (nl)
+      NMEA_Write(dest, "\r\n", 2);
+    return;
+  }
+
+  if (ob->len + total > limit)
+    NMEA_Flush_Buf(ob);
+
+  ob->dest = dest;
+  memcpy(ob->data + ob->len, buf, size);
+  ob->len += size;
+  if (nl) {
+    ob->data[ob->len++] = '\r';
+    ob->data[ob->len++] = '\n';
+  }
 }
 
 void NMEA_Outs(uint16_t nmeatype, const char *buf, unsigned int size, bool nl)
@@ -978,7 +1031,7 @@ void NMEA_loop()
     if (has_serial2) {
         if (settings->rx1090 == ADSB_RX_GNS5892) {
             // Serial2 is dedicated to the ADS-B receiver module
-            gns5892_loop();
+            PROF_RUN(PROF_ADSB, gns5892_loop());
         } else {
             gdl90 = (settings->gdl90_in == DEST_UART2);
             while (Serial2.available() > 0) {
@@ -1202,6 +1255,8 @@ void closeNMEAlog()
 
 void NMEA_fini()
 {
+  NMEA_Flush();
+
 #if defined(NMEA_TCP_SERVICE)
   if (TCP_active) {
     if (settings->tcpmode == TCP_MODE_SERVER)
@@ -1270,7 +1325,8 @@ void NMEA_Export()
     bool HP_nondir = false;
     bool HP_stealth = false;
     int total_objects = 0;
-    int head = 0;
+    container_t *nmea_list[MAX_NMEA_OBJECTS];   /* traffic to report, most relevant first */
+    int listed = 0;
 
     bool has_Fix = (isValidFix() || (settings->mode == SOFTRF_MODE_TXRX_TEST));
     bool deeper = (settings->debug_flags & DEBUG_DEEPER);
@@ -1280,11 +1336,11 @@ void NMEA_Export()
       float maxdistance = (settings->hrange? 1000 * settings->hrange : 100000);
       float maxaltdiff  = (settings->vrange?  100 * settings->vrange :  20000);
 
-      for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
+      for (int i=Traffic_First(); i < MAX_TRACKING_OBJECTS; i=Traffic_Next(i)) {
 
         cip = &Container[i];
 
-        if (cip->addr && ((OurTime - cip->timestamp) <= settings->expire)) {
+        if ((OurTime - cip->timestamp) <= settings->expire) {
 #if 0
           Serial.println(i);
           Serial.printf("%06X\r\n", cip->addr);
@@ -1328,31 +1384,24 @@ void NMEA_Export()
               && show) {
 
              /* put candidate traffic to report into a sorted list */
+             /* - only the first MAX_NMEA_OBJECTS are ever reported, keep just those */
 
-             int next, previous;
-             if (total_objects == 0) {  /* first inserted into the list */
-               head = i;
-               cip->next = MAX_TRACKING_OBJECTS;
-               total_objects = 1;
-             } else {
-               next = head;
-               while (next < MAX_TRACKING_OBJECTS) {
-                 fop = &Container[next];
+             int pos;
+             for (pos=0; pos < listed; pos++) {
+                 fop = nmea_list[pos];
                  if (fop->alarm_level <= alarm_level
                   && fop->addr != follow_id
                   && fop->adj_distance >= adj_dist)
                         break;   /* insert before this one */
-                 /* else */
-                   previous = next;  /* the preceding list entry */
-                   next = fop->next;
-               }
-               cip->next = next;
-               if (head == next)
-                 head = i;
-               else
-                 Container[previous].next = i;
-               total_objects++;
              }
+             if (pos < MAX_NMEA_OBJECTS) {
+                 if (listed < MAX_NMEA_OBJECTS)
+                     ++listed;
+                 for (int k=listed-1; k > pos; k--)
+                     nmea_list[k] = nmea_list[k-1];
+                 nmea_list[pos] = cip;
+             }
+             total_objects++;
 
              /* Alarm or close traffic is treated as highest priority */
              if (alarm_level > HP_alarm_level ||
@@ -1370,12 +1419,12 @@ void NMEA_Export()
         }
       }
 
-      fop = &Container[head];
-
-      for (int i=0; i < total_objects && i < MAX_NMEA_OBJECTS; i++) {
+      for (int i=0; i < listed; i++) {
 
          // note that MAX_NMEA_OBJECTS (6) < MAX_TRACKING_OBJECTS (8)
 
+         fop = nmea_list[i];
+
          // may want to skip the HP object if there are many to report
          // since it will be in the PFLAU sentence - but XCsoar etc
          // seem to ignore the PFLAU, so report the HP object both ways
@@ -1519,10 +1568,6 @@ void NMEA_Export()
          NMEAOutC(NMEA_T);
 
         //}  /* done skipping the HP object */
-
-        if (fop->next >= MAX_TRACKING_OBJECTS)  break;    /* belt and suspenders */
-
-        fop = &Container[fop->next];
       }
     }
 
@@ -1534,7 +1579,7 @@ void NMEA_Export()
         if (HP_addr == 0) {
            /* no aircraft has been identified as high priority, use */
            /*  the aircraft from the top of the sorted list, if any */
-           fop = &Container[head];
+           fop = nmea_list[0];
            if (fop->addr) {
                HP_bearing = fop->bearing;
                HP_alt_diff = fop->alt_diff;
@@ -29,6 +29,14 @@
 #define GNS5892_INPUT_BUF_SIZE    1000
 
 #define NMEA_BUFFER_SIZE    128
+
+/* output sentences are batched per destination, see NMEA_Out() */
+#define NMEA_OUTBUFS        2
+#if defined(ESP32) || defined(RASPBERRY_PI)
+#define NMEA_OUTBUF_SIZE    1024
+#else
+#define NMEA_OUTBUF_SIZE    256
+#endif
 #define NMEA_CALLSIGN_SIZE  (3 /* prefix */ + 1 /* _ */ + 6 /* ICAO */ + 1 /* EOL */)
 
 #define PSRFX_VERSION       1
@@ -57,6 +65,7 @@ void NMEA_Export(void);
 void NMEA_Position(void);
 void NMEA_Out(uint8_t, const char *, size_t, bool);
 void NMEA_Outs(uint16_t, const char *, unsigned int, bool);
+void NMEA_Flush(void);
 void NMEAOutC(int nmeatype);   // with checksum
 void NMEAOutD(void);           // without checksum
 void NMEA_GGA(void);
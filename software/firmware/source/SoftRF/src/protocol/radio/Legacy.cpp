@@ -435,6 +435,24 @@ bool latest_decode(void* buffer, container_t* this_aircraft, ufo_t* fop)
     return true;
 }
 
+// same packet heard again, usually in the 2nd time slot
+bool legacy_duplicate(uint32_t addr, uint16_t crc)
+{
+    int i = Traffic_Find(addr);
+    if (i < MAX_TRACKING_OBJECTS) {
+        if (crc != 0 && crc == Container[i].last_crc) {
+          //Serial.println("duplicate packet");
+          bool exempt = (Container[i].aircraft_type == AIRCRAFT_TYPE_UNKNOWN
+                          && settings->altprotocol != RF_PROTOCOL_NONE
+                          && (RF_time & 0x0F) == 0x0F);
+             // exempt last slot in 16 sec cycle for landed-out relay in alt-protocol
+          if (! exempt)
+              return true;
+        }
+    }
+    return false;
+}
+
 bool legacy_decode(void *buffer, container_t *this_aircraft, ufo_t *fop) {
 
     legacy_packet_t *pkt = (legacy_packet_t *) buffer;
@@ -454,20 +472,12 @@ bool legacy_decode(void *buffer, container_t *this_aircraft, ufo_t *fop) {
         }
     }
 
-    for (int i=0; i < MAX_TRACKING_OBJECTS; i++) {
-      if (Container[i].addr == fop->addr) {
-        if (RF_last_crc != 0 && RF_last_crc == Container[i].last_crc) {
-          //Serial.println("duplicate packet");  // usually duplicated in 2nd time slot
-          bool exempt = (Container[i].aircraft_type == AIRCRAFT_TYPE_UNKNOWN
-                          && settings->altprotocol != RF_PROTOCOL_NONE
-                          && (RF_time & 0x0F) == 0x0F);
-             // exempt last slot in 16 sec cycle for landed-out relay in alt-protocol
-          if (! exempt)
-              return false;
-        }
-        break;
-      }
-    }
+#if defined(USE_RF_TASK)
+    /* Container[] belongs to the main loop, ParseQueued() checks there */
+    if (! RF_Task_Active())
+#endif /* USE_RF_TASK */
+    if (legacy_duplicate(fop->addr, RF_last_crc))
+        return false;
     fop->last_crc = RF_last_crc;
 
     //uint32_t timestamp = (uint32_t) this_aircraft->timestamp;
@@ -65,6 +65,7 @@ const rf_proto_desc_t ogntp_proto_desc = {
 static GPS_Position pos;
 static OGN_TxPacket ogn_tx_pkt;
 static OGN_RxPacket ogn_rx_pkt;
+static LDPC_MinSumDecoder ogn_fec;
 
 void ogntp_init()
 {
@@ -155,6 +156,20 @@ bool ogntp_decode(void *pkt, container_t *this_aircraft, ufo_t *fop) {
   return true;
 }
 
+/*
+ * Second chance for a packet which has failed the parity checks:
+ * soft decision decoding, with the Manchester error pattern (NULL when
+ * the radio decodes Manchester in hardware) marking the doubtful bits.
+ * The acceptance limits are in LDPC_MinSumDecoder, as measured with
+ * extras/ldpc_bench: without the error pattern no repair is taken.
+ * Whatever it lets through still has to pass Traffic_Plausible().
+ */
+bool ogntp_repair(uint8_t *pkt, const uint8_t *err)
+{
+  RF_last_repaired = ogn_fec.Repair(pkt, err);
+  return RF_last_repaired;
+}
+
 size_t ogntp_encode(void *pkt, container_t *this_aircraft) {
 
   uint32_t *key = settings->igc_key;
@@ -46,6 +46,7 @@ typedef struct {
 extern const rf_proto_desc_t ogntp_proto_desc;
 
 bool ogntp_decode(void *, container_t *, ufo_t *);
+bool ogntp_repair(uint8_t *, const uint8_t *);
 size_t ogntp_encode(void *, container_t *);
 
 #endif /* PROTOCOL_OGNTP_H */
\ No newline at end of file
@@ -0,0 +1,178 @@
+/*
+ * Prof.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SoC.h"
+#include "Prof.h"
+#include "../driver/Settings.h"
+#include "../protocol/data/NMEA.h"
+
+const char *Prof_Name[PROF_COUNT] = {
+  "loop",        "RF_loop",      "normal",       "Baro",
+  "GNSS",        "Time",         "RF_Receive",   "RF_Transmit",
+  "Parse",       "decode",       "AddTraffic",   "ADSB",
+  "Traffic",     "TrafficScan",  "TrafficAlarm", "Alarm",
+  "IGC",         "NMEA_Export",  "GDL90_Export", "D1090_Export",
+  "NMEA_loop",   "Display",      "LED",          "WiFi",
+  "Web",         "OTA",          "Logger",       "SoC",
+  "Bluetooth",   "USB_UART",     "Battery",      "NMEA_Flush",
+  "RF_slot",     "Task_RF_loop", "Task_Receive", "Task_decode",
+  "Task_Transmit", "Task_slot"
+};
+
+static prof_stage_t Prof_Stage[PROF_COUNT];
+
+prof_summary_t Prof_Last[PROF_COUNT];
+uint32_t       Prof_Last_Window = 0;
+
+#if defined(ESP32)
+static portMUX_TYPE Prof_mutex = portMUX_INITIALIZER_UNLOCKED;
+#define PROF_LOCK()           portENTER_CRITICAL(&Prof_mutex)
+#define PROF_UNLOCK()         portEXIT_CRITICAL(&Prof_mutex)
+#else
+#define PROF_LOCK()
+#define PROF_UNLOCK()
+#endif
+
+static uint32_t Prof_WindowMarker = 0;
+static int      Prof_reporting    = -1;   /* next stage to report, -1 = idle */
+
+void Prof_setup()
+{
+  memset(Prof_Stage, 0, sizeof(Prof_Stage));
+  Prof_WindowMarker = millis();
+}
+
+static inline uint8_t Prof_Bucket(uint32_t us)
+{
+  if (us < 2)
+    return us;
+  int msb = 31 - __builtin_clz(us);
+  int b = 2 * msb + ((us >> (msb - 1)) & 1);
+  return (b < PROF_BUCKETS ? b : PROF_BUCKETS - 1);
+}
+
+void Prof_Add(uint8_t stage, uint32_t us)
+{
+  if (stage >= PROF_COUNT)
+    return;
+
+  prof_stage_t *sp = &Prof_Stage[stage];
+
+  if (sp->count == 0 || us < sp->min_us)
+    sp->min_us = us;
+  if (us > sp->max_us)
+    sp->max_us = us;
+  sp->sum_us += us;
+  sp->count++;
+  sp->hist[Prof_Bucket(us)]++;
+}
+
+void Prof_Late(uint8_t stage)
+{
+  if (stage < PROF_COUNT)
+    Prof_Stage[stage].late++;
+}
+
+/* from another task, for stages the main loop does not add to */
+void Prof_Add_Shared(uint8_t stage, uint32_t us)
+{
+  PROF_LOCK();
+  Prof_Add(stage, us);
+  PROF_UNLOCK();
+}
+
+void Prof_Late_Shared(uint8_t stage)
+{
+  PROF_LOCK();
+  Prof_Late(stage);
+  PROF_UNLOCK();
+}
+
+/* 99th percentile, interpolated inside its bucket */
+static uint32_t Prof_P99(const prof_stage_t *sp)
+{
+  uint32_t target = (uint32_t) (((uint64_t) sp->count * 99 + 99) / 100);
+  uint32_t cum = 0;
+
+  for (int b = 0; b < PROF_BUCKETS - 1; b++) {
+    uint32_t n = sp->hist[b];
+    if (cum + n >= target && n > 0) {
+      uint32_t low, width;
+      if (b < 2) {
+        low = b;
+        width = 1;
+      } else {
+        low   = (uint32_t) (2 + (b & 1)) << (b / 2 - 1);
+        width = 1UL << (b / 2 - 1);
+      }
+      uint32_t p99 = low + (uint32_t) (((uint64_t) width * (target - cum)) / n);
+      if (p99 > sp->max_us)
+        p99 = sp->max_us;
+      if (p99 < sp->min_us)
+        p99 = sp->min_us;
+      return p99;
+    }
+    cum += n;
+  }
+  return sp->max_us;
+}
+
+/*
+ * Once a window is over, sum up and restart one stage per call, so that
+ * the report does not become a long pass of its own.
+ */
+void Prof_loop()
+{
+  if (Prof_reporting < 0) {
+    uint32_t window = millis() - Prof_WindowMarker;
+    if (window < PROF_REPORT_INTERVAL)
+      return;
+    Prof_Last_Window  = window;
+    Prof_WindowMarker = millis();
+    Prof_reporting    = 0;
+  }
+
+  int i = Prof_reporting;
+  prof_stage_t   stage;
+  prof_summary_t *ps = &Prof_Last[i];
+
+  PROF_LOCK();
+  memcpy(&stage, &Prof_Stage[i], sizeof(prof_stage_t));
+  memset(&Prof_Stage[i], 0, sizeof(prof_stage_t));
+  PROF_UNLOCK();
+
+  ps->count  = stage.count;
+  ps->min_us = stage.min_us;
+  ps->max_us = stage.max_us;
+  ps->avg_us = (stage.count ? stage.sum_us / stage.count : 0);
+  ps->p99_us = (stage.count ? Prof_P99(&stage) : 0);
+  ps->late   = stage.late;
+
+  if (++Prof_reporting >= PROF_COUNT)
+    Prof_reporting = -1;
+
+  if (ps->count == 0)
+    return;
+
+  snprintf_P(NMEABuffer, sizeof(NMEABuffer),
+    PSTR("$PSRFP,%s,%lu,%lu,%lu,%lu,%lu,%lu*"),
+    Prof_Name[i], (unsigned long) ps->count,
+    (unsigned long) ps->min_us, (unsigned long) ps->avg_us,
+    (unsigned long) ps->max_us, (unsigned long) ps->p99_us,
+    (unsigned long) ps->late);
+  NMEAOutC(NMEA_D_BASIC);
+}
@@ -0,0 +1,120 @@
+/*
+ * Prof.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFHELPER_H
+#define PROFHELPER_H
+
+#include <stdint.h>
+
+/*
+ * Time spent in each stage of the main loop, as a histogram per stage
+ * in fixed RAM.  Every PROF_REPORT_INTERVAL the last window is summed up
+ * (count, min, avg, max, p99 in us, late), sent as $PSRFP with the NMEA
+ * debug sentences, kept for the /profile Web page, and started over.
+ * Late counts the runs of a stage that missed a deadline of theirs or
+ * the radio's (see Sched.h).  The radio task adds to its own stages from
+ * the other core, through the _Shared() calls.
+ */
+
+enum
+{
+  PROF_LOOP,          /* the whole loop() pass */
+  PROF_RF,            /* RF_loop() */
+  PROF_NORMAL,
+  PROF_BARO,
+  PROF_GNSS,
+  PROF_TIME,
+  PROF_RX,            /* RF_Receive() */
+  PROF_TX,            /* RF_Encode() + RF_Transmit() */
+  PROF_PARSE,         /* ParseData(), ParseQueued() */
+  PROF_DECODE,        /* protocol_decode() */
+  PROF_ADDTRAFFIC,
+  PROF_ADSB,          /* D1090_Import(), gns5892_loop() */
+  PROF_TRAFFIC,       /* Traffic_loop(), when it runs */
+  PROF_TRF_SCAN,      /* - its pass over the Container */
+  PROF_TRF_ALARM,     /* - sounding and logging the alarm */
+  PROF_ALARM,         /* Buzzer, Strobe, Voice */
+  PROF_IGC,
+  PROF_EXP_NMEA,
+  PROF_EXP_GDL90,
+  PROF_EXP_D1090,
+  PROF_NMEA_LOOP,
+  PROF_DISPLAY,
+  PROF_LED,
+  PROF_WIFI,
+  PROF_WEB,
+  PROF_OTA,
+  PROF_LOGGER,
+  PROF_SOC,           /* SoC->loop() */
+  PROF_BT,
+  PROF_IO,            /* USB and UART */
+  PROF_BATTERY,
+  PROF_FLUSH,         /* NMEA_Flush() */
+  PROF_RF_SLOT,       /* how late the RF slot change ran, late > 5 ms */
+  PROF_TASK_RF,       /* the radio task (USE_RF_TASK): RF_loop() */
+  PROF_TASK_RX,       /* - RF_Receive() */
+  PROF_TASK_DECODE,   /* - protocol_decode(), late = queue full */
+  PROF_TASK_TX,       /* - RF_Transmit(), late = slot over before sent */
+  PROF_TASK_SLOT,     /* - ms past 300/800 ms after PPS, late = slot missed */
+  PROF_COUNT
+};
+
+#define PROF_NONE             PROF_COUNT
+
+/* 2 buckets per octave from 1 us, the last one takes everything from 196 ms */
+#define PROF_BUCKETS          36
+#define PROF_REPORT_INTERVAL  60000   /* ms */
+
+typedef struct prof_stage_struct {
+  uint32_t     count;
+  uint32_t     min_us;
+  uint32_t     max_us;
+  uint32_t     sum_us;
+  uint32_t     late;
+  uint32_t     hist[PROF_BUCKETS];
+} prof_stage_t;
+
+typedef struct prof_summary_struct {
+  uint32_t     count;
+  uint32_t     min_us;
+  uint32_t     avg_us;
+  uint32_t     max_us;
+  uint32_t     p99_us;
+  uint32_t     late;
+} prof_summary_t;
+
+extern const char     *Prof_Name[PROF_COUNT];
+extern prof_summary_t  Prof_Last[PROF_COUNT];
+extern uint32_t        Prof_Last_Window;      /* ms covered by Prof_Last */
+
+/* micros(): wraps after 71 minutes, the CPU cycle count after 18 s at 240 MHz */
+#define PROF_TICKS()          ((uint32_t) micros())
+
+void Prof_setup(void);
+void Prof_Add(uint8_t, uint32_t);
+void Prof_Late(uint8_t);
+void Prof_Add_Shared(uint8_t, uint32_t);
+void Prof_Late_Shared(uint8_t);
+void Prof_loop(void);
+
+/* us since t0 into the stage */
+#define Prof_Since(stage, t0) Prof_Add(stage, PROF_TICKS() - (t0))
+
+#define PROF_RUN(stage, call) \
+  do { uint32_t _prof_t0 = PROF_TICKS(); call; Prof_Since(stage, _prof_t0); } while (0)
+
+#endif /* PROFHELPER_H */
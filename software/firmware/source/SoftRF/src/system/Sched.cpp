@@ -0,0 +1,149 @@
+/*
+ * Sched.cpp
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "SoC.h"
+#include "Sched.h"
+#include "Prof.h"
+#include "../driver/RF.h"
+
+sched_job_t Sched_Jobs[SCHED_COUNT] = {
+  /* name        prio               steps  prof             period  deadline */
+  { "RF",       SCHED_PRIO_RT,     1,     PROF_RF,         0,      0    },
+  { "Traffic",  SCHED_PRIO_RT,     1,     PROF_NONE,       0,      0    },  /* times itself when it runs */
+  { "Alarm",    SCHED_PRIO_RT,     1,     PROF_ALARM,      0,      0    },
+  { "Export",   SCHED_PRIO_NORMAL, 3,     PROF_EXP_NMEA,   1000,   300  },  /* NMEA, GDL90, D1090 */
+  { "IGC",      SCHED_PRIO_NORMAL, 1,     PROF_IGC,        0,      80   },  /* inside its 100 ms window */
+  { "Display",  SCHED_PRIO_NORMAL, 1,     PROF_DISPLAY,    0,      1000 },
+  { "LED",      SCHED_PRIO_NORMAL, 1,     PROF_LED,        0,      500  },
+  { "WiFi",     SCHED_PRIO_NORMAL, 1,     PROF_WIFI,       0,      500  },
+  { "Web",      SCHED_PRIO_NORMAL, 1,     PROF_WEB,        0,      1000 },
+  { "OTA",      SCHED_PRIO_NORMAL, 1,     PROF_OTA,        0,      1000 },
+  { "Logger",   SCHED_PRIO_NORMAL, 1,     PROF_LOGGER,     0,      1000 },
+  { "Battery",  SCHED_PRIO_NORMAL, 1,     PROF_BATTERY,    0,      2000 },
+};
+
+static uint32_t Sched_pass        = 1;
+static uint32_t Sched_RF_deadline = 0;   /* last one accounted for */
+
+/*
+ * Called first thing in loop(), before RF_loop().  A deadline that has
+ * gone by is the slot change RF_loop() is about to do: this is how late.
+ */
+void Sched_loop()
+{
+  ++Sched_pass;
+
+  uint32_t deadline = RF_Next_Deadline();
+  if (deadline == 0 || deadline == Sched_RF_deadline)
+    return;
+
+  uint32_t now_ms = millis();
+  if ((int32_t) (now_ms - deadline) < 0)
+    return;
+
+  Sched_RF_deadline = deadline;
+
+  uint32_t late = now_ms - deadline;
+  Prof_Add(PROF_RF_SLOT, late * 1000);
+  if (late > SCHED_RF_SLACK_MS)
+    Prof_Late(PROF_RF_SLOT);
+}
+
+/* microseconds left before the radio needs the loop back */
+int32_t Sched_Budget_us()
+{
+  uint32_t deadline = RF_Next_Deadline();
+  if (deadline == 0)
+    return INT32_MAX;
+
+  int32_t ms = (int32_t) (deadline - millis());
+  if (ms > 2000)
+    ms = 2000;
+  return ms * 1000 - SCHED_MARGIN_US;
+}
+
+bool Sched_Start(uint8_t id)
+{
+  sched_job_t *job = &Sched_Jobs[id];
+  uint32_t now_ms = millis();
+
+  if (job->period == 0 && job->step == 0) {
+    /* due since the first of the consecutive passes that asked for it */
+    if (!job->held || job->asked + 1 != Sched_pass)
+      job->due = now_ms;
+  } else if (job->due == 0) {
+    job->due = now_ms;
+  } else if ((int32_t) (now_ms - job->due) < 0) {
+    return false;
+  }
+  job->asked = Sched_pass;
+
+  if (job->prio != SCHED_PRIO_RT && Sched_Budget_us() < (int32_t) job->cost_peak_us) {
+    if ((int32_t) (now_ms - job->due) <= (int32_t) job->deadline) {
+      job->held = true;
+      return false;
+    }
+    Prof_Late(job->prof + job->step);    /* waited long enough, run it anyway */
+  }
+
+  job->held = false;
+  if (job->step == 0)
+    job->cycle = now_ms;
+  job->rf_deadline = RF_Next_Deadline();
+  job->started_us = PROF_TICKS();
+  return true;
+}
+
+void Sched_Done(uint8_t id)
+{
+  sched_job_t *job = &Sched_Jobs[id];
+  uint32_t us = PROF_TICKS() - job->started_us;
+  uint32_t now_ms = millis();
+
+  if (job->prof != PROF_NONE)
+    Prof_Add(job->prof + job->step, us);
+
+  /*
+   * Budget for the slow runs, not the typical one: a Web request or a log
+   * flush every few hundred passes is what would make the radio late.
+   */
+  if (us >= job->cost_peak_us) {
+    job->cost_peak_us = us;
+    job->cost_peak_ms = now_ms;
+  } else if (now_ms - job->cost_peak_ms > SCHED_PEAK_HALFLIFE) {
+    job->cost_peak_us /= 2;
+    job->cost_peak_ms = now_ms;
+  }
+
+  /* was running when an RF deadline went by */
+  if (job->rf_deadline != 0 &&
+      (int32_t) (now_ms - job->rf_deadline) > SCHED_RF_SLACK_MS &&
+      (int32_t) (now_ms - us / 1000 - job->rf_deadline) < 0)
+    Prof_Late(job->prof + job->step);
+
+  if (++job->step < job->steps) {
+    job->due = now_ms;         /* next step on the next pass */
+    return;
+  }
+  job->step = 0;
+  job->due = job->cycle + job->period;
+}
+
+uint8_t Sched_Step(uint8_t id)
+{
+  return Sched_Jobs[id].step;
+}
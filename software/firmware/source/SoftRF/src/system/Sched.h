@@ -0,0 +1,95 @@
+/*
+ * Sched.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCHEDHELPER_H
+#define SCHEDHELPER_H
+
+#include <stdint.h>
+
+/*
+ * Cooperative scheduling of the main loop around the RF slot timing.
+ *
+ * SCHED_PRIO_RT jobs (radio, traffic alarms, alarm output) run on every pass.
+ * The others only start when their measured cost fits before the next RF
+ * deadline (see RF_Next_Deadline()), else they wait for a later pass -
+ * but no longer than their own deadline, after that they run anyway
+ * and it counts as a miss.  Long jobs run in steps, one step per pass.
+ * A job with no period is due from the first pass it is asked for.
+ * Sched_Done() hands the time a job took to its Prof stage, so a job
+ * is not timed again inside SCHED_RUN(), and a miss or a run over an
+ * RF deadline counts as late there.  Sched_loop() times the RF slot
+ * changes into PROF_RF_SLOT.
+ */
+
+enum
+{
+  SCHED_PRIO_RT,
+  SCHED_PRIO_NORMAL
+};
+
+enum
+{
+  SCHED_RF,
+  SCHED_TRAFFIC,
+  SCHED_ALARM,
+  SCHED_EXPORT,
+  SCHED_IGC,
+  SCHED_DISPLAY,
+  SCHED_LED,
+  SCHED_WIFI,
+  SCHED_WEB,
+  SCHED_OTA,
+  SCHED_LOGGER,
+  SCHED_BATTERY,
+  SCHED_COUNT
+};
+
+#define SCHED_MARGIN_US       2000    /* kept free before an RF deadline */
+#define SCHED_RF_SLACK_MS     5       /* RF_loop() later than this is a miss */
+#define SCHED_PEAK_HALFLIFE   10000   /* ms */
+
+typedef struct sched_job_struct {
+  const char   *name;
+  uint8_t      prio;
+  uint8_t      steps;         /* > 1 for a job split into resumable steps */
+  uint8_t      prof;          /* Prof stage of the first step, one per step */
+  uint16_t     period;        /* ms from one run to the next, 0 = every pass */
+  uint16_t     deadline;      /* ms a due job may be held back */
+
+  uint8_t      step;          /* next step to run */
+  bool         held;          /* due, but waiting for the radio */
+  uint32_t     due;           /* millis() */
+  uint32_t     cycle;         /* millis() the first step started */
+  uint32_t     asked;         /* pass it was last wanted in */
+  uint32_t     started_us;
+  uint32_t     rf_deadline;   /* RF_Next_Deadline() when it started */
+  uint32_t     cost_peak_us;  /* what it is budgeted for, halves every 10 s */
+  uint32_t     cost_peak_ms;
+} sched_job_t;
+
+extern sched_job_t Sched_Jobs[SCHED_COUNT];
+
+void    Sched_loop(void);
+bool    Sched_Start(uint8_t);
+void    Sched_Done(uint8_t);
+uint8_t Sched_Step(uint8_t);
+int32_t Sched_Budget_us(void);
+
+#define SCHED_RUN(job, call) \
+  do { if (Sched_Start(job)) { call; Sched_Done(job); } } while (0)
+
+#endif /* SCHEDHELPER_H */
@@ -27,6 +27,25 @@ uint32_t ref_time_ms = 0;      /* assumed local millis() at last PPS */
 
 #define ADJ_FOR_FLARM_RECEPTION 25     // was 40 - seemed to receive FLARM packets better that way
 
+#if defined(USE_RF_TASK)
+/* Time_loop() is the only writer, the radio task on the other core reads a snapshot */
+static portMUX_TYPE Time_mutex = portMUX_INITIALIZER_UNLOCKED;
+#define TIME_LOCK()    portENTER_CRITICAL(&Time_mutex)
+#define TIME_UNLOCK()  portEXIT_CRITICAL(&Time_mutex)
+#else
+#define TIME_LOCK()
+#define TIME_UNLOCK()
+#endif /* USE_RF_TASK */
+
+/* OurTime and ref_time_ms as a consistent pair */
+void Time_Snapshot(time_t *timep, uint32_t *ref_ms)
+{
+    TIME_LOCK();
+    *timep  = OurTime;
+    *ref_ms = ref_time_ms;
+    TIME_UNLOCK();
+}
+
 #if defined(ESP32)
 #define EXCLUDE_NTP
 #endif
@@ -181,6 +200,62 @@ void Time_setup()
 #endif /* EXCLUDE_NTP */
 
 
+/* was in RF_SetChannel(), for the protocols that still use it */
+static void Time_from_GNSS(uint32_t now_ms)
+{
+    tmElements_t  tm;
+    uint32_t pps_btime_ms, time_corr_neg, ref_ms;
+    static uint32_t gnss_date_prev = (uint32_t) -1, gnss_time_prev = (uint32_t) -1;
+    static time_t   gnss_utc_prev  = 0;
+
+    pps_btime_ms = SoC->get_PPS_TimeMarker();
+
+    if (pps_btime_ms) {
+      if (now_ms > pps_btime_ms + 1010)
+        pps_btime_ms += 1000;
+      uint32_t last_Commit_Time = now_ms - gnss.time.age();
+      if (pps_btime_ms <= last_Commit_Time) {
+        time_corr_neg = (last_Commit_Time - pps_btime_ms) % 1000;
+      } else {
+        time_corr_neg = 1000 - ((pps_btime_ms - last_Commit_Time) % 1000);
+      }
+      ref_ms = pps_btime_ms;
+    } else {
+      uint32_t last_RMC_Commit = now_ms - gnss.date.age();
+      time_corr_neg = 100;
+      if (gnss_chip)
+          time_corr_neg = gnss_chip->rmc_ms;
+      ref_ms = last_RMC_Commit - time_corr_neg;
+    }
+
+    /* broken-down GNSS time only changes with a new fix */
+    if (gnss.date.value() != gnss_date_prev ||
+        gnss.time.value() != gnss_time_prev) {
+      int yr    = gnss.date.year();
+      if( yr > 99)
+          yr    = yr - 1970;
+      else
+          yr    += 30;
+      tm.Year   = yr;
+      tm.Month  = gnss.date.month();
+      tm.Day    = gnss.date.day();
+      tm.Hour   = gnss.time.hour();
+      tm.Minute = gnss.time.minute();
+      tm.Second = gnss.time.second();
+
+      gnss_utc_prev  = makeTime(tm);
+      gnss_date_prev = gnss.date.value();
+      gnss_time_prev = gnss.time.value();
+    }
+
+    time_t Time = gnss_utc_prev + (gnss.time.age() + time_corr_neg) / 1000;
+
+    TIME_LOCK();
+    OurTime     = Time;
+    ref_time_ms = ref_ms;
+    TIME_UNLOCK();
+}
+
 /* Experimental code by Moshe Braner, specific to Legacy Protocol */
 void Time_loop()
 {
@@ -214,19 +289,24 @@ void Time_loop()
     }
 #endif
 
+    if (settings->rf_protocol != RF_PROTOCOL_LEGACY
+     && settings->rf_protocol != RF_PROTOCOL_LATEST
+     && settings->rf_protocol != RF_PROTOCOL_OGNTP) {
+        /* slots and channels still handled in RF.cpp RF_SetChannel() */
+        if (settings->mode == SOFTRF_MODE_NORMAL)
+            Time_from_GNSS(now_ms);
+        return;
+    }
+
     if (now_ms - last_loop < 20)
         return;
     last_loop = now_ms;
 
-    if (settings->rf_protocol != RF_PROTOCOL_LEGACY
-     && settings->rf_protocol != RF_PROTOCOL_LATEST
-     && settings->rf_protocol != RF_PROTOCOL_OGNTP)
-        return;       /* time still handled in RF.cpp RF_SetChannel() */
-
     uint32_t gnss_age;
     uint32_t pps_btime_ms;
     uint32_t newtime;
     uint32_t time_corr_neg;   // ms from PPS to commit_time
+    uint32_t new_ref_ms;      // ref_time_ms to go with the new OurTime
 
     bool newfix = false;
     if (isValidFix() && gnss_new_time) {     // set in GNSS.cpp
@@ -238,15 +318,21 @@ void Time_loop()
     if (settings->debug_flags & DEBUG_SIMULATE) {
 
         // simulate PPS based on millis()
-        if (ref_time_ms == 0)
+        if (ref_time_ms == 0) {
+            TIME_LOCK();
             ref_time_ms = 1000 * (now_ms / 1000);  // most recent multiple of 1000
+            TIME_UNLOCK();
+        }
         if (!newfix) {
             if (now_ms >= ref_time_ms + 1000) {
+              TIME_LOCK();
               OurTime += 1;
               ref_time_ms += 1000;
+              TIME_UNLOCK();
             }
             return;
         }
+        new_ref_ms = ref_time_ms;
         pps_btime_ms = ref_time_ms;
         if (latest_Commit_Time < pps_btime_ms)
             pps_btime_ms -= 1000;
@@ -309,8 +395,10 @@ no_pps_time = latest_Commit_Time - no_pps_corr;
     /* between fixes (but not before first fix): free-running clock */
     if (! newfix) {
         if (ref_time_ms > 0 && now_ms >= ref_time_ms + 1000) {
+          TIME_LOCK();
           OurTime += 1;
           ref_time_ms += 1000;
+          TIME_UNLOCK();
         }
         return;
     }
@@ -336,7 +424,7 @@ no_pps_time = latest_Commit_Time - no_pps_corr;
       //ref_time_ms = base_time_ms = newtime;
     }
 
-    ref_time_ms = base_time_ms = newtime;
+    new_ref_ms = base_time_ms = newtime;
 
     }   // end of if (settings->debug_flags & DEBUG_SIMULATE)
 
@@ -353,17 +441,22 @@ no_pps_time = latest_Commit_Time - no_pps_corr;
     tm.Minute = gnss.time.minute();
     tm.Second = gnss.time.second();
 
-    OurTime = makeTime(tm);
+    time_t new_time = makeTime(tm);
     if (gnss_age + time_corr_neg >= 1000)
-        OurTime += 1;
-    /* updated ref_time_ms is the other side effect */
+        new_time += 1;
 
     // apply a correction to leap seconds if available
     // (set up in GNSS_loop based on Ublox leap-seconds and settings->leapsecs)
     if (leap_seconds_correction > 0)
-        OurTime -= (uint32_t) leap_seconds_correction;
+        new_time -= (uint32_t) leap_seconds_correction;
     else if (leap_seconds_correction < 0)
-        OurTime += (uint32_t) (-leap_seconds_correction);
+        new_time += (uint32_t) (-leap_seconds_correction);
+
+    /* updated ref_time_ms is the other side effect */
+    TIME_LOCK();
+    OurTime     = new_time;
+    ref_time_ms = new_ref_ms;
+    TIME_UNLOCK();
 
     last_utc = now_ms;
 
@@ -30,5 +30,6 @@ extern uint32_t ref_time_ms;
 
 void Time_setup(void);
 void Time_loop(void);
+void Time_Snapshot(time_t *, uint32_t *);
 
 #endif /* TIMEHELPER_H */
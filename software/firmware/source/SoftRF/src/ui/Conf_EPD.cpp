@@ -92,8 +92,9 @@ NMEA2: USB LD
           (settings->txpower == RF_TX_POWER_LOW  ? "tx" : "--" )),
           Protocol_ID[settings->rf_protocol],
           (settings->alarm == TRAFFIC_ALARM_LATEST ? "LAT" :
+          (settings->alarm == TRAFFIC_ALARM_CPA    ? "CPA" :
           (settings->alarm == TRAFFIC_ALARM_VECTOR ? "VCT" :
-          (settings->alarm == TRAFFIC_ALARM_DISTANCE ? "DST" : "---"))));
+          (settings->alarm == TRAFFIC_ALARM_DISTANCE ? "DST" : "---")))));
       display->getTextBounds(info_line, 0, 0, &tbx, &tby, &tbw, &tbh);
       y += tbh;
       display->setCursor(x, y);
@@ -53,6 +53,8 @@ enum {
 static int view_state_curr = STATE_TVIEW_NONE;
 static int view_state_prev = STATE_TVIEW_NONE;
 
+static traffic_by_dist_t traffic_shown[MAX_TRACKING_OBJECTS];
+
 
 static void EPD_Draw_Text()
 {
@@ -63,13 +65,10 @@ static void EPD_Draw_Text()
   char info_line [TEXT_VIEW_LINE_LENGTH];
   char id_text   [TEXT_VIEW_LINE_LENGTH];
 
-  for (i=0; i < MAX_TRACKING_OBJECTS; i++) {
-    if (Container[i].addr && (OurTime - Container[i].timestamp) <= EPD_EXPIRATION_TIME) {
-
-      traffic_by_dist[j].fop = &Container[i];
-      traffic_by_dist[j].distance = Container[i].distance;
-      j++;
-    }
+  /* traffic_by_dist[] is kept sorted by distance, just skip the stale entries */
+  for (i=0; i < traffic_by_dist_n; i++) {
+    if ((OurTime - traffic_by_dist[i].fop->timestamp) <= EPD_EXPIRATION_TIME)
+      traffic_shown[j++] = traffic_by_dist[i];
   }
 
 #if defined(USE_EPD_TASK)
@@ -83,8 +82,6 @@ static void EPD_Draw_Text()
     float disp_dist;
     int   disp_alt, disp_spd;
 
-    qsort(traffic_by_dist, j, sizeof(traffic_by_dist_t), traffic_cmp_by_distance);
-
     if (EPD_current > j) {
       if (prev_j > j) {
         EPD_current = j;
@@ -95,7 +92,7 @@ static void EPD_Draw_Text()
     prev_j = j;
     i = EPD_current - 1;
 
-    bearing = (int) traffic_by_dist[i].fop->bearing;
+    bearing = (int) traffic_shown[i].fop->bearing;
 
     /* This bearing is always relative to current ground track */
 //  if (ui->orientation == DIRECTION_TRACK_UP) {
@@ -106,7 +103,7 @@ static void EPD_Draw_Text()
       bearing += 360;
 
     int oclock = ((bearing + 15) % 360) / 30;
-    float RelativeVertical = traffic_by_dist[i].fop->altitude -
+    float RelativeVertical = traffic_shown[i].fop->altitude -
                                 ThisAircraft.altitude;
 
     switch (ui->units)
@@ -115,36 +112,36 @@ static void EPD_Draw_Text()
       u_dist = "nm";
       u_alt  = "f";
       u_spd  = "kts";
-      disp_dist = (traffic_by_dist[i].distance * _GPS_MILES_PER_METER) /
+      disp_dist = (traffic_shown[i].distance * _GPS_MILES_PER_METER) /
                   _GPS_MPH_PER_KNOT;
       disp_alt  = abs((int) (RelativeVertical * _GPS_FEET_PER_METER));
-      disp_spd  = traffic_by_dist[i].fop->speed;
+      disp_spd  = traffic_shown[i].fop->speed;
       break;
     case UNITS_MIXED:
       u_dist = "km";
       u_alt  = "f";
       u_spd  = "kph";
-      disp_dist = traffic_by_dist[i].distance / 1000.0;
+      disp_dist = traffic_shown[i].distance / 1000.0;
       disp_alt  = abs((int) (RelativeVertical * _GPS_FEET_PER_METER));
-      disp_spd  = traffic_by_dist[i].fop->speed * _GPS_KMPH_PER_KNOT;
+      disp_spd  = traffic_shown[i].fop->speed * _GPS_KMPH_PER_KNOT;
       break;
     case UNITS_METRIC:
     default:
       u_dist = "km";
       u_alt  = "m";
       u_spd  = "kph";
-      disp_dist = traffic_by_dist[i].distance / 1000.0;
+      disp_dist = traffic_shown[i].distance / 1000.0;
       disp_alt  = abs((int) RelativeVertical);
-      disp_spd  = traffic_by_dist[i].fop->speed * _GPS_KMPH_PER_KNOT;
+      disp_spd  = traffic_shown[i].fop->speed * _GPS_KMPH_PER_KNOT;
       break;
     }
 
     if (ui->epdidpref == ID_TYPE) {
-      uint8_t acft_type = traffic_by_dist[i].fop->aircraft_type;
+      uint8_t acft_type = traffic_shown[i].fop->aircraft_type;
       acft_type = acft_type > AIRCRAFT_TYPE_STATIC ? AIRCRAFT_TYPE_UNKNOWN : acft_type;
       strncpy(id_text, Aircraft_Type[acft_type], sizeof(id_text));
     } else {
-      uint32_t id = traffic_by_dist[i].fop->addr;
+      uint32_t id = traffic_shown[i].fop->addr;
 
       if (!(SoC->ADB_ops && SoC->ADB_ops->query(DB_OGN, id, id_text, sizeof(id_text)))) {
         snprintf(id_text, sizeof(id_text), "ID: %06X", id);
@@ -166,7 +163,7 @@ static void EPD_Draw_Text()
 
       //snprintf(info_line, sizeof(info_line), "Traffic %d/%d", EPD_current, j);
       snprintf(info_line, sizeof(info_line), "%d/%d RSSI %d",
-          EPD_current, j, traffic_by_dist[i].fop->rssi);
+          EPD_current, j, traffic_shown[i].fop->rssi);
       display->getTextBounds(info_line, 0, 0, &tbx, &tby, &tbw, &tbh);
       y += tbh;
       display->setCursor(x, y);
@@ -216,7 +213,7 @@ static void EPD_Draw_Text()
       y += TEXT_VIEW_LINE_SPACING;
 
       snprintf(info_line, sizeof(info_line), "CoG %3d deg",
-               (int) traffic_by_dist[i].fop->course);
+               (int) traffic_shown[i].fop->course);
       display->getTextBounds(info_line, 0, 0, &tbx, &tby, &tbw, &tbh);
       y += tbh;
       display->setCursor(x, y);
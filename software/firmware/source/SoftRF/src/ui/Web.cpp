@@ -57,6 +57,7 @@ void Web_fini()     {}
 #include "../protocol/data/GDL90.h"
 #include "../protocol/data/D1090.h"
 #include "../protocol/data/GNS5892.h"
+#include "../system/Prof.h"
 
 #if defined(ENABLE_AHRS)
 #include "../driver/AHRS.h"
@@ -237,10 +238,131 @@ void serve_html(const char *html)
     SoC->swSer_enableRx(true);
 }
 
+/*
+ * The settings pages are streamed out a piece at a time (chunked transfer)
+ * from one small static buffer, instead of being built whole in a malloc()ed
+ * buffer of 10+ KB.  That keeps the heap needed for a page view to about 1 KB,
+ * so Bluetooth (NMEA to the flight computer) no longer needs to be stopped.
+ */
+#define WEB_CHUNK_SIZE 1024
+static char web_chunk[WEB_CHUNK_SIZE];
+static size_t web_chunk_len = 0;
+static size_t web_page_size = 0;
+
+static void chunk_begin()
+{
+    SoC->swSer_enableRx(false);
+    server.sendHeader(String(F("Cache-Control")), String(F("no-cache, no-store, must-revalidate")));
+    server.sendHeader(String(F("Pragma")), String(F("no-cache")));
+    server.sendHeader(String(F("Expires")), String(F("-1")));
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, texthtml, "");
+    web_chunk_len = 0;
+    web_page_size = 0;
+}
+
+static void chunk_flush()
+{
+    if (web_chunk_len == 0)
+        return;
+    server.sendContent_P(web_chunk, web_chunk_len);
+    web_page_size += web_chunk_len;
+    web_chunk_len = 0;
+    yield();
+}
+
+// append formatted text, sending the buffer first if the text does not fit
+static void chunk_printf(PGM_P fmt, ...)
+{
+    va_list ap;
+    for (int tries=0; tries<2; tries++) {
+        size_t room = WEB_CHUNK_SIZE - web_chunk_len;
+        va_start(ap, fmt);
+        int n = vsnprintf_P(web_chunk + web_chunk_len, room, fmt, ap);
+        va_end(ap);
+        if (n < 0)
+            return;
+        if ((size_t) n < room) {
+            web_chunk_len += n;
+            return;
+        }
+        if (web_chunk_len == 0)    // longer than a whole chunk
+            break;
+        chunk_flush();
+    }
+    Serial.println(F(">>> web chunk overflow"));
+    web_chunk_len = WEB_CHUNK_SIZE - 1;    // send what fitted
+}
+
+static void chunk_end()
+{
+    chunk_flush();
+    server.sendContent("");    // end of the chunked data
+    SoC->swSer_enableRx(true);
+    Serial.print(F("Page size: "));
+    Serial.print(web_page_size);
+    Serial.print(F(" Free memory: "));
+    Serial.println(ESP.getFreeHeap());
+}
+
+struct web_option {
+    uint8_t value;
+    const char *text;
+};
+
+static uint8_t stg_value(int stg)
+{
+    return *(uint8_t *) stgdesc[stg].value;
+}
+
+// a drop-down list for a setting, the INPUT named by the setting's label
+static void chunk_select(const char *title, int stg, const web_option *opts, int n)
+{
+    uint8_t v = stg_value(stg);
+    chunk_printf(PSTR("\
+<tr>\
+<th align=left>%s</th>\
+<td align=right>\
+<select name='%s'>"), title, stgdesc[stg].label);
+    for (int i=0; i<n; i++)
+        chunk_printf(PSTR("<option %s value='%d'>%s</option>"),
+            (opts[i].value == v ? "selected" : ""), opts[i].value, opts[i].text);
+    chunk_printf(PSTR("\
+</select>\
+</td>\
+</tr>"));
+}
+
+// Off/On radio buttons - "On" keeps a non-zero (bitfield) value, else sets 1
+static void chunk_onoff(const char *title, int stg)
+{
+    const char *w = stgdesc[stg].label;
+    uint8_t v = stg_value(stg);
+    chunk_printf((stgdesc[stg].type == STG_HEX2 ? PSTR("\
+<tr>\
+<th align=left>%s</th>\
+<td align=right>\
+<input type='radio' name='%s' value='0' %s>Off\
+<input type='radio' name='%s' value='%02X' %s>On\
+</td>\
+</tr>") : PSTR("\
+<tr>\
+<th align=left>%s</th>\
+<td align=right>\
+<input type='radio' name='%s' value='0' %s>Off\
+<input type='radio' name='%s' value='%d' %s>On\
+</td>\
+</tr>")),
+      title, w, (v ? "" : "checked"), w, (v ? v : 1), (v ? "checked" : ""));
+}
+
+#define NUM_OPTIONS(a) (sizeof(a) / sizeof(web_option))
+
 void serve_file(File file, const char *filename, const char *RAMbuf=NULL)
 {
     char buf[64];
     snprintf(buf, 64, "attachment; filename=%s", filename);
+    NMEA_Flush();       // what this pass gathered, before the long wait
     SoC->swSer_enableRx(false);
     yield();
     SoC->WDT_fini();    // otherwise serving large files result in WDT crash
@@ -256,6 +378,71 @@ void serve_file(File file, const char *filename, const char *RAMbuf=NULL)
     SoC->swSer_enableRx(true);
 }
 
+// HHMMSS to seconds since midnight
+static uint32_t hhmmss2sec(const String &s)
+{
+    long v = s.toInt();
+    return (3600 * (v / 10000) + 60 * ((v / 100) % 100) + (v % 100));
+}
+
+// an IGZ file being sent as IGC, a few pieces per Web_loop() pass
+#define IGZ_CHUNKS_PER_PASS  4
+static igz_stream_t igz;
+static char igcbuf[1024];
+static WiFiClient igz_client;
+static bool igz_sending = false;
+
+static void igz_done()
+{
+    IGZ_close(&igz);
+    igz_client.stop();
+    igz_sending = false;
+}
+
+// called from Web_loop(), gives up when the client has gone away
+static void igz_send_more()
+{
+    for (int i=0; i<IGZ_CHUNKS_PER_PASS; i++) {
+        if (! igz_client.connected()) {
+            Serial.println(F("IGC download aborted"));
+            igz_done();
+            return;
+        }
+        size_t n = IGZ_read(&igz, igcbuf, sizeof(igcbuf));
+        if (n == 0) {
+            igz_done();
+            return;
+        }
+        igz_client.write((const uint8_t *) igcbuf, n);
+    }
+}
+
+// send an IGZ file as IGC, decompressing a piece at a time from Web_loop()
+// - with ?from=HHMMSS&to=HHMMSS (UTC) only that part of the flight is sent
+// - the response ends when the connection is closed
+bool serve_igz(const char *zpath, const char *filename)
+{
+    if (igz_sending) {
+        server.send(503, textplain, "another IGC download is in progress");
+        return true;
+    }
+    if (! IGZ_open(&igz, zpath))
+        return false;
+    if (server.hasArg("from")) {
+        uint32_t from = hhmmss2sec(server.arg("from"));
+        uint32_t to = (server.hasArg("to")? hhmmss2sec(server.arg("to")) : from + 300);
+        IGZ_window(&igz, from, to);
+    }
+    igz_client = server.client();    // kept after the WebServer lets go of it
+    igz_client.print(F("HTTP/1.1 200 OK\r\nContent-Type: "));
+    igz_client.print(octet);
+    igz_client.print(F("\r\nContent-Disposition: attachment; filename="));
+    igz_client.print(filename);
+    igz_client.print(F("\r\nConnection: close\r\n\r\n"));
+    igz_sending = true;
+    return true;
+}
+
 void anyUpload(bool toSD)
 {
   HTTPUpload& uploading = server.upload();
@@ -339,6 +526,7 @@ void egmUpload()
 void wavUpload()   // into SPIFFS
 {
     //Serial.println(F("Replacing waves.tar in SPIFFS..."));
+    Voice_flush();
     clear_waves();
     anyUpload(false);
 }
@@ -562,29 +750,14 @@ void handleSettings() {
 
   Serial.println(F("handleSettings()..."));
 
-  stop_bluetooth((size_t)70000);
-
   bool is_prime_mk2 = false;
   if (hw_info.model == SOFTRF_MODEL_PRIME_MK2 /* && hw_info.revision >= 5 */)
     is_prime_mk2 = true;
 
-  size_t size = 10000;
-  size_t totalsize = size;
-  char *offset;
-  size_t len = 0;
-  char *Settings_temp = (char *) malloc(size);
-
-  if (Settings_temp == NULL) {
-    Serial.println(F(">>> not enough RAM"));
-    return;
-  }
-
-  Serial.println(F("Constructing basic settings page..."));
-
-  offset = Settings_temp;
+  chunk_begin();
 
   /* Common part 1 */
-  snprintf_P ( offset, size,
+  chunk_printf(
     PSTR("<html>\
 <head>\
 <meta name='viewport' content='width=device-width, initial-scale=1'>\
@@ -601,57 +774,35 @@ void handleSettings() {
 <tr><td>&nbsp;</td><th>If changed, click 'Save and restart' at the bottom</th><td>&nbsp;</td></tr>\
 </table>\
 <form action='/input' method='GET'>\
-<table border=1 frame=hsides rules=rows width=100%%>\
-<tr>\
-<th align=left>Mode</th>\
-<td align=right>\
-<select name='mode'>\
-<option %s value='%d'>Normal</option>\
-<option %s value='%d'>GNSS Bridge</option>\
-<option %s value='%d'>UAV</option>\
-<option %s value='%d'>Bridge</option>\
-</select>\
-</td>\
-</tr>"),
-  page_message(),
-  (settings->mode == SOFTRF_MODE_NORMAL ? "selected" : "") , SOFTRF_MODE_NORMAL,
-  (settings->mode == SOFTRF_MODE_GPSBRIDGE ? "selected" : ""), SOFTRF_MODE_GPSBRIDGE,
-  (settings->mode == SOFTRF_MODE_UAV ? "selected" : ""), SOFTRF_MODE_UAV,
-  (settings->mode == SOFTRF_MODE_BRIDGE ? "selected" : ""), SOFTRF_MODE_BRIDGE
-  );
-
-  len = strlen(offset);
-  offset += len;
-  size -= len;
-
-    snprintf_P ( offset, size,
-      PSTR("\
+<table border=1 frame=hsides rules=rows width=100%%>"),
+  page_message());
+
+  static const web_option modes[] = {
+    { SOFTRF_MODE_NORMAL,    "Normal" },
+    { SOFTRF_MODE_GPSBRIDGE, "GNSS Bridge" },
+    { SOFTRF_MODE_UAV,       "UAV" },
+    { SOFTRF_MODE_BRIDGE,    "Bridge" }
+  };
+  chunk_select("Mode", STG_MODE, modes, NUM_OPTIONS(modes));
+
+  chunk_printf(
+    PSTR("\
 <tr>\
 <th align=left>Device ID</th>\
 <td align=right>%06x\
 </td>\
-</tr>"),(SoC->getChipId() & 0x00FFFFFF));
-    
-  len = strlen(offset);
-  offset += len;
-  size -= len;    
-
-    snprintf_P ( offset, size,
-      PSTR("\
+</tr>\
 <tr>\
 <th align=left>Aircraft (ICAO) ID (6 HEX digits)</th>\
 <td align=right>\
 <INPUT type='text' name='aircraft_id' maxlength='6' size='6' value='%06X'>\
 </td>\
 </tr>"),
-  settings->aircraft_id);
+  (SoC->getChipId() & 0x00FFFFFF), settings->aircraft_id);
 
-  len = strlen(offset);
-  offset += len;
-  size -= len;
-
-    snprintf_P ( offset, size,
-      PSTR("\
+  /* "Device" stands for both the FLARM and the override ID types */
+  chunk_printf(
+    PSTR("\
 <tr>\
 <th align=left>ID type to use:</th>\
 <td align=right>\
@@ -667,40 +818,19 @@ void handleSettings() {
      (settings->id_method==ADDR_TYPE_OVERRIDE? ADDR_TYPE_OVERRIDE : ADDR_TYPE_FLARM),
     (settings->id_method == ADDR_TYPE_ANONYMOUS ? "selected" : ""), ADDR_TYPE_ANONYMOUS
     );
-  
-  len = strlen(offset);
-  offset += len;
-  size -= len;
 
   /* Radio specific part 1 */
   if (hw_info.rf == RF_IC_SX1276 || hw_info.rf == RF_IC_SX1262) {
-    snprintf_P ( offset, size,
-      PSTR("\
-<tr>\
-<th align=left>Protocol</th>\
-<td align=right>\
-<select name='protocol'>\
-<option %s value='%d'>%s</option>\
-<option %s value='%d'>%s</option>\
-<option %s value='%d'>%s</option>\
-<option %s value='%d'>%s</option>\
-<option %s value='%d'>%s</option>\
-</select>\
-</td>\
-</tr>"),
-    (settings->rf_protocol == RF_PROTOCOL_LEGACY ? "selected" : ""),
-     RF_PROTOCOL_LEGACY, legacy_proto_desc.name,
-    (settings->rf_protocol == RF_PROTOCOL_LATEST ? "selected" : ""),
-     RF_PROTOCOL_LATEST, "Latest",
-    (settings->rf_protocol == RF_PROTOCOL_OGNTP ? "selected" : ""),
-     RF_PROTOCOL_OGNTP, ogntp_proto_desc.name,
-    (settings->rf_protocol == RF_PROTOCOL_P3I ? "selected" : ""),
-     RF_PROTOCOL_P3I, p3i_proto_desc.name,
-    (settings->rf_protocol == RF_PROTOCOL_FANET ? "selected" : ""),
-     RF_PROTOCOL_FANET, fanet_proto_desc.name
-    );
+    const web_option protocols[] = {
+      { RF_PROTOCOL_LEGACY, legacy_proto_desc.name },
+      { RF_PROTOCOL_LATEST, "Latest" },
+      { RF_PROTOCOL_OGNTP,  ogntp_proto_desc.name },
+      { RF_PROTOCOL_P3I,    p3i_proto_desc.name },
+      { RF_PROTOCOL_FANET,  fanet_proto_desc.name }
+    };
+    chunk_select("Protocol", STG_PROTOCOL, protocols, NUM_OPTIONS(protocols));
   } else {
-    snprintf_P ( offset, size,
+    chunk_printf(
       PSTR("\
 <tr>\
 <th align=left>Protocol</th>\
@@ -717,374 +847,151 @@ void handleSettings() {
      "UNK"))))
     );
   }
-  len = strlen(offset);
-  offset += len;
-  size -= len;
 
   /* Common part 2 */
-  snprintf_P ( offset, size,
-    PSTR("\
-<tr>\
-<th align=left>Region</th>\
-<td align=right>\
-<select name='band'>\
-<!--<option %s value='%d'>AUTO</option>-->\
-<option %s value='%d'>EU (868.2 MHz)</option>\
-<option %s value='%d'>RU (868.8 MHz)</option>\
-<option %s value='%d'>CN (470 MHz)</option>\
-<option %s value='%d'>US/CA (915 MHz)</option>\
-<option %s value='%d'>NZ (869.25 MHz)</option>\
-<option %s value='%d'>AU (921 MHz)</option>\
-<option %s value='%d'>IN (866 MHz)</option>\
-<option %s value='%d'>KR (920.9 MHz)</option>\
-<option %s value='%d'>IL (916.2 MHz)</option>\
-<option %s value='%d'>UK P3I (869.52)</option>\
-</select>\
-</td>\
-</tr>\
-<tr>\
-<th align=left>Aircraft type</th>\
-<td align=right>\
-<select name='acft_type'>\
-<option %s value='%d'>Glider</option>\
-<option %s value='%d'>Towplane</option>\
-<option %s value='%d'>Powered</option>\
-<option %s value='%d'>Helicopter</option>\
-<option %s value='%d'>UAV</option>\
-<option %s value='%d'>Hangglider</option>\
-<option %s value='%d'>Paraglider</option>\
-<option %s value='%d'>Balloon</option>\
-<option %s value='%d'>Static</option>\
-<option %s value='%d'>Winch</option>\
-</select>\
-</td>\
-</tr>\
-<tr>\
-<th align=left>Alarm trigger</th>\
-<td align=right>\
-<select name='alarm'>\
-<option %s value='%d'>None</option>\
-<option %s value='%d'>Distance</option>\
-<option %s value='%d'>Vector</option>\
-<option %s value='%d'>Latest</option>\
-</select>\
-</td>\
-</tr>\
-<tr>\
-<th align=left>Buzzer</th>\
-<td align=right>\
-<select name='volume'>\
-<option %s value='%d'>Off</option>\
-<option %s value='%d'>Soft</option>\
-<option %s value='%d'>Loud</option>\
-<option %s value='%d'>External</option>\
-</select>\
-</td>\
-</tr>"),
-  (settings->band == RF_BAND_AUTO ? "selected" : ""), RF_BAND_AUTO,
-  (settings->band == RF_BAND_EU ? "selected" : ""), RF_BAND_EU,
-  (settings->band == RF_BAND_RU ? "selected" : ""), RF_BAND_RU,
-  (settings->band == RF_BAND_CN ? "selected" : ""), RF_BAND_CN,
-  (settings->band == RF_BAND_US ? "selected" : ""), RF_BAND_US,
-  (settings->band == RF_BAND_NZ ? "selected" : ""), RF_BAND_NZ,
-  (settings->band == RF_BAND_AU ? "selected" : ""), RF_BAND_AU,
-  (settings->band == RF_BAND_IN ? "selected" : ""), RF_BAND_IN,
-  (settings->band == RF_BAND_KR ? "selected" : ""), RF_BAND_KR,
-  (settings->band == RF_BAND_IL ? "selected" : ""), RF_BAND_IL,
-  (settings->band == RF_BAND_UK ? "selected" : ""), RF_BAND_UK,
-  (settings->acft_type == AIRCRAFT_TYPE_GLIDER ? "selected" : ""),  AIRCRAFT_TYPE_GLIDER,
-  (settings->acft_type == AIRCRAFT_TYPE_TOWPLANE ? "selected" : ""),  AIRCRAFT_TYPE_TOWPLANE,
-  (settings->acft_type == AIRCRAFT_TYPE_POWERED ? "selected" : ""),  AIRCRAFT_TYPE_POWERED,
-  (settings->acft_type == AIRCRAFT_TYPE_HELICOPTER ? "selected" : ""),  AIRCRAFT_TYPE_HELICOPTER,
-  (settings->acft_type == AIRCRAFT_TYPE_UAV ? "selected" : ""),  AIRCRAFT_TYPE_UAV,
-  (settings->acft_type == AIRCRAFT_TYPE_HANGGLIDER ? "selected" : ""),  AIRCRAFT_TYPE_HANGGLIDER,
-  (settings->acft_type == AIRCRAFT_TYPE_PARAGLIDER ? "selected" : ""),  AIRCRAFT_TYPE_PARAGLIDER,
-  (settings->acft_type == AIRCRAFT_TYPE_BALLOON ? "selected" : ""),  AIRCRAFT_TYPE_BALLOON,
-  (settings->acft_type == AIRCRAFT_TYPE_STATIC ? "selected" : ""),  AIRCRAFT_TYPE_STATIC,
-  (settings->acft_type == AIRCRAFT_TYPE_WINCH ? "selected" : ""),  AIRCRAFT_TYPE_WINCH,
-  (settings->alarm == TRAFFIC_ALARM_NONE ? "selected" : ""),  TRAFFIC_ALARM_NONE,
-  (settings->alarm == TRAFFIC_ALARM_DISTANCE ? "selected" : ""),  TRAFFIC_ALARM_DISTANCE,
-  (settings->alarm == TRAFFIC_ALARM_VECTOR ? "selected" : ""),  TRAFFIC_ALARM_VECTOR,
-  (settings->alarm == TRAFFIC_ALARM_LATEST ? "selected" : ""),  TRAFFIC_ALARM_LATEST,
-  (settings->volume == BUZZER_OFF ? "selected" : ""), BUZZER_OFF,
-  (settings->volume == BUZZER_VOLUME_LOW ? "selected" : ""), BUZZER_VOLUME_LOW,
-  (settings->volume == BUZZER_VOLUME_FULL ? "selected" : ""), BUZZER_VOLUME_FULL,
-  (settings->volume == BUZZER_EXT ? "selected" : ""), BUZZER_EXT
-  );
-
-  len = strlen(offset);
-  offset += len;
-  size -= len;
-
-  yield();
+  static const web_option bands[] = {
+    { RF_BAND_EU, "EU (868.2 MHz)" },
+    { RF_BAND_RU, "RU (868.8 MHz)" },
+    { RF_BAND_CN, "CN (470 MHz)" },
+    { RF_BAND_US, "US/CA (915 MHz)" },
+    { RF_BAND_NZ, "NZ (869.25 MHz)" },
+    { RF_BAND_AU, "AU (921 MHz)" },
+    { RF_BAND_IN, "IN (866 MHz)" },
+    { RF_BAND_KR, "KR (920.9 MHz)" },
+    { RF_BAND_IL, "IL (916.2 MHz)" },
+    { RF_BAND_UK, "UK P3I (869.52)" }
+  };
+  chunk_select("Region", STG_BAND, bands, NUM_OPTIONS(bands));
+
+  static const web_option acft_types[] = {
+    { AIRCRAFT_TYPE_GLIDER,     "Glider" },
+    { AIRCRAFT_TYPE_TOWPLANE,   "Towplane" },
+    { AIRCRAFT_TYPE_POWERED,    "Powered" },
+    { AIRCRAFT_TYPE_HELICOPTER, "Helicopter" },
+    { AIRCRAFT_TYPE_UAV,        "UAV" },
+    { AIRCRAFT_TYPE_HANGGLIDER, "Hangglider" },
+    { AIRCRAFT_TYPE_PARAGLIDER, "Paraglider" },
+    { AIRCRAFT_TYPE_BALLOON,    "Balloon" },
+    { AIRCRAFT_TYPE_STATIC,     "Static" },
+    { AIRCRAFT_TYPE_WINCH,      "Winch" }
+  };
+  chunk_select("Aircraft type", STG_ACFT_TYPE, acft_types, NUM_OPTIONS(acft_types));
+
+  static const web_option alarms[] = {
+    { TRAFFIC_ALARM_NONE,     "None" },
+    { TRAFFIC_ALARM_DISTANCE, "Distance" },
+    { TRAFFIC_ALARM_VECTOR,   "Vector" },
+    { TRAFFIC_ALARM_LATEST,   "Latest" },
+    { TRAFFIC_ALARM_CPA,      "CPA" }
+  };
+  chunk_select("Alarm trigger", STG_ALARM, alarms, NUM_OPTIONS(alarms));
+
+  static const web_option volumes[] = {
+    { BUZZER_OFF,         "Off" },
+    { BUZZER_VOLUME_LOW,  "Soft" },
+    { BUZZER_VOLUME_FULL, "Loud" },
+    { BUZZER_EXT,         "External" }
+  };
+  chunk_select("Buzzer", STG_VOLUME, volumes, NUM_OPTIONS(volumes));
 
   /* SoC specific part 1 */
   if (SoC->id == SOC_ESP32) {
-    snprintf_P ( offset, size,
-      PSTR("\
-<tr>\
-<th align=left>Built-in Bluetooth</th>\
-<td align=right>\
-<select name='bluetooth'>\
-<option %s value='%d'>Off</option>\
-<option %s value='%d'>SPP</option>\
-<option %s value='%d'>LE</option>\
-</select>\
-</td>\
-</tr>"),
-    (settings->bluetooth == BLUETOOTH_OFF ? "selected" : ""), BLUETOOTH_OFF,
-    (settings->bluetooth == BLUETOOTH_SPP ? "selected" : ""), BLUETOOTH_SPP,
-    (settings->bluetooth == BLUETOOTH_LE_HM10_SERIAL ? "selected" : ""), BLUETOOTH_LE_HM10_SERIAL
-    );
-
-    len = strlen(offset);
-    offset += len;
-    size -= len;
+    static const web_option bt_types[] = {
+      { BLUETOOTH_OFF,            "Off" },
+      { BLUETOOTH_SPP,            "SPP" },
+      { BLUETOOTH_LE_HM10_SERIAL, "LE" }
+    };
+    chunk_select("Built-in Bluetooth", STG_BLUETOOTH, bt_types, NUM_OPTIONS(bt_types));
   }
 
-  yield();
-
-  /* Common part 3 */
-  snprintf_P ( offset, size,
-    PSTR("\
-<tr>\
-<th align=left>NMEA primary output</th>\
-<td align=right>\
-<select name='nmea_out'>\
-<option %s value='%d'>Off</option>\
-<option %s value='%d'>UDP</option>\
-<option %s value='%d'>Serial</option>"),
-  (settings->nmea_out == DEST_NONE  ? "selected" : ""), DEST_NONE,
-  (settings->nmea_out == DEST_UDP   ? "selected" : ""), DEST_UDP,
-  (settings->nmea_out == DEST_UART  ? "selected" : ""), DEST_UART);
-
-  len = strlen(offset);
-  offset += len;
-  size -= len;
-
-  /* SoC specific part 2 */
+  /* Common part 3 - NMEA output routes */
+  static const web_option dests[] = {
+    { DEST_NONE,      "Off" },
+    { DEST_UDP,       "UDP" },
+    { DEST_UART,      "Serial" },
+    { DEST_BLUETOOTH, "Bluetooth" },
+    { DEST_TCP,       "TCP" }
+  };
+  static const web_option dests_mk2[] = {
+    { DEST_NONE,      "Off" },
+    { DEST_UDP,       "UDP" },
+    { DEST_UART,      "Serial" },
+    { DEST_UART2,     "Serial 2" },
+    { DEST_BLUETOOTH, "Bluetooth" },
+    { DEST_TCP,       "TCP" }
+  };
+  const web_option *ndests = dests;
+  int num_dests = 3;      /* SoC specific part 2: the rest are ESP32 only */
   if (SoC->id == SOC_ESP32) {
     if (is_prime_mk2) {
-     snprintf_P ( offset, size,
-       PSTR("\
-<option %s value='%d'>Serial 2</option>\
-<option %s value='%d'>Bluetooth</option>\
-<option %s value='%d'>TCP</option>"),
-     (settings->nmea_out == DEST_UART2 ? "selected" : ""), DEST_UART2,
-     (settings->nmea_out == DEST_BLUETOOTH ? "selected" : ""), DEST_BLUETOOTH,
-     (settings->nmea_out == DEST_TCP       ? "selected" : ""), DEST_TCP);
+      ndests = dests_mk2;
+      num_dests = NUM_OPTIONS(dests_mk2);
     } else {
-     snprintf_P ( offset, size,
-       PSTR("\
-<option %s value='%d'>Bluetooth</option>\
-<option %s value='%d'>TCP</option>"),
-     (settings->nmea_out == DEST_BLUETOOTH ? "selected" : ""), DEST_BLUETOOTH,
-     (settings->nmea_out == DEST_TCP       ? "selected" : ""), DEST_TCP);
+      num_dests = NUM_OPTIONS(dests);
     }
-    len = strlen(offset);
-    offset += len;
-    size -= len;
   }
 
-    snprintf_P ( offset, size,
-      PSTR("\
+  const char *sentences = PSTR("\
 <tr>\
 <th align=left>&nbsp;&nbsp;&nbsp;&nbsp;Sentences:</th>\
-</tr>\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;GNSS</th>\
-<td align=right>\
-<input type='radio' name='nmea_g' value='0' %s>Off\
-<input type='radio' name='nmea_g' value='%d' %s>On\
-</td>\
-</tr>\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;Sensors</th>\
-<td align=right>\
-<input type='radio' name='nmea_s' value='0' %s>Off\
-<input type='radio' name='nmea_s' value='%d' %s>On\
-</td>\
-</tr>\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;Traffic</th>\
-<td align=right>\
-<input type='radio' name='nmea_t' value='0' %s>Off\
-<input type='radio' name='nmea_t' value='%d' %s>On\
-</td>\
-</tr>"),
-  (!settings->nmea_g ? "checked" : ""),
-   (settings->nmea_g ? settings->nmea_g : 1), (settings->nmea_g ? "checked" : ""),
-  (!settings->nmea_s ? "checked" : ""),
-   (settings->nmea_s ? settings->nmea_s : 1), (settings->nmea_s ? "checked" : ""),
-  (!settings->nmea_t ? "checked" : ""),
-   (settings->nmea_t ? settings->nmea_t : 1), (settings->nmea_t ? "checked" : ""));
-       // - if "on" is chosen keep the bitfield value if not zero, else set to 1 (basic sentences)
-
-    len = strlen(offset);
-    offset += len;
-    size -= len;
+</tr>");
+  const char *indent = "&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;";
+  char title[64];
+
+  chunk_select("NMEA primary output", STG_NMEA_OUT, ndests, num_dests);
+  chunk_printf(sentences);
+  snprintf(title, sizeof(title), "%sGNSS", indent);
+  chunk_onoff(title, STG_NMEA_G);
+  snprintf(title, sizeof(title), "%sSensors", indent);
+  chunk_onoff(title, STG_NMEA_S);
+  snprintf(title, sizeof(title), "%sTraffic", indent);
+  chunk_onoff(title, STG_NMEA_T);
 
   /* second NMEA output route */
-  snprintf_P ( offset, size,
-    PSTR("\
-<tr>\
-<th align=left>NMEA second output</th>\
-<td align=right>\
-<select name='nmea_out2'>\
-<option %s value='%d'>Off</option>\
-<option %s value='%d'>UDP</option>\
-<option %s value='%d'>Serial</option>"),
-  (settings->nmea_out2 == DEST_NONE  ? "selected" : ""), DEST_NONE,
-  (settings->nmea_out2 == DEST_UDP   ? "selected" : ""), DEST_UDP,
-  (settings->nmea_out2 == DEST_UART  ? "selected" : ""), DEST_UART);
-
-  len = strlen(offset);
-  offset += len;
-  size -= len;
-
-
-  if (SoC->id == SOC_ESP32) {
-    if (is_prime_mk2) {
-     snprintf_P ( offset, size,
-       PSTR("\
-<option %s value='%d'>Serial 2</option>\
-<option %s value='%d'>Bluetooth</option>\
-<option %s value='%d'>TCP</option>"),
-     (settings->nmea_out2 == DEST_UART2 ? "selected" : ""), DEST_UART2,
-     (settings->nmea_out2 == DEST_BLUETOOTH ? "selected" : ""), DEST_BLUETOOTH,
-     (settings->nmea_out2 == DEST_TCP       ? "selected" : ""), DEST_TCP);
-    } else {
-     snprintf_P ( offset, size,
-       PSTR("\
-<option %s value='%d'>Bluetooth</option>\
-<option %s value='%d'>TCP</option>"),
-     (settings->nmea_out2 == DEST_BLUETOOTH ? "selected" : ""), DEST_BLUETOOTH,
-     (settings->nmea_out2 == DEST_TCP       ? "selected" : ""), DEST_TCP);
-    }
-    len = strlen(offset);
-    offset += len;
-    size -= len;
-  }
-
-// Serial.println(F("Settings page part 4 done"));
-
-    snprintf_P ( offset, size,
-      PSTR("\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;Sentences:</th>\
-</tr>\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;GNSS</th>\
-<td align=right>\
-<input type='radio' name='nmea2_g' value='0' %s>Off\
-<input type='radio' name='nmea2_g' value='%d' %s>On\
-</td>\
-</tr>\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;Sensors</th>\
-<td align=right>\
-<input type='radio' name='nmea2_s' value='0' %s>Off\
-<input type='radio' name='nmea2_s' value='%d' %s>On\
-</td>\
-</tr>\
-<tr>\
-<th align=left>&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;&nbsp;Traffic</th>\
-<td align=right>\
-<input type='radio' name='nmea2_t' value='0' %s>Off\
-<input type='radio' name='nmea2_t' value='%d' %s>On\
-</td>\
-</tr>\
-<tr>\
-<th align=left>Serial Output Baud Rate:</th>\
-<td align=right>\
-<select name='baud_rate'>\
-<option %s value='%d'>Default</option>\
-<option %s value='%d'>4800</option>\
-<option %s value='%d'>9600</option>\
-<option %s value='%d'>19200</option>\
-<option %s value='%d'>38400</option>\
-<option %s value='%d'>57600</option>\
-<option %s value='%d'>115200</option>\
-</select>\
-</td>\
-</tr>"),
-  (!settings->nmea2_g ? "checked" : ""),
-   (settings->nmea2_g ? settings->nmea2_g : 1), (settings->nmea2_g ? "checked" : ""),
-  (!settings->nmea2_s ? "checked" : ""),
-   (settings->nmea2_s ? settings->nmea2_s : 1), (settings->nmea2_s ? "checked" : ""),
-  (!settings->nmea2_t ? "checked" : ""),
-   (settings->nmea2_t ? settings->nmea2_t : 1), (settings->nmea2_t ? "checked" : ""),
-  (settings->baud_rate == BAUD_DEFAULT ? "selected" : ""), BAUD_DEFAULT,
-  (settings->baud_rate == BAUD_4800    ? "selected" : ""), BAUD_4800,
-  (settings->baud_rate == BAUD_9600    ? "selected" : ""), BAUD_9600,
-  (settings->baud_rate == BAUD_19200   ? "selected" : ""), BAUD_19200,
-  (settings->baud_rate == BAUD_38400   ? "selected" : ""), BAUD_38400,
-  (settings->baud_rate == BAUD_57600   ? "selected" : ""), BAUD_57600,
-  (settings->baud_rate == BAUD_115200  ? "selected" : ""), BAUD_115200);
-
-    len = strlen(offset);
-    offset += len;
-    size -= len;
-
-  yield();
+  chunk_select("NMEA second output", STG_NMEA_OUT2, ndests, num_dests);
+  chunk_printf(sentences);
+  snprintf(title, sizeof(title), "%sGNSS", indent);
+  chunk_onoff(title, STG_NMEA2_G);
+  snprintf(title, sizeof(title), "%sSensors", indent);
+  chunk_onoff(title, STG_NMEA2_S);
+  snprintf(title, sizeof(title), "%sTraffic", indent);
+  chunk_onoff(title, STG_NMEA2_T);
+
+  static const web_option bauds[] = {
+    { BAUD_DEFAULT, "Default" },
+    { BAUD_4800,    "4800" },
+    { BAUD_9600,    "9600" },
+    { BAUD_19200,   "19200" },
+    { BAUD_38400,   "38400" },
+    { BAUD_57600,   "57600" },
+    { BAUD_115200,  "115200" }
+  };
+  chunk_select("Serial Output Baud Rate:", STG_BAUD_RATE, bauds, NUM_OPTIONS(bauds));
 
   /* Common part 6 */
-  snprintf_P ( offset, size,
+  chunk_onoff("Stealth", STG_STEALTH);
+  chunk_onoff("No track", STG_NO_TRACK);
+
+  static const web_option logflights[] = {
+    { FLIGHT_LOG_NONE,     "Off" },
+    { FLIGHT_LOG_ALWAYS,   "Always" },
+    { FLIGHT_LOG_AIRBORNE, "Airborne" },
+    { FLIGHT_LOG_TRAFFIC,  "Traffic" }
+  };
+  chunk_select("Flight logging:", STG_LOGFLIGHT, logflights, NUM_OPTIONS(logflights));
+
+  chunk_printf(
     PSTR("\
 <tr>\
-<th align=left>Stealth</th>\
-<td align=right>\
-<input type='radio' name='stealth' value='0' %s>Off\
-<input type='radio' name='stealth' value='1' %s>On\
-</td>\
-</tr>\
-<tr>\
-<th align=left>No track</th>\
-<td align=right>\
-<input type='radio' name='no_track' value='0' %s>Off\
-<input type='radio' name='no_track' value='1' %s>On\
-</td>\
-</tr>"),
-  (!settings->stealth  ? "checked" : "") , (settings->stealth  ? "checked" : ""),
-  (!settings->no_track ? "checked" : "") , (settings->no_track ? "checked" : "")
-  );
-
-  len = strlen(offset);
-  offset += len;
-  size -= len;
-
-    snprintf_P ( offset, size,
-      PSTR("\
-<tr>\
-<th align=left>Flight logging:</th>\
-<td align=right>\
-<select name='logflight'>\
-<option %s value='%d'>Off</option>\
-<option %s value='%d'>Always</option>\
-<option %s value='%d'>Airborne</option>\
-<option %s value='%d'>Traffic</option>\
-</td>\
-</tr>\
-<tr>\
 <th align=left>Flight log interval (sec):</th>\
 <td align=right>\
 <INPUT type='number' name='loginterval' min='1' max='255' size='4' value='%d'>\
 </td>\
 </tr>"),
-  (settings->logflight==FLIGHT_LOG_NONE     ? "selected" : ""), FLIGHT_LOG_NONE,
-  (settings->logflight==FLIGHT_LOG_ALWAYS   ? "selected" : ""), FLIGHT_LOG_ALWAYS,
-  (settings->logflight==FLIGHT_LOG_AIRBORNE ? "selected" : ""), FLIGHT_LOG_AIRBORNE,
-  (settings->logflight==FLIGHT_LOG_TRAFFIC  ? "selected" : ""), FLIGHT_LOG_TRAFFIC,
    settings->loginterval);
 
-    len = strlen(offset);
-    offset += len;
-    size -= len;
-
-  yield();
-
   /* Common part 7 */
-  snprintf_P ( offset, size,
+  chunk_printf(
     PSTR("\
 </table>\
 <p align=center><INPUT type='submit' value='Save and restart'></p>\
@@ -1093,44 +1000,16 @@ void handleSettings() {
 </html>")
   );
 
-  len = strlen(offset);
-  offset += len;
-  Serial.print(F("Settings page size: ")); Serial.print(offset-Settings_temp);
-  Serial.print(F(" out of allocated: ")); Serial.println(totalsize);
-  // currently about 3700
-  serve_html(Settings_temp);
-  Serial.print(F("Free memory (settings page staging): "));
-  Serial.println(ESP.getFreeHeap());
-  delay(1000);
-  free(Settings_temp);
+  chunk_end();
 }
 
 void handleAdvStgs() {
 
   Serial.println(F("handleAdvStgs()..."));
 
-  stop_bluetooth((size_t)60000);
-
-//  bool is_prime_mk2 = false;
-//  if (hw_info.model == SOFTRF_MODEL_PRIME_MK2 /* && hw_info.revision >= 5 */)
-//    is_prime_mk2 = true;
-
-  size_t size = 15000;
-  size_t totalsize = size;
-  char *offset;
-  size_t len = 0;
-  char *Settings_temp = (char *) malloc(size);
-
-  if (Settings_temp == NULL) {
-    Serial.println(F(">>> not enough RAM"));
-    return;
-  }
-
-  Serial.println(F("Constructing advanced settings page..."));
-
-  offset = Settings_temp;
+  chunk_begin();
 
-  snprintf_P ( offset, size,
+  chunk_printf(
     PSTR("<html>\
 <head>\
 <meta name='viewport' content='width=device-width, initial-scale=1'>\
@@ -1148,9 +1027,6 @@ void handleAdvStgs() {
 </table>\
 <form action='/input' method='GET'>\
 <table border=1 frame=hsides rules=rows width=100%%>"), page_message());
-  len = strlen(offset);
-  offset += len;
-  size -= len;
 
   for (int i=STG_MODE; i<STG_END; i++) {
       char buf[64];
@@ -1165,13 +1041,15 @@ void handleAdvStgs() {
       const char *v = &buf[comma+1];
       if (buf[comma] != ',')  // should not happen
           v = "";
+      else
+          buf[strcspn(buf, "\r\n")] = '\0';
       if (i == STG_PSK && settings->psk[0] != '\0')
           v = "********";
       const char *z = stgcomment[i];
       if (! z)
           z = "";
 
-      snprintf_P ( offset, size, PSTR("\
+      chunk_printf(PSTR("\
 <tr>\
 <th align=left>&nbsp;&nbsp;%s</th>\
 <td align=center><INPUT type='text' name='%s' maxlength='32' value='%s' size='16'></td>\
@@ -1179,15 +1057,11 @@ void handleAdvStgs() {
 </tr>"),
            w, w, v, z);
            // the setting's label used both as text and the name of the INPUT
-      len = strlen(offset);
-      offset += len;
-      size -= len;
-      yield();
   }
 
 #if defined(USE_OGN_ENCRYPTION)
   if (settings->rf_protocol == RF_PROTOCOL_OGNTP) {
-    snprintf_P ( offset, size,
+    chunk_printf(
       PSTR("\
 <tr>\
 <th align=left>IGC key (HEX)</th>\
@@ -1200,14 +1074,10 @@ void handleAdvStgs() {
     settings->igc_key[2]? 0x88888888 : 0,
     settings->igc_key[3]? 0x88888888 : 0);
        /* mask the key from prying eyes */
-
-    len = strlen(offset);
-    offset += len;
-    size -= len;
   }
 #endif
 
-  snprintf_P ( offset, size,
+  chunk_printf(
     PSTR("\
 </table>\
 <p align=center><INPUT type='submit' value='Save and restart'></p>\
@@ -1215,17 +1085,57 @@ void handleAdvStgs() {
 </body>\
 </html>")
   );
-  len = strlen(offset);
-  offset += len;
-
-  Serial.print(F("AdvStgs page size: ")); Serial.print(offset-Settings_temp);
-  Serial.print(F(" out of allocated: ")); Serial.println(totalsize);
-  // currently about ------
-  serve_html(Settings_temp);
-  Serial.print(F("Free memory (AdvStgs page staging): "));
-  Serial.println(ESP.getFreeHeap());
-  delay(1000);
-  free(Settings_temp);
+
+  chunk_end();
+}
+
+void handleProfile() {
+
+  Serial.println(F("handleProfile()..."));
+
+  chunk_begin();
+
+  chunk_printf(
+    PSTR("<html>\
+<head>\
+<meta name='viewport' content='width=device-width, initial-scale=1'>\
+<title>Loop profile</title>\
+</head>\
+<body>\
+<table width=100%%>\
+<tr>\
+<td align=center><input type=button onClick=\"location.href='/'\" value='Home'></td>\
+<td align=center><h2>Loop profile</h2></td>\
+<td align=center><input type=button onClick=\"location.href='/profile'\" value='Refresh'></td>\
+</tr>\
+<tr><td>&nbsp;</td><th align=center>last %u seconds, times in us</th><td>&nbsp;</td></tr>\
+</table>\
+<table border=1 frame=hsides rules=rows width=100%%>\
+<tr><th align=left>Stage</th><th>Count</th><th>Min</th><th>Avg</th><th>Max</th><th>p99</th><th>Late</th></tr>"),
+    (unsigned) (Prof_Last_Window / 1000));
+
+  for (int i=0; i<PROF_COUNT; i++) {
+      prof_summary_t *ps = &Prof_Last[i];
+      if (ps->count == 0)
+          continue;
+      chunk_printf(PSTR("\
+<tr><th align=left>%s</th>\
+<td align=right>%lu</td><td align=right>%lu</td><td align=right>%lu</td>\
+<td align=right>%lu</td><td align=right>%lu</td><td align=right>%lu</td></tr>"),
+          Prof_Name[i], (unsigned long) ps->count,
+          (unsigned long) ps->min_us, (unsigned long) ps->avg_us,
+          (unsigned long) ps->max_us, (unsigned long) ps->p99_us,
+          (unsigned long) ps->late);
+  }
+
+  chunk_printf(
+    PSTR("\
+</table>\
+</body>\
+</html>")
+  );
+
+  chunk_end();
 }
 
 void handleRoot() {
@@ -1257,7 +1167,7 @@ void handleRoot() {
   char str_vbat[8];
   char str_vusb[8];
 
-  size_t size = 4900;
+  size_t size = 5250;
   char *Root_temp = (char *) malloc(size);
   if (Root_temp == NULL) {
       Serial.println(F(">>> not enough RAM"));
@@ -1270,17 +1180,34 @@ void handleRoot() {
   dtostrf(vbat, 4, 2, str_vbat);
   dtostrf(vusb, 4, 2, str_vusb);
 
-  char adsb_s[88];
+  char adsb_s[176];
   if (settings->rx1090 == ADSB_RX_NONE && settings->gdl90_in == DEST_NONE) {
       adsb_s[0] = '\0';
   } else if (settings->rx1090 != ADSB_RX_NONE && ! rx1090found) {
       strcpy(adsb_s, "<tr><th align=left>ADS-B receiver not present</th></tr>");
+  } else if (adsb_dropped_counter != 0) {
+      snprintf(adsb_s, 176,
+         "<tr><th align=left>ADS-B Packets</th><td>&nbsp;</td><td align=right>%d</td></tr>"
+         "<tr><th align=left>ADS-B Dropped</th><td>&nbsp;</td><td align=right>%d</td></tr>",
+         adsb_packets_counter, adsb_dropped_counter);
   } else {
-      snprintf(adsb_s, 88,
+      snprintf(adsb_s, 176,
          "<tr><th align=left>ADS-B Packets</th><td>&nbsp;</td><td align=right>%d</td></tr>",
          adsb_packets_counter);
   }
 
+  char ble_s[224];    /* 175 chars of markup, up to 45 digits */
+  ble_s[0] = '\0';
+#if defined(BLE_FIFO_TX_SIZE)
+  if (BTactive && settings->bluetooth == BLUETOOTH_LE_HM10_SERIAL) {
+      snprintf(ble_s, sizeof(ble_s),
+         "<tr><th align=left>BLE MTU %d</th><td align=middle>Sent %u</td><td align=right>Dropped %u</td></tr>"
+         "<tr><th align=left>BLE Latency</th><td>&nbsp;</td><td align=right>%d / %d ms</td></tr>",
+         BLE_TX_stats.mtu, (unsigned) BLE_TX_stats.sent, (unsigned) BLE_TX_stats.dropped,
+         BLE_TX_stats.latency_avg, BLE_TX_stats.latency_max);
+  }
+#endif
+
   char tx_s[8];
   if (settings->txpower == RF_TX_POWER_OFF) {
       strcpy(tx_s, "OFF");
@@ -1344,7 +1271,7 @@ void handleRoot() {
    <td align=middle>Tx %s</td>\
    <td align=right>Rx %u</td>\
   </tr>\
-  %s\
+  %s%s\
   <tr>\
    <th align=left>Current traffic</th>\
    <td align=left>%d</td>\
@@ -1355,7 +1282,7 @@ void handleRoot() {
    <td align=left>\
     <input type=button onClick=\"location.href='/landed_out'\" value='%s'>\
    </td>\
-   <td>&nbsp;</td>\
+   <td align=right><input type=button onClick=\"location.href='/profile'\" value='Loop profile'></td>\
   </tr>\
  </table>\
  <hr>\
@@ -1411,7 +1338,7 @@ void handleRoot() {
 #endif /* ENABLE_AHRS */
     hr, min % 60, sec % 60, ESP.getFreeHeap(),
     (low_voltage==1? "red" : (low_voltage==0? "green": "black")), str_vbat, str_vusb,
-    tx_s, rx_packets_counter, adsb_s, acrfts_counter, traffics,
+    tx_s, rx_packets_counter, adsb_s, ble_s, acrfts_counter, traffics,
     (landed_out_mode? "Active" : "Off"),
     (landed_out_mode? "Stop" : "Activate"),
     ((hw_info.model == SOFTRF_MODEL_PRIME_MK2) ?
@@ -1760,27 +1687,11 @@ bool handleFileRead(String path) {
     char lastchar = zpath[12];
     zpath[12]='Z';
     if (SPIFFS.exists(zpath) && lastchar == 'C') {
-      // IGC requested but IGZ exists - first decompress then download
-      size_t size = 0;
-      File file = SPIFFS.open(zpath);       
-      if (file)  size = file.size();
-      file.close();
-      if (size == 0)  return false;
-      if (6*size > PSRAMavailable()) {
-          server.send(500, textplain,
-              "Not enough RAM space, save & clear current flight log first");
-          return true;  // avoid the handleNotFound() message
-      }
-      suspendFlightLog();           // close SPIFFS file, pause PSRAM logging
-      if (decompressfile(zpath)) {
-          PSRAMbuf[PSRAMbufUsed] = '\0';
-          serve_file(file, filename, PSRAMbuf);    // 'file' is a dummy argument
-      } else {
+      // IGC requested but IGZ exists - decompress on the fly while downloading
+      if (! serve_igz(zpath, filename)) {
           Serial.println("decompression failed");
           server.send(500, textplain, "decompression failed");
       }
-      delay(2000);
-      resumeFlightLog();
       return true;
     }
   }
@@ -2263,6 +2174,7 @@ void Web_setup()
 
   server.on ( "/settings", handleSettings );
   server.on ( "/advstgs",  handleAdvStgs );
+  server.on ( "/profile",  handleProfile );
 
   server.on ( "/reboot", []() {
     Serial.println(F("Rebooting from web page..."));
@@ -2319,8 +2231,10 @@ void Web_setup()
   server.on ( "/format", confirmFormat );
   server.on ( "/doformat", []() {
     closeFlightLog();
+    Voice_flush();
     clear_waves();
     Serial.println(F("Formatting spiffs..."));
+    NMEA_Flush();
     SPIFFS.format();
     server.send(200, textplain, "SPIFFS cleared, suggest saving settings now!");
   } );
@@ -2541,6 +2455,8 @@ void Web_setup()
 void Web_loop()
 {
   server.handleClient();
+  if (igz_sending)
+    igz_send_more();
   if (reboot_pending) {
     close_logs();
     delay(2000);
@@ -2550,6 +2466,8 @@ void Web_loop()
 
 void Web_fini()
 {
+  if (igz_sending)
+    igz_done();
   server.stop();
 }
 
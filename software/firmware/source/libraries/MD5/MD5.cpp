@@ -21,8 +21,11 @@ MD5::MD5()
 
 char* MD5::make_digest(MD5_CTX *ctxBuf)
 {
-	unsigned char *hash = ctxBuf->hash;
-	char * md5str = ctxBuf->digest;
+	return make_digest(ctxBuf->hash, ctxBuf->digest);
+}
+
+char* MD5::make_digest(const unsigned char *hash, char *md5str)
+{
 	static const char hexits[17] = "0123456789abcdef";
 	int i;
 
@@ -313,6 +316,283 @@ void MD5::MD5Final(MD5_CTX *ctxBuf)
 	memset(ctx->buffer, 0, sizeof(ctx->buffer));
 }
 
+/*
+ * The 4-lane variant.  Each message word is loaded once and used
+ * by all four lanes.  Where the compiler has 128-bit vectors
+ * the lanes are one vector, otherwise the steps are interleaved
+ * lane by lane, which still shares the loads and the loop overhead.
+ */
+#if defined(__GNUC__) && (defined(__ARM_NEON) || defined(__SSE2__))
+#define MD5X4_VECTOR
+typedef uint32_t md5x4_v __attribute__((vector_size(16)));
+#endif
+
+#if defined(MD5X4_VECTOR)
+#define STEP4(f, a, b, c, d, x, t, s) \
+	(a) += f((b), (c), (d)) + (x) + (uint32_t) (t); \
+	(a) = ((a) << (s)) | ((a) >> (32 - (s))); \
+	(a) += (b);
+#else
+#define STEP4(f, a, b, c, d, x, t, s) \
+	for (int l = 0; l < 4; l++) { \
+		(a)[l] += f((b)[l], (c)[l], (d)[l]) + (x) + (uint32_t) (t); \
+		(a)[l] = ((a)[l] << (s)) | ((a)[l] >> (32 - (s))); \
+		(a)[l] += (b)[l]; \
+	}
+#endif
+
+static void MD5x4_body(MD5x4_CTX *ctx, const unsigned char *ptr, size_t blocks)
+{
+	uint32_t X[16];
+#if defined(MD5X4_VECTOR)
+	md5x4_v a, b, c, d;
+	md5x4_v saved_a, saved_b, saved_c, saved_d;
+
+	memcpy(&a, ctx->a, sizeof(a));
+	memcpy(&b, ctx->b, sizeof(b));
+	memcpy(&c, ctx->c, sizeof(c));
+	memcpy(&d, ctx->d, sizeof(d));
+#else
+	uint32_t a[4], b[4], c[4], d[4];
+	uint32_t saved_a[4], saved_b[4], saved_c[4], saved_d[4];
+
+	memcpy(a, ctx->a, sizeof(a));
+	memcpy(b, ctx->b, sizeof(b));
+	memcpy(c, ctx->c, sizeof(c));
+	memcpy(d, ctx->d, sizeof(d));
+#endif
+
+	while (blocks--) {
+		for (int n = 0; n < 16; n++) {
+			X[n] = (uint32_t)ptr[n * 4] |
+			    ((uint32_t)ptr[n * 4 + 1] << 8) |
+			    ((uint32_t)ptr[n * 4 + 2] << 16) |
+			    ((uint32_t)ptr[n * 4 + 3] << 24);
+		}
+
+#if defined(MD5X4_VECTOR)
+		saved_a = a;
+		saved_b = b;
+		saved_c = c;
+		saved_d = d;
+#else
+		memcpy(saved_a, a, sizeof(a));
+		memcpy(saved_b, b, sizeof(b));
+		memcpy(saved_c, c, sizeof(c));
+		memcpy(saved_d, d, sizeof(d));
+#endif
+
+/* Round 1 */
+		STEP4(E, a, b, c, d, X[0], 0xd76aa478, 7)
+		STEP4(E, d, a, b, c, X[1], 0xe8c7b756, 12)
+		STEP4(E, c, d, a, b, X[2], 0x242070db, 17)
+		STEP4(E, b, c, d, a, X[3], 0xc1bdceee, 22)
+		STEP4(E, a, b, c, d, X[4], 0xf57c0faf, 7)
+		STEP4(E, d, a, b, c, X[5], 0x4787c62a, 12)
+		STEP4(E, c, d, a, b, X[6], 0xa8304613, 17)
+		STEP4(E, b, c, d, a, X[7], 0xfd469501, 22)
+		STEP4(E, a, b, c, d, X[8], 0x698098d8, 7)
+		STEP4(E, d, a, b, c, X[9], 0x8b44f7af, 12)
+		STEP4(E, c, d, a, b, X[10], 0xffff5bb1, 17)
+		STEP4(E, b, c, d, a, X[11], 0x895cd7be, 22)
+		STEP4(E, a, b, c, d, X[12], 0x6b901122, 7)
+		STEP4(E, d, a, b, c, X[13], 0xfd987193, 12)
+		STEP4(E, c, d, a, b, X[14], 0xa679438e, 17)
+		STEP4(E, b, c, d, a, X[15], 0x49b40821, 22)
+
+/* Round 2 */
+		STEP4(G, a, b, c, d, X[1], 0xf61e2562, 5)
+		STEP4(G, d, a, b, c, X[6], 0xc040b340, 9)
+		STEP4(G, c, d, a, b, X[11], 0x265e5a51, 14)
+		STEP4(G, b, c, d, a, X[0], 0xe9b6c7aa, 20)
+		STEP4(G, a, b, c, d, X[5], 0xd62f105d, 5)
+		STEP4(G, d, a, b, c, X[10], 0x02441453, 9)
+		STEP4(G, c, d, a, b, X[15], 0xd8a1e681, 14)
+		STEP4(G, b, c, d, a, X[4], 0xe7d3fbc8, 20)
+		STEP4(G, a, b, c, d, X[9], 0x21e1cde6, 5)
+		STEP4(G, d, a, b, c, X[14], 0xc33707d6, 9)
+		STEP4(G, c, d, a, b, X[3], 0xf4d50d87, 14)
+		STEP4(G, b, c, d, a, X[8], 0x455a14ed, 20)
+		STEP4(G, a, b, c, d, X[13], 0xa9e3e905, 5)
+		STEP4(G, d, a, b, c, X[2], 0xfcefa3f8, 9)
+		STEP4(G, c, d, a, b, X[7], 0x676f02d9, 14)
+		STEP4(G, b, c, d, a, X[12], 0x8d2a4c8a, 20)
+
+/* Round 3 */
+		STEP4(H, a, b, c, d, X[5], 0xfffa3942, 4)
+		STEP4(H, d, a, b, c, X[8], 0x8771f681, 11)
+		STEP4(H, c, d, a, b, X[11], 0x6d9d6122, 16)
+		STEP4(H, b, c, d, a, X[14], 0xfde5380c, 23)
+		STEP4(H, a, b, c, d, X[1], 0xa4beea44, 4)
+		STEP4(H, d, a, b, c, X[4], 0x4bdecfa9, 11)
+		STEP4(H, c, d, a, b, X[7], 0xf6bb4b60, 16)
+		STEP4(H, b, c, d, a, X[10], 0xbebfbc70, 23)
+		STEP4(H, a, b, c, d, X[13], 0x289b7ec6, 4)
+		STEP4(H, d, a, b, c, X[0], 0xeaa127fa, 11)
+		STEP4(H, c, d, a, b, X[3], 0xd4ef3085, 16)
+		STEP4(H, b, c, d, a, X[6], 0x04881d05, 23)
+		STEP4(H, a, b, c, d, X[9], 0xd9d4d039, 4)
+		STEP4(H, d, a, b, c, X[12], 0xe6db99e5, 11)
+		STEP4(H, c, d, a, b, X[15], 0x1fa27cf8, 16)
+		STEP4(H, b, c, d, a, X[2], 0xc4ac5665, 23)
+
+/* Round 4 */
+		STEP4(I, a, b, c, d, X[0], 0xf4292244, 6)
+		STEP4(I, d, a, b, c, X[7], 0x432aff97, 10)
+		STEP4(I, c, d, a, b, X[14], 0xab9423a7, 15)
+		STEP4(I, b, c, d, a, X[5], 0xfc93a039, 21)
+		STEP4(I, a, b, c, d, X[12], 0x655b59c3, 6)
+		STEP4(I, d, a, b, c, X[3], 0x8f0ccc92, 10)
+		STEP4(I, c, d, a, b, X[10], 0xffeff47d, 15)
+		STEP4(I, b, c, d, a, X[1], 0x85845dd1, 21)
+		STEP4(I, a, b, c, d, X[8], 0x6fa87e4f, 6)
+		STEP4(I, d, a, b, c, X[15], 0xfe2ce6e0, 10)
+		STEP4(I, c, d, a, b, X[6], 0xa3014314, 15)
+		STEP4(I, b, c, d, a, X[13], 0x4e0811a1, 21)
+		STEP4(I, a, b, c, d, X[4], 0xf7537e82, 6)
+		STEP4(I, d, a, b, c, X[11], 0xbd3af235, 10)
+		STEP4(I, c, d, a, b, X[2], 0x2ad7d2bb, 15)
+		STEP4(I, b, c, d, a, X[9], 0xeb86d391, 21)
+
+#if defined(MD5X4_VECTOR)
+		a += saved_a;
+		b += saved_b;
+		c += saved_c;
+		d += saved_d;
+#else
+		for (int l = 0; l < 4; l++) {
+			a[l] += saved_a[l];
+			b[l] += saved_b[l];
+			c[l] += saved_c[l];
+			d[l] += saved_d[l];
+		}
+#endif
+
+		ptr += 64;
+	}
+
+#if defined(MD5X4_VECTOR)
+	memcpy(ctx->a, &a, sizeof(a));
+	memcpy(ctx->b, &b, sizeof(b));
+	memcpy(ctx->c, &c, sizeof(c));
+	memcpy(ctx->d, &d, sizeof(d));
+#else
+	memcpy(ctx->a, a, sizeof(a));
+	memcpy(ctx->b, b, sizeof(b));
+	memcpy(ctx->c, c, sizeof(c));
+	memcpy(ctx->d, d, sizeof(d));
+#endif
+}
+
+/* keys[lane] = { a, b, c, d } initial state of that lane */
+void MD5::MD5x4Initialize(MD5x4_CTX *ctxBuf, const uint32_t keys[4][4])
+{
+	MD5x4_CTX *ctx = ctxBuf;
+
+	for (int l = 0; l < 4; l++) {
+		ctx->a[l] = keys[l][0];
+		ctx->b[l] = keys[l][1];
+		ctx->c[l] = keys[l][2];
+		ctx->d[l] = keys[l][3];
+	}
+	ctx->lo = 0;
+	ctx->hi = 0;
+	memset(ctx->buffer, 0, sizeof(ctx->buffer));
+}
+
+void MD5::MD5x4Update(MD5x4_CTX *ctxBuf, const void *data, size_t size)
+{
+	MD5x4_CTX *ctx = ctxBuf;
+	const unsigned char *ptr = (const unsigned char *) data;
+	uint32_t saved_lo;
+	uint32_t used, free;
+
+	saved_lo = ctx->lo;
+	if ((ctx->lo = (saved_lo + size) & 0x1fffffff) < saved_lo) {
+		ctx->hi++;
+	}
+	ctx->hi += (uint32_t) (size >> 29);
+
+	used = saved_lo & 0x3f;
+
+	if (used) {
+		free = 64 - used;
+
+		if (size < free) {
+			memcpy(&ctx->buffer[used], ptr, size);
+			return;
+		}
+
+		memcpy(&ctx->buffer[used], ptr, free);
+		ptr += free;
+		size -= free;
+		MD5x4_body(ctx, ctx->buffer, 1);
+	}
+
+	if (size >= 64) {
+		MD5x4_body(ctx, ptr, size >> 6);
+		ptr += size & ~(size_t)0x3f;
+		size &= 0x3f;
+	}
+
+	memcpy(ctx->buffer, ptr, size);
+}
+
+/*
+ * Finalizes a snapshot: the context itself is left as it was,
+ * so more data can be added afterwards.
+ */
+void MD5::MD5x4Final(const MD5x4_CTX *ctxBuf, unsigned char hash[4][16])
+{
+	MD5x4_CTX snap;
+	MD5x4_CTX *ctx = &snap;
+	uint32_t used, free;
+
+	memcpy(ctx->a, ctxBuf->a, sizeof(ctx->a));
+	memcpy(ctx->b, ctxBuf->b, sizeof(ctx->b));
+	memcpy(ctx->c, ctxBuf->c, sizeof(ctx->c));
+	memcpy(ctx->d, ctxBuf->d, sizeof(ctx->d));
+
+	used = ctxBuf->lo & 0x3f;
+	memcpy(ctx->buffer, ctxBuf->buffer, used);
+
+	ctx->buffer[used++] = 0x80;
+
+	free = 64 - used;
+
+	if (free < 8) {
+		memset(&ctx->buffer[used], 0, free);
+		MD5x4_body(ctx, ctx->buffer, 1);
+		used = 0;
+		free = 64;
+	}
+
+	memset(&ctx->buffer[used], 0, free - 8);
+
+	uint32_t lo = ctxBuf->lo << 3;
+	uint32_t hi = ctxBuf->hi;
+	ctx->buffer[56] = lo;
+	ctx->buffer[57] = lo >> 8;
+	ctx->buffer[58] = lo >> 16;
+	ctx->buffer[59] = lo >> 24;
+	ctx->buffer[60] = hi;
+	ctx->buffer[61] = hi >> 8;
+	ctx->buffer[62] = hi >> 16;
+	ctx->buffer[63] = hi >> 24;
+
+	MD5x4_body(ctx, ctx->buffer, 1);
+
+	for (int l = 0; l < 4; l++) {
+		uint32_t w[4] = { ctx->a[l], ctx->b[l], ctx->c[l], ctx->d[l] };
+		for (int i = 0; i < 4; i++) {
+			hash[l][i * 4]     = w[i];
+			hash[l][i * 4 + 1] = w[i] >> 8;
+			hash[l][i * 4 + 2] = w[i] >> 16;
+			hash[l][i * 4 + 3] = w[i] >> 24;
+		}
+	}
+}
+
 unsigned char* MD5::make_hash(MD5_CTX *ctxBuf, const char *arg)
 {
 	MD5Init(ctxBuf);
@@ -41,6 +41,18 @@
 		char digest[33];
 	} MD5_CTX;
 
+	/*
+	 * Four MD5 contexts that differ only in their initial state
+	 * and are always fed the same data, e.g. the four key sets of
+	 * an IGC security record.  The byte count and the partial block
+	 * are shared, the chaining values are kept per lane.
+	 */
+	typedef struct {
+		uint32_t lo, hi;
+		uint32_t a[4], b[4], c[4], d[4];
+		unsigned char buffer[64];
+	} MD5x4_CTX;
+
 	class MD5
 	{
 	public:
@@ -54,6 +66,10 @@
 		    const MD5_u32plus a, const MD5_u32plus b, const MD5_u32plus c, const MD5_u32plus d);
 		static void MD5Update(MD5_CTX *ctxBuf, const void *data, size_t size);
 		static void MD5Final(MD5_CTX *ctxBuf);
+		static char* make_digest(const unsigned char *hash, char *md5str);
+		static void MD5x4Initialize(MD5x4_CTX *ctxBuf, const uint32_t keys[4][4]);
+		static void MD5x4Update(MD5x4_CTX *ctxBuf, const void *data, size_t size);
+		static void MD5x4Final(const MD5x4_CTX *ctxBuf, unsigned char hash[4][16]);
 	};
 //}
 
@@ -0,0 +1,205 @@
+// ldpc_bench - decode success rate of the OGN (208,160) LDPC code against SNR,
+// on synthetic Manchester coded packets with white gaussian noise.
+//
+// Build on a host, from this directory:
+//
+//   g++ -O2 -I.. -o ldpc_bench ldpc_bench.cpp ../ldpc.cpp
+//
+// Every packet is random data with its parity, Manchester coded into 416 chips
+// of +/-1 and received with noise of the given Es/N0 per chip.  The receiver
+// slices the chips like the radio does and gets the data bits plus the Manchester
+// error pattern (both chips equal), which is what the decoders work on:
+//
+//   check    - LDPC_Check() only, as the receive path did before
+//   float    - LDPC_Decoder, 16-bit flooding decoder from rfm.h, 32 iterations
+//   hard     - LDPC_MinSumDecoder on the data alone, as from a radio which
+//              decodes Manchester itself (SX1276), without acceptance limits
+//   minsum   - LDPC_MinSumDecoder on the data and the Manchester errors, the same
+//   soft     - LDPC_MinSumDecoder on 8-bit soft chip differences, for reference
+//   rx hard  - the receive path as it ships for hard decisions: LDPC_Check(),
+//              else LDPC_MinSumDecoder::Repair() with its acceptance limits
+//   rx       - the same with the Manchester errors
+//
+// "bad" counts packets which passed all checks but decoded into something else
+// than what was sent, for the rx columns these are the false accepts.  For
+// minsum the number of iterations needed is listed: the mean, and the count
+// which covers 99% and 100% of the good packets.
+//
+//   $ ./ldpc_bench -n 20000 -s -1 -t 5 [-i 32]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "ldpc.h"
+
+#define MAX_ITER 64
+
+static LDPC_Decoder       Decoder;
+static LDPC_MinSumDecoder MinSum;
+
+static double gauss(void)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// receive one packet: hard bits, Manchester error pattern and soft confidences
+static void receive(const uint8_t *sent, double sigma, uint8_t *data, uint8_t *err, int8_t *soft)
+{
+    int bit;
+
+    memset(data, 0, LDPC_Decoder::CodeBytes);
+    memset(err, 0, LDPC_Decoder::CodeBytes);
+    for (bit = 0; bit < LDPC_Decoder::CodeBits; ++bit) {
+        int b = (sent[bit >> 3] >> (bit & 7)) & 1;
+        double c1 = (b ? -1.0 : +1.0) + sigma * gauss();   // bit 1 is sent as chips 01
+        double c2 = (b ? +1.0 : -1.0) + sigma * gauss();
+        double s = 8.0 * (c2 - c1);
+
+        if ((c1 > 0) == (c2 > 0)) {
+            err[bit >> 3] |= 1 << (bit & 7);
+            if (rand() & 1)
+                data[bit >> 3] |= 1 << (bit & 7);
+        } else if (c2 > 0)
+            data[bit >> 3] |= 1 << (bit & 7);
+        soft[bit] = s > 127 ? 127 : s < -127 ? -127 : (int8_t) lrint(s);
+    }
+}
+
+struct stats {
+    int good, bad;
+    long iter;
+    int hist[MAX_ITER + 1];
+    double time;
+};
+
+static void count(struct stats *st, const uint8_t *sent, const uint8_t *out, int fail, int iter)
+{
+    if (fail)
+        return;
+    if (memcmp(sent, out, LDPC_Decoder::CodeBytes)) {
+        ++st->bad;
+        return;
+    }
+    ++st->good;
+    st->iter += iter;
+    st->hist[iter]++;
+}
+
+static int percentile(const struct stats *st, double frac)
+{
+    int i, n = 0;
+
+    for (i = 0; i <= MAX_ITER; ++i) {
+        n += st->hist[i];
+        if (n >= frac * st->good)
+            return i;
+    }
+    return MAX_ITER;
+}
+
+int main(int argc, char **argv)
+{
+    int packets = 10000, iter = LDPC_MinSumDecoder::MaxIter, i;
+    double snr_from = 4.0, snr_to = 12.0, snr_step = 1.0, snr;
+
+    for (i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            packets = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            snr_from = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            snr_to = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-d") && i + 1 < argc)
+            snr_step = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-i") && i + 1 < argc)
+            iter = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-n packets] [-s snr_from] [-t snr_to] [-d snr_step] [-i max_iter]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iter < 1 || iter > MAX_ITER)
+        iter = MAX_ITER;
+
+    printf("%d packets per point, min-sum budget %d iterations\n\n", packets, iter);
+    printf(" Es/N0   check   float  bad     hard  bad   minsum  bad  iter 99%% max  us/pkt     soft  bad  rx hard  bad       rx  bad\n");
+
+    for (snr = snr_from; snr <= snr_to + 1e-9; snr += snr_step) {
+        double sigma = sqrt(0.5 / pow(10.0, snr / 10.0));
+        struct stats st_hard, st_min, st_soft;
+        int good_check = 0, good_float = 0, bad_float = 0;
+        int good_rx_hard = 0, bad_rx_hard = 0, good_rx = 0, bad_rx = 0;
+
+        memset(&st_hard, 0, sizeof(st_hard));
+        memset(&st_min, 0, sizeof(st_min));
+        memset(&st_soft, 0, sizeof(st_soft));
+        srand(1);
+
+        for (i = 0; i < packets; ++i) {
+            uint8_t sent[LDPC_Decoder::CodeBytes], data[LDPC_Decoder::CodeBytes];
+            uint8_t err[LDPC_Decoder::CodeBytes], out[LDPC_Decoder::CodeBytes];
+            int8_t soft[LDPC_Decoder::CodeBits];
+            int k, fail;
+            clock_t start;
+
+            for (k = 0; k < 20; ++k)
+                sent[k] = rand();
+            LDPC_Encode(sent);
+            receive(sent, sigma, data, err, soft);
+
+            if (LDPC_Check(data) == 0 && !memcmp(data, sent, sizeof(sent)))
+                ++good_check;
+
+            Decoder.Input(data, err);
+            for (k = 32, fail = 1; k && fail; --k)
+                fail = Decoder.ProcessChecks();
+            Decoder.Output(out);
+            if (!fail && LDPC_Check(out) == 0)
+                memcmp(out, sent, sizeof(sent)) ? ++bad_float : ++good_float;
+
+            MinSum.Input(data);
+            fail = MinSum.Process(iter);
+            MinSum.Output(out);
+            count(&st_hard, sent, out, fail, MinSum.Iterations);
+
+            start = clock();
+            MinSum.Input(data, err);
+            fail = MinSum.Process(iter);
+            MinSum.Output(out);
+            st_min.time += clock() - start;
+            count(&st_min, sent, out, fail, MinSum.Iterations);
+
+            MinSum.Input(soft);
+            fail = MinSum.Process(iter);
+            MinSum.Output(out);
+            count(&st_soft, sent, out, fail, MinSum.Iterations);
+
+            memcpy(out, data, sizeof(out));
+            if (LDPC_Check(out) == 0 || MinSum.Repair(out))
+                memcmp(out, sent, sizeof(sent)) ? ++bad_rx_hard : ++good_rx_hard;
+            memcpy(out, data, sizeof(out));
+            if (LDPC_Check(out) == 0 || MinSum.Repair(out, err))
+                memcmp(out, sent, sizeof(sent)) ? ++bad_rx : ++good_rx;
+        }
+
+        printf("%6.1f  %5.1f%%  %5.1f%% %4d   %5.1f%% %4d   %5.1f%% %4d  %4.1f %3d %3d  %6.2f   %5.1f%% %4d   %5.1f%% %4d   %5.1f%% %4d\n", snr,
+               100.0 * good_check / packets,
+               100.0 * good_float / packets, bad_float,
+               100.0 * st_hard.good / packets, st_hard.bad,
+               100.0 * st_min.good / packets, st_min.bad,
+               st_min.good ? (double) st_min.iter / st_min.good : 0.0,
+               percentile(&st_min, 0.99), percentile(&st_min, 1.0),
+               1e6 * st_min.time / CLOCKS_PER_SEC / packets,
+               100.0 * st_soft.good / packets, st_soft.bad,
+               100.0 * good_rx_hard / packets, bad_rx_hard,
+               100.0 * good_rx / packets, bad_rx);
+    }
+    return 0;
+}
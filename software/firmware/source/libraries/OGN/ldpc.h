@@ -182,6 +182,132 @@ class LDPC_Decoder
 
 } ;
 
+// integer (offset) min-sum decoder for the (208,160) code: bit confidences are signed 8-bit values,
+// the checks are processed in layers (each check sees the bits already updated by the previous ones)
+// and the check-to-bit messages are kept packed: two smallest amplitudes, index of the smallest and a sign word per check
+class LDPC_MinSumDecoder
+{ public:
+   const static uint8_t CodeBits   = LDPC_Decoder::CodeBits;   // 208 code bits
+   const static uint8_t CodeBytes  = LDPC_Decoder::CodeBytes;  // 26 bytes
+   const static uint8_t ParityBits = LDPC_Decoder::ParityBits; // 48 parity checks
+   const static uint8_t MaxCheckWeight = LDPC_Decoder::MaxCheckWeight;
+   const static int8_t  MaxAmpl    = 127;                      // saturation of the bit confidences
+   const static int8_t  InpAmpl    =  16;                      // confidence of a bit with a clean Manchester pair
+   const static uint8_t Offset     =   1;                      // min-sum correction subtracted from check messages
+   const static uint8_t MaxIter    =  10;                      // iteration budget, as measured with extras/ldpc_bench
+   const static uint8_t MaxFlips   =   3;                      // Repair() limits: bits changed outside the Manchester errors
+   const static uint8_t MaxWeight  =  24;                      //   Manchester errors + 2 x bits changed
+   const static uint8_t MaxHardFlips = 0;                      //   bits changed without the error pattern: none, see extras/ldpc_bench
+
+  public:
+
+   int8_t   Bit[CodeBits];                                     // a-posteriori bit confidences: >0 means 1
+   uint8_t  Min1[ParityBits];                                  // smallest amplitude seen by the check
+   uint8_t  Min2[ParityBits];                                  // second smallest amplitude
+   uint8_t  MinIdx[ParityBits];                                // position of the smallest one in the check
+   uint32_t Sign[ParityBits];                                  // signs of the check-to-bit messages, one bit per position
+   uint8_t  Iterations;                                        // iterations used by the last Process()
+
+   void Clear(void)
+   { for(uint8_t Row=0; Row<ParityBits; Row++)
+     { Min1[Row]=0; Min2[Row]=0; MinIdx[Row]=0; Sign[Row]=0; }
+     Iterations=0; }
+
+   void Input(const uint8_t *Data, const uint8_t *Err=0)       // bytes and the error pattern from the Manchester decoder
+   { uint8_t Mask=1; uint8_t Idx=0; uint8_t DataByte=0; uint8_t ErrByte=0;
+     for(uint8_t BitIdx=0; BitIdx<CodeBits; BitIdx++)
+     { if(Mask==1) { DataByte=Data[Idx]; ErrByte=Err?Err[Idx]:0; }
+       if(ErrByte&Mask) Bit[BitIdx]=0;                         // invalid Manchester pair: no idea about this bit
+                   else Bit[BitIdx]=(DataByte&Mask) ? +InpAmpl:-InpAmpl;
+       Mask<<=1; if(Mask==0) { Idx++; Mask=1; }
+     }
+     Clear(); }
+
+   void Input(const int8_t *Soft)                              // confidences from a soft demodulator, in code bit order
+   { for(uint8_t Idx=0; Idx<CodeBits; Idx++)
+     { int8_t Inp=Soft[Idx]; Bit[Idx] = Inp<(-MaxAmpl) ? -MaxAmpl:Inp; }
+     Clear(); }
+
+   void Output(uint8_t Data[CodeBytes]) const
+   { uint8_t Mask=1; uint8_t Idx=0; uint8_t Byte=0;
+     for(uint8_t BitIdx=0; BitIdx<CodeBits; BitIdx++)
+     { if(Bit[BitIdx]>0) Byte|=Mask;
+       Mask<<=1; if(Mask==0) { Data[Idx++]=Byte; Byte=0; Mask=1; }
+     } if(Mask>1) Data[Idx++]=Byte;
+   }
+
+   uint8_t CheckErrors(void) const                             // count the parity checks failed by the hard decisions
+   { uint8_t Count=0;
+     for(uint8_t Row=0; Row<ParityBits; Row++)
+     { const uint8_t *CheckIndex = LDPC_ParityCheckIndex_n208k160[Row];
+       uint8_t CheckWeight = *CheckIndex++;
+       uint8_t Parity=0;
+       for(uint8_t Pos=0; Pos<CheckWeight; Pos++)
+         Parity ^= Bit[CheckIndex[Pos]]>0;
+       Count+=Parity; }
+     return Count; }
+
+   uint8_t Process(uint8_t Iter=MaxIter)                       // iterate until all checks pass: return the number of failed checks
+   { uint8_t Count=CheckErrors();
+     for(Iterations=0; Count && Iterations<Iter; )
+     { for(uint8_t Row=0; Row<ParityBits; Row++)
+         ProcessCheck(Row);
+       Iterations++;
+       Count=CheckErrors(); }
+     return Count; }
+
+   // second chance for a packet which failed the parity checks: decode it and take the result
+   // only when it needed few changes, else it is more likely a wrong codeword than the one sent
+   bool Repair(uint8_t Data[CodeBytes], const uint8_t *Err=0)
+   { if(Err==0 && MaxHardFlips==0) return 0;
+     uint8_t Out[CodeBytes];
+     Input(Data, Err);
+     if(Process()) return 0;
+     Output(Out);
+     uint8_t Erased=0, Flipped=0;
+     for(uint8_t Idx=0; Idx<CodeBytes; Idx++)
+     { uint8_t ErrByte = Err?Err[Idx]:0;
+       Erased  += Count1s(ErrByte);
+       Flipped += Count1s((uint8_t)((Out[Idx]^Data[Idx])&(~ErrByte))); }
+     if(Err) { if(Flipped>MaxFlips || Erased+2*Flipped>MaxWeight) return 0; }
+        else { if(Flipped>MaxHardFlips) return 0; }
+     for(uint8_t Idx=0; Idx<CodeBytes; Idx++) Data[Idx]=Out[Idx];
+     return 1; }
+
+   void ProcessCheck(uint8_t Row)
+   { int16_t Ext[MaxCheckWeight];                               // bit confidences without this check's own message
+     const uint8_t *CheckIndex = LDPC_ParityCheckIndex_n208k160[Row];
+     uint8_t CheckWeight = *CheckIndex++;
+     uint8_t OldMin1=Min1[Row], OldMin2=Min2[Row], OldIdx=MinIdx[Row];
+     uint32_t OldSign=Sign[Row];
+     uint8_t NewMin1=MaxAmpl, NewMin2=MaxAmpl, NewIdx=0;
+     uint32_t Word=0; uint32_t Mask=1;
+     for(uint8_t Pos=0; Pos<CheckWeight; Pos++, Mask<<=1)
+     { int16_t Msg = Pos==OldIdx ? OldMin2:OldMin1;              // unpack the message sent to this bit last time
+       if(OldSign&Mask) Msg=(-Msg);
+       int16_t Ampl = Bit[CheckIndex[Pos]] - Msg;
+       Ext[Pos]=Ampl;
+       if(Ampl>0) Word|=Mask;                                  // hard bits in the Word
+             else Ampl=(-Ampl);
+       if(Ampl>MaxAmpl) Ampl=MaxAmpl;
+       if(Ampl<NewMin1) { NewMin2=NewMin1; NewMin1=Ampl; NewIdx=Pos; }
+       else if(Ampl<NewMin2) { NewMin2=Ampl; }
+     }
+     NewMin1 = NewMin1>Offset ? NewMin1-Offset:0;              // offset correction for the min-sum approximation
+     NewMin2 = NewMin2>Offset ? NewMin2-Offset:0;
+     uint32_t NewSign = Word;                                  // message sign: make every bit agree with the parity of the others
+     if((Count1s(Word)&1)==0) NewSign^=Mask-1;                 // check passes: each bit keeps its own sign
+     Mask=1;
+     for(uint8_t Pos=0; Pos<CheckWeight; Pos++, Mask<<=1)
+     { int16_t Msg = Pos==NewIdx ? NewMin2:NewMin1;
+       if(NewSign&Mask) Msg=(-Msg);
+       int16_t Ampl = Ext[Pos]+Msg;
+       if(Ampl>MaxAmpl) Ampl=MaxAmpl; else if(Ampl<(-MaxAmpl)) Ampl=(-MaxAmpl);
+       Bit[CheckIndex[Pos]] = Ampl; }
+     Min1[Row]=NewMin1; Min2[Row]=NewMin2; MinIdx[Row]=NewIdx; Sign[Row]=NewSign; }
+
+} ;
+
 template <class Float=float>
  class LDPC_FloatDecoder
 { public:
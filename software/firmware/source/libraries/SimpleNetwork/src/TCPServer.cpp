@@ -1,25 +1,116 @@
 #include "TCPServer.h" 
 
-string TCPServer::Message;
+deque<string> TCPServer::Messages;
+pthread_mutex_t TCPServer::MessagesMutex = PTHREAD_MUTEX_INITIALIZER;
+unsigned long TCPServer::MessagesQueued = 0;
+unsigned long TCPServer::MessagesDropped = 0;
+unsigned long TCPServer::BytesReceived = 0;
+
+void TCPServer::Queue(string &msg)
+{
+	pthread_mutex_lock(&MessagesMutex);
+	if (Messages.size() >= MAXQUEUEDMESSAGES)
+	{
+		Messages.pop_front();
+		MessagesDropped++;
+	}
+	Messages.push_back(string());
+	Messages.back().swap(msg);
+	MessagesQueued++;
+	pthread_mutex_unlock(&MessagesMutex);
+}
+
+// Messages are framed per connection: a JSON object ends where its
+// braces balance, any other input at the end of the line.  A message
+// over MAXMESSAGESIZE is dropped up to where it ends.
+void TCPServer::Frame(TCPFramer &f, const char *buf, int n)
+{
+	pthread_mutex_lock(&MessagesMutex);
+	BytesReceived += n;
+	pthread_mutex_unlock(&MessagesMutex);
+	for (int i = 0; i < n; i++)
+	{
+		char c = buf[i];
+		if (!f.discard)
+		{
+			if (f.pending.empty())
+			{
+				if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+					continue;
+				f.json = (c == '{' || c == '[');
+			}
+			f.pending += c;
+			if (f.pending.size() > MAXMESSAGESIZE)
+			{
+				string().swap(f.pending);
+				f.discard = true;
+				pthread_mutex_lock(&MessagesMutex);
+				MessagesDropped++;
+				pthread_mutex_unlock(&MessagesMutex);
+			}
+		}
+		if (f.quoted)
+		{
+			if (f.escaped)
+				f.escaped = false;
+			else if (c == '\\')
+				f.escaped = true;
+			else if (c == '"')
+				f.quoted = false;
+			continue;
+		}
+		if (f.json)
+		{
+			if (c == '"')
+				f.quoted = true;
+			else if (c == '{' || c == '[')
+				f.depth++;
+			else if ((c == '}' || c == ']') && --f.depth <= 0)
+			{
+				if (!f.discard)
+					Queue(f.pending);
+				f = TCPFramer();
+			}
+		}
+		else if (c == '\n')
+		{
+			if (!f.discard)
+			{
+				f.pending.erase(f.pending.find_last_not_of("\r\n") + 1);
+				Queue(f.pending);
+			}
+			f.pending.clear();
+			f.discard = false;
+		}
+	}
+}
+
+// the connection has closed, queue a last unterminated line
+void TCPServer::Flush(TCPFramer &f)
+{
+	if (!f.pending.empty() && f.depth == 0)
+		Queue(f.pending);
+	f = TCPFramer();
+}
 
 void* TCPServer::Task(void *arg)
 {
 	int n;
 	int newsockfd = (long)arg;
 	char msg[MAXPACKETSIZE];
+	TCPFramer framer;
 	pthread_detach(pthread_self());
 	while(1)
 	{
 		n=recv(newsockfd,msg,MAXPACKETSIZE,0);
-		if(n==0)
+		if(n<=0)
 		{
 		   close(newsockfd);
 		   break;
 		}
-		msg[n]=0;
-		//send(newsockfd,msg,n,0);
-		Message = string(msg);
+		Frame(framer, msg, n);
 	}
+	Flush(framer);
 	return 0;
 }
 
@@ -47,9 +138,63 @@ string TCPServer::receive()
 	return str;
 }
 
+// Without the receive() thread: accept a connection on sockfd once
+// it is readable, and return the new socket for the caller to watch.
+int TCPServer::Accept()
+{
+	socklen_t sosize  = sizeof(clientAddress);
+	int fd = accept(sockfd,(struct sockaddr*)&clientAddress,&sosize);
+	if (fd >= 0)
+	{
+		newsockfd = fd;
+		Connections[fd] = TCPFramer();
+	}
+	return fd;
+}
+
+// Read what is available on a socket from Accept() into the queue.
+// Returns false, and closes the socket, when the connection has ended.
+bool TCPServer::Read(int fd)
+{
+	static char msg[MAXPACKETSIZE];
+	int n = recv(fd,msg,MAXPACKETSIZE,MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return true;
+	if (n <= 0)
+	{
+		Flush(Connections[fd]);
+		Connections.erase(fd);
+		close(fd);
+		return false;
+	}
+	Frame(Connections[fd], msg, n);
+	return true;
+}
+
+// oldest queued message, or "" - clean() removes it
 string TCPServer::getMessage()
 {
-	return Message;
+	string msg;
+	pthread_mutex_lock(&MessagesMutex);
+	if (!Messages.empty())
+		msg = Messages.front();
+	pthread_mutex_unlock(&MessagesMutex);
+	return msg;
+}
+
+// remove the oldest queued message into msg, false if there is none
+bool TCPServer::popMessage(string &msg)
+{
+	bool found = false;
+	pthread_mutex_lock(&MessagesMutex);
+	if (!Messages.empty())
+	{
+		msg.swap(Messages.front());
+		Messages.pop_front();
+		found = true;
+	}
+	pthread_mutex_unlock(&MessagesMutex);
+	return found;
 }
 
 void TCPServer::Send(string msg)
@@ -59,7 +204,10 @@ void TCPServer::Send(string msg)
 
 void TCPServer::clean()
 {
-	Message = "";
+	pthread_mutex_lock(&MessagesMutex);
+	if (!Messages.empty())
+		Messages.pop_front();
+	pthread_mutex_unlock(&MessagesMutex);
 //	memset(msg, 0, MAXPACKETSIZE);
 }
 
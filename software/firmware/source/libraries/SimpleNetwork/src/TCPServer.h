@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <map>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,10 +15,23 @@
 #include <string.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <errno.h>
 
 using namespace std;
 
 #define MAXPACKETSIZE 65536 // 4096
+#define MAXMESSAGESIZE (16 * MAXPACKETSIZE) // longer messages are discarded
+#define MAXQUEUEDMESSAGES 256 // oldest messages are dropped beyond this
+
+// splits the input of one connection into messages
+struct TCPFramer
+{
+	string pending;
+	int depth;
+	bool json, quoted, escaped;
+	bool discard; // too long, skip to the end of this message
+	TCPFramer() : depth(0), json(false), quoted(false), escaped(false), discard(false) {}
+};
 
 class TCPServer
 {
@@ -26,17 +41,31 @@ class TCPServer
 	struct sockaddr_in clientAddress;
 	pthread_t serverThread;
 //	char msg[ MAXPACKETSIZE ];
-	static string Message;
+
+	// ingest counters, for all connections
+	static unsigned long MessagesQueued;
+	static unsigned long MessagesDropped;
+	static unsigned long BytesReceived;
 
 	void setup(int port);
 	string receive();
+	int Accept();
+	bool Read(int fd);
 	string getMessage();
+	bool popMessage(string &msg);
 	void Send(string msg);
 	void detach();
 	void clean();
 
 	private:
+	static deque<string> Messages;
+	static pthread_mutex_t MessagesMutex;
+	map<int, TCPFramer> Connections; // for Accept() and Read()
+
 	static void * Task(void * argv);
+	static void Queue(string &msg);
+	static void Frame(TCPFramer &f, const char *buf, int n);
+	static void Flush(TCPFramer &f);
 };
 
 #endif
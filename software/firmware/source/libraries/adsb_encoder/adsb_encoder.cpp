@@ -62,12 +62,6 @@ static const unsigned int crc_table[256] PROGMEM =
 };
 #endif
 
-typedef struct cpr_pair
-{
-	unsigned int YZ;
-	unsigned int XZ;
-}cpr_pair_t;
-
 unsigned int modes_crc(unsigned char *buf, size_t  len)
 {
 	unsigned int rem = 0;
@@ -23,6 +23,13 @@ typedef struct  frame_data
 #define SURFACE_POS		1
 
 
+typedef struct cpr_pair
+{
+	unsigned int YZ;
+	unsigned int XZ;
+}cpr_pair_t;
+
+
 /*
 adsb编码初始化
 */
@@ -75,4 +82,17 @@ frame_data_t make_velocity_frame(
 	DF df); 
 
 
+/*
+ The building blocks of make_air_position_frame(), for callers that
+ keep the CPR encoding of a position that has not changed
+*/
+cpr_pair_t cpr_encode(double lat, double lon, int odd, int surface);
+
+unsigned int encode_altitude(double ft);
+
+frame_data_t _make_air_position_frame(unsigned short metype, unsigned int addr,
+	unsigned int elat, unsigned int elon, unsigned int ealt,
+	unsigned int oddflag, DF df);
+
+
 #endif
@@ -411,6 +411,7 @@ struct lmic_t {
     u1_t        dataBeg;    // 0 or start of data (dataBeg-1 is port)
     u1_t        dataLen;    // 0 no data or zero length data, >0 byte count of data
     u1_t        frame[MAX_LEN_FRAME];
+    u1_t        frame_err[MAX_LEN_FRAME]; // Manchester errors in frame (bits with both chips equal)
 
 #if !defined(DISABLE_CLASSB)
     u1_t        bcnfAns;      // mcmd beacon freq: bit7:pending, bit0:ACK/NACK
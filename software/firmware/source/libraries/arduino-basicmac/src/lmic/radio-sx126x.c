@@ -276,6 +276,8 @@ static void ReadBuffer (uint8_t off, uint8_t* data, uint8_t len) {
         val1 = pgm_read_byte(&ManchesterDecode[hal_spi(0x00)]);
         val2 = pgm_read_byte(&ManchesterDecode[hal_spi(0x00)]);
         data[i>>1] = ((val1 & 0x0F) << 4) | (val2 & 0x0F);
+        // keep the error pattern, for soft decision decoding
+        LMIC.frame_err[i>>1] = (val1 & 0xF0) | (val2 >> 4);
         i++;
         break;
       case RF_WHITENING_NONE:
@@ -0,0 +1,175 @@
+//
+// fec_bench - time correct_adsb_frame() over captured UAT downlink frames,
+// against the general purpose decode_rs_char() it replaced.
+//
+// Build on a host, from this directory:
+//
+//   g++ -O2 -I../src -o fec_bench fec_bench.cpp ../src/fec.cpp
+//       ../src/fec/decode_rs_char.cpp ../src/fec/init_rs_char.cpp
+//
+// (all on one line)
+//
+// Input is one downlink message per line, as dump978 writes them:
+//
+//   -0123456789abcdef...;
+//
+// Lines may hold the whole received frame (30 or 48 bytes, with parity),
+// or just the data (18 or 34 bytes) as dump978 prints them, in which case
+// the parity is recomputed.  -e N adds up to N random byte errors to each
+// frame, -n N repeats the run N times.
+//
+//   $ zcat sample-data.txt.gz | grep "^-" | ./fec_bench -e 4
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "uat.h"
+#include "fec.h"
+#include "fec/char.h"
+#include "fec/rs-common.h"
+#include "fec/rs.h"
+
+#define MAX_FRAMES 100000
+
+static uint8_t frames[MAX_FRAMES][LONG_FRAME_BYTES];
+static int n_frames;
+
+static void encode_rs_char(void *p, data_t *data, data_t *parity)
+{
+    struct rs *rs = (struct rs *)p;
+#include "fec/encode_rs.h"
+}
+
+// general purpose decoders, as correct_adsb_frame() used them before
+static void *rs_adsb_short;
+static void *rs_adsb_long;
+
+static int reference_adsb_frame(uint8_t *to, int *rs_errors)
+{
+    int n_corrected = decode_rs_char(rs_adsb_long, to, NULL, 0);
+    if (n_corrected >= 0 && n_corrected <= 7 && (to[0]>>3) != 0) {
+        *rs_errors = n_corrected;
+        return 2;
+    }
+
+    n_corrected = decode_rs_char(rs_adsb_short, to, NULL, 0);
+    if (n_corrected >= 0 && n_corrected <= 6 && (to[0]>>3) == 0) {
+        *rs_errors = n_corrected;
+        return 1;
+    }
+
+    *rs_errors = 9999;
+    return -1;
+}
+
+static int hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void read_frames(FILE *in, int max_errors)
+{
+    char line[1024];
+
+    while (n_frames < MAX_FRAMES && fgets(line, sizeof(line), in)) {
+        uint8_t *f = frames[n_frames];
+        int len = 0;
+        char *p;
+
+        if (line[0] != '-')
+            continue;
+
+        memset(f, 0, LONG_FRAME_BYTES);
+        for (p = line + 1; len < LONG_FRAME_BYTES; p += 2) {
+            int h = hexval(p[0]), l = (h < 0 ? -1 : hexval(p[1]));
+            if (l < 0)
+                break;
+            f[len++] = (h << 4) | l;
+        }
+
+        if (len == LONG_FRAME_DATA_BYTES)
+            encode_rs_char(rs_adsb_long, f, f + LONG_FRAME_DATA_BYTES);
+        else if (len == SHORT_FRAME_DATA_BYTES)
+            encode_rs_char(rs_adsb_short, f, f + SHORT_FRAME_DATA_BYTES);
+        else if (len != LONG_FRAME_BYTES && len != SHORT_FRAME_BYTES)
+            continue;
+
+        if (max_errors > 0) {
+            int n = rand() % (max_errors + 1);
+            int span = ((f[0]>>3) ? LONG_FRAME_BYTES : SHORT_FRAME_BYTES);
+            while (n-- > 0)
+                f[rand() % span] ^= 1 + rand() % 255;
+        }
+
+        ++n_frames;
+    }
+}
+
+static double run(int (*correct)(uint8_t *, int *), int repeat, int *n_good, long *n_fixed)
+{
+    clock_t start = clock();
+    int r, i;
+
+    *n_good = 0;
+    *n_fixed = 0;
+    for (r = 0; r < repeat; ++r) {
+        for (i = 0; i < n_frames; ++i) {
+            uint8_t f[LONG_FRAME_BYTES];
+            int rs_errors;
+
+            memcpy(f, frames[i], LONG_FRAME_BYTES);
+            if (correct(f, &rs_errors) > 0 && r == 0) {
+                ++*n_good;
+                *n_fixed += rs_errors;
+            }
+        }
+    }
+
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv)
+{
+    int max_errors = 0, repeat = 100, i;
+    int good_new, good_ref;
+    long fixed_new, fixed_ref;
+    double t_new, t_ref;
+
+    for (i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-e") && i + 1 < argc)
+            max_errors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-e max_errors] [-n repeat] < frames\n", argv[0]);
+            return 1;
+        }
+    }
+
+    init_fec();
+    rs_adsb_short = init_rs_char(8, 0x187, 120, 1, 12, 225);
+    rs_adsb_long  = init_rs_char(8, 0x187, 120, 1, 14, 207);
+
+    read_frames(stdin, max_errors);
+    if (n_frames == 0) {
+        fprintf(stderr, "no downlink frames read\n");
+        return 1;
+    }
+
+    t_new = run(correct_adsb_frame, repeat, &good_new, &fixed_new);
+    t_ref = run(reference_adsb_frame, repeat, &good_ref, &fixed_ref);
+
+    printf("%d frames x %d\n", n_frames, repeat);
+    printf("correct_adsb_frame: %8.3f us/frame, %d good, %ld bytes corrected\n",
+           1e6 * t_new / ((double) n_frames * repeat), good_new, fixed_new);
+    printf("decode_rs_char:     %8.3f us/frame, %d good, %ld bytes corrected\n",
+           1e6 * t_ref / ((double) n_frames * repeat), good_ref, fixed_ref);
+    return 0;
+}
@@ -26,16 +26,228 @@
 #include "fec/rs.h"
 
 static void *rs_uplink;
-static void *rs_adsb_short;
-static void *rs_adsb_long;
 
 #define UPLINK_POLY 0x187
 #define ADSB_POLY 0x187
 
+//
+// Downlink (ADS-B) frames are corrected by a decoder specialized for their
+// two codes rather than by the general purpose decode_rs_char():
+// GF(2^8) with ADSB_POLY, fcr 120, prim 1, and 14 roots over the 48 bytes
+// of a Long UAT or 12 roots over the 30 bytes of a Basic UAT.
+// The field tables are constants (they stay in flash on the MCUs), and a
+// frame that is already error-free - most of them - only costs computing
+// its syndromes.
+//
+
+#define GF_A0           255     // log(0)
+#define ADSB_FCR        120
+#define ADSB_MAX_ROOTS  14
+
+/* log (index form) of each field element, gf_log[0] = GF_A0 standing for log(0) */
+static const uint8_t gf_log[256] = {
+    255,  0,  1, 99,  2,198,100,106,  3,205,199,188,101,126,107, 42,
+      4,141,206, 78,200,212,189,225,102,221,127, 49,108, 32, 43,243,
+      5, 87,142,232,207,172, 79,131,201,217,213, 65,190,148,226,180,
+    103, 39,222,240,128,177, 50, 53,109, 69, 33, 18, 44, 13,244, 56,
+      6,155, 88, 26,143,121,233,112,208,194,173,168, 80,117,132, 72,
+    202,252,218,138,214, 84, 66, 36,191,152,149,249,227, 94,181, 21,
+    104, 97, 40,186,223, 76,241, 47,129,230,178, 63, 51,238, 54, 16,
+    110, 24, 70,166, 34,136, 19,247, 45,184, 14, 61,245,164, 57, 59,
+      7,158,156,157, 89,159, 27,  8,144,  9,122, 28,234,160,113, 90,
+    209, 29,195,123,174, 10,169,145, 81, 91,118,114,133,161, 73,235,
+    203,124,253,196,219, 30,139,210,215,146, 85,170, 67, 11, 37,175,
+    192,115,153,119,150, 92,250, 82,228,236, 95, 74,182,162, 22,134,
+    105,197, 98,254, 41,125,187,204,224,211, 77,140,242, 31, 48,220,
+    130,171,231, 86,179,147, 64,216, 52,176,239, 38, 55, 12, 17, 68,
+    111,120, 25,154, 71,116,167,193, 35, 83,137,251, 20, 93,248,151,
+     46, 75,185, 96, 15,237, 62,229,246,135,165, 23, 58,163, 60,183
+};
+
+/* alpha**i, twice over, so that the sum of two logs needs no reduction */
+static const uint8_t gf_exp[2 * 255] = {
+      1,  2,  4,  8, 16, 32, 64,128,135,137,149,173,221, 61,122,244,
+    111,222, 59,118,236, 95,190,251,113,226, 67,134,139,145,165,205,
+     29, 58,116,232, 87,174,219, 49, 98,196, 15, 30, 60,120,240,103,
+    206, 27, 54,108,216, 55,110,220, 63,126,252,127,254,123,246,107,
+    214, 43, 86,172,223, 57,114,228, 79,158,187,241,101,202, 19, 38,
+     76,152,183,233, 85,170,211, 33, 66,132,143,153,181,237, 93,186,
+    243, 97,194,  3,  6, 12, 24, 48, 96,192,  7, 14, 28, 56,112,224,
+     71,142,155,177,229, 77,154,179,225, 69,138,147,161,197, 13, 26,
+     52,104,208, 39, 78,156,191,249,117,234, 83,166,203, 17, 34, 68,
+    136,151,169,213, 45, 90,180,239, 89,178,227, 65,130,131,129,133,
+    141,157,189,253,125,250,115,230, 75,150,171,209, 37, 74,148,175,
+    217, 53,106,212, 47, 94,188,255,121,242, 99,198, 11, 22, 44, 88,
+    176,231, 73,146,163,193,  5, 10, 20, 40, 80,160,199,  9, 18, 36,
+     72,144,167,201, 21, 42, 84,168,215, 41, 82,164,207, 25, 50,100,
+    200, 23, 46, 92,184,247,105,210, 35, 70,140,159,185,245,109,218,
+     51,102,204, 31, 62,124,248,119,238, 91,182,235, 81,162,195,  1,
+      2,  4,  8, 16, 32, 64,128,135,137,149,173,221, 61,122,244,111,
+    222, 59,118,236, 95,190,251,113,226, 67,134,139,145,165,205, 29,
+     58,116,232, 87,174,219, 49, 98,196, 15, 30, 60,120,240,103,206,
+     27, 54,108,216, 55,110,220, 63,126,252,127,254,123,246,107,214,
+     43, 86,172,223, 57,114,228, 79,158,187,241,101,202, 19, 38, 76,
+    152,183,233, 85,170,211, 33, 66,132,143,153,181,237, 93,186,243,
+     97,194,  3,  6, 12, 24, 48, 96,192,  7, 14, 28, 56,112,224, 71,
+    142,155,177,229, 77,154,179,225, 69,138,147,161,197, 13, 26, 52,
+    104,208, 39, 78,156,191,249,117,234, 83,166,203, 17, 34, 68,136,
+    151,169,213, 45, 90,180,239, 89,178,227, 65,130,131,129,133,141,
+    157,189,253,125,250,115,230, 75,150,171,209, 37, 74,148,175,217,
+     53,106,212, 47, 94,188,255,121,242, 99,198, 11, 22, 44, 88,176,
+    231, 73,146,163,193,  5, 10, 20, 40, 80,160,199,  9, 18, 36, 72,
+    144,167,201, 21, 42, 84,168,215, 41, 82,164,207, 25, 50,100,200,
+     23, 46, 92,184,247,105,210, 35, 70,140,159,185,245,109,218, 51,
+    102,204, 31, 62,124,248,119,238, 91,182,235, 81,162,195
+};
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b)
+{
+    return (a == 0 || b == 0) ? 0 : gf_exp[gf_log[a] + gf_log[b]];
+}
+
+// Evaluate the received block at the roots of the generator polynomial.
+// Returns nonzero if any syndrome is nonzero, i.e. the block has errors.
+static int rs_syndromes(const uint8_t *data, int len, int nroots, uint8_t *s)
+{
+    uint8_t any = 0;
+    int i, j;
+
+    for (i = 0; i < nroots; ++i) {
+        int root = ADSB_FCR + i;        // log of the root, < 255
+        uint8_t si = data[0];
+
+        for (j = 1; j < len; ++j)
+            si = data[j] ^ (si ? gf_exp[gf_log[si] + root] : 0);
+
+        s[i] = si;
+        any |= si;
+    }
+
+    return any;
+}
+
+// Correct the block in place, given its (nonzero) syndromes.
+// Returns the number of corrected bytes, or -1 if uncorrectable,
+// in which case the data is left untouched.
+static int rs_correct(uint8_t *data, int len, int nroots, const uint8_t *s)
+{
+    uint8_t lambda[ADSB_MAX_ROOTS + 1], b[ADSB_MAX_ROOTS + 1], t[ADSB_MAX_ROOTS + 1];
+    uint8_t omega[ADSB_MAX_ROOTS / 2];
+    int reg[ADSB_MAX_ROOTS / 2 + 1];
+    int loc[ADSB_MAX_ROOTS / 2], xinv[ADSB_MAX_ROOTS / 2];
+    uint8_t err[ADSB_MAX_ROOTS / 2];
+    uint8_t bb = 1;
+    int el = 0, m = 1, deg, count, i, j, r, k;
+
+    // Berlekamp-Massey: the error locator polynomial lambda(x)
+    memset(lambda, 0, sizeof(lambda));
+    memset(b, 0, sizeof(b));
+    lambda[0] = b[0] = 1;
+
+    for (r = 0; r < nroots; ++r) {
+        uint8_t d = s[r];
+        for (i = 1; i <= el; ++i)
+            d ^= gf_mul(lambda[i], s[r - i]);
+
+        if (d == 0) {
+            ++m;
+            continue;
+        }
+
+        int coef = gf_log[d] + 255 - gf_log[bb];    // log(d / bb)
+        if (coef >= 255)
+            coef -= 255;
+
+        int grow = (2 * el <= r);
+        if (grow)
+            memcpy(t, lambda, nroots + 1);
+        for (i = m; i <= nroots; ++i) {
+            if (b[i - m])
+                lambda[i] ^= gf_exp[coef + gf_log[b[i - m]]];
+        }
+        if (grow) {
+            el = r + 1 - el;
+            memcpy(b, t, nroots + 1);
+            bb = d;
+            m = 1;
+        } else {
+            ++m;
+        }
+    }
+
+    deg = nroots;
+    while (deg > 0 && lambda[deg] == 0)
+        --deg;
+    if (deg == 0 || 2 * deg > nroots)
+        return -1;
+
+    // Chien search, over the positions actually in the (shortened) block:
+    // data[k] is the coefficient of x^p, p = len-1-k, and an error there
+    // makes alpha^-p a root of lambda(x).
+    for (i = 1; i <= deg; ++i)
+        reg[i] = lambda[i] ? (gf_log[lambda[i]] + i * (256 - len)) % 255 : -1;
+
+    count = 0;
+    for (k = 0; k < len; ++k) {
+        uint8_t q = 1;      // lambda[0]
+        for (i = 1; i <= deg; ++i) {
+            if (reg[i] >= 0) {
+                q ^= gf_exp[reg[i]];
+                reg[i] += i;
+                if (reg[i] >= 255)
+                    reg[i] -= 255;
+            }
+        }
+        if (q == 0) {
+            if (count == deg)
+                return -1;
+            loc[count] = k;
+            xinv[count] = (255 - (len - 1 - k)) % 255;     // log of alpha^-p
+            ++count;
+        }
+    }
+    if (count != deg)
+        return -1;
+
+    // Forney: error values from omega(x) = s(x) * lambda(x) mod x^deg
+    for (i = 0; i < deg; ++i) {
+        uint8_t tmp = 0;
+        for (j = 0; j <= i; ++j)
+            tmp ^= gf_mul(s[i - j], lambda[j]);
+        omega[i] = tmp;
+    }
+
+    for (j = 0; j < count; ++j) {
+        uint8_t num1 = 0, den = 0;
+
+        for (i = 0; i < deg; ++i) {
+            if (omega[i])
+                num1 ^= gf_exp[(gf_log[omega[i]] + i * xinv[j]) % 255];
+        }
+        // the formal derivative of lambda: odd terms only
+        for (i = 1; i <= deg; i += 2) {
+            if (lambda[i])
+                den ^= gf_exp[(gf_log[lambda[i]] + (i - 1) * xinv[j]) % 255];
+        }
+        if (den == 0)
+            return -1;
+
+        if (num1 == 0) {
+            err[j] = 0;
+        } else {
+            int num2 = (xinv[j] * (ADSB_FCR - 1)) % 255;     // log of X^(1-fcr)
+            err[j] = gf_exp[(gf_log[num1] + num2 + 255 - gf_log[den]) % 255];
+        }
+    }
+
+    for (j = 0; j < count; ++j)
+        data[loc[j]] ^= err[j];
+
+    return count;
+}
+
 void init_fec(void)
 {
-    rs_adsb_short = init_rs_char(8, /* gfpoly */ ADSB_POLY, /* fcr */ 120, /* prim */ 1, /* nroots */ 12, /* pad */ 225);
-    rs_adsb_long  = init_rs_char(8, /* gfpoly */ ADSB_POLY, /* fcr */ 120, /* prim */ 1, /* nroots */ 14, /* pad */ 207);
 #if !defined(ESP8266) && !defined(ENERGIA_ARCH_CC13XX) && !defined(ENERGIA_ARCH_CC13X2) && \
     !defined(__ASR6501__) && !defined(ARDUINO_ARCH_STM32)
     rs_uplink     = init_rs_char(8, /* gfpoly */ UPLINK_POLY, /* fcr */ 120, /* prim */ 1, /* nroots */ 20, /* pad */ 163);
@@ -44,10 +256,14 @@ void init_fec(void)
 
 int correct_adsb_frame(uint8_t *to, int *rs_errors)
 {
+    uint8_t s[ADSB_MAX_ROOTS];
+
     // Try decoding as a Long UAT.
-    // We rely on decode_rs_char not modifying the data if there were
+    // We rely on rs_correct not modifying the data if there were
     // uncorrectable errors.
-    int n_corrected = decode_rs_char(rs_adsb_long, to, NULL, 0);
+    int n_corrected = 0;
+    if (rs_syndromes(to, LONG_FRAME_BYTES, LONG_FRAME_BYTES - LONG_FRAME_DATA_BYTES, s))
+        n_corrected = rs_correct(to, LONG_FRAME_BYTES, LONG_FRAME_BYTES - LONG_FRAME_DATA_BYTES, s);
     if (n_corrected >= 0 && n_corrected <= 7 && (to[0]>>3) != 0) {
         // Valid long frame.
         *rs_errors = n_corrected;
@@ -55,7 +271,9 @@ int correct_adsb_frame(uint8_t *to, int *rs_errors)
     }
 
     // Retry as Basic UAT
-    n_corrected = decode_rs_char(rs_adsb_short, to, NULL, 0);
+    n_corrected = 0;
+    if (rs_syndromes(to, SHORT_FRAME_BYTES, SHORT_FRAME_BYTES - SHORT_FRAME_DATA_BYTES, s))
+        n_corrected = rs_correct(to, SHORT_FRAME_BYTES, SHORT_FRAME_BYTES - SHORT_FRAME_DATA_BYTES, s);
     if (n_corrected >= 0 && n_corrected <= 6 && (to[0]>>3) == 0) {
         // Valid short frame
         *rs_errors = n_corrected;
@@ -0,0 +1,257 @@
+//
+// crc_bench - time mode_s_checksum() and the single and two bit error
+// correction over Mode S frames, against the bit at a time versions they
+// replaced.
+//
+// Build on a host, from this directory:
+//
+//   gcc -O2 -I../src -o crc_bench crc_bench.c ../src/mode-s.c ../src/maglut.c -lm
+//
+// Input is one frame per line in the form dump1090 writes them, or -s N
+// synthesizes N random DF11 and DF17 frames with a valid checksum instead:
+//
+//   *8d4840d6202cc371c32ce0576098;
+//
+// -e N flips up to N random bits in each frame (N at most 2 is corrected),
+// -n N repeats the run N times.  "good" counts the frames which pass the
+// checksum after correction, "same" the frames where both versions agree
+// on the result.
+//
+//   $ ./crc_bench -s 20000 -e 2 -n 10
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "mode-s.h"
+
+#define MAX_FRAMES 100000
+#define LONG_BITS  112
+#define SHORT_BITS 56
+
+extern uint32_t mode_s_checksum_table[];
+int fix_single_bit_errors(unsigned char *msg, int bits);
+int fix_two_bits_errors(unsigned char *msg, int bits);
+
+static unsigned char frames[MAX_FRAMES][MODE_S_LONG_MSG_BYTES];
+static int frame_bits[MAX_FRAMES];
+static int n_frames;
+
+// the checksum and the error correction as they were, one bit at a time
+static uint32_t reference_checksum(unsigned char *msg, int bits)
+{
+    uint32_t crc = 0;
+    int offset = (bits == 112) ? 0 : (112-56);
+    int j;
+
+    for (j = 0; j < bits; j++) {
+        if (msg[j/8] & (1 << (7-(j%8))))
+            crc ^= mode_s_checksum_table[j+offset];
+    }
+    return crc;
+}
+
+static uint32_t received_crc(unsigned char *msg, int bits)
+{
+    return ((uint32_t)msg[(bits/8)-3] << 16) |
+           ((uint32_t)msg[(bits/8)-2] << 8) |
+            (uint32_t)msg[(bits/8)-1];
+}
+
+static int reference_fix_single(unsigned char *msg, int bits)
+{
+    unsigned char aux[MODE_S_LONG_MSG_BYTES];
+    int j;
+
+    for (j = 0; j < bits; j++) {
+        memcpy(aux, msg, bits/8);
+        aux[j/8] ^= 1 << (7-(j%8));
+        if (received_crc(aux, bits) == reference_checksum(aux, bits)) {
+            memcpy(msg, aux, bits/8);
+            return j;
+        }
+    }
+    return -1;
+}
+
+static int reference_fix_two(unsigned char *msg, int bits)
+{
+    unsigned char aux[MODE_S_LONG_MSG_BYTES];
+    int j, i;
+
+    for (j = 0; j < bits; j++) {
+        for (i = j+1; i < bits; i++) {
+            memcpy(aux, msg, bits/8);
+            aux[j/8] ^= 1 << (7-(j%8));
+            aux[i/8] ^= 1 << (7-(i%8));
+            if (received_crc(aux, bits) == reference_checksum(aux, bits)) {
+                memcpy(msg, aux, bits/8);
+                return j | (i<<8);
+            }
+        }
+    }
+    return -1;
+}
+
+typedef struct {
+    uint32_t (*checksum)(unsigned char *, int);
+    int (*fix_single)(unsigned char *, int);
+    int (*fix_two)(unsigned char *, int);
+} crc_impl_t;
+
+static const crc_impl_t impl_new = { mode_s_checksum, fix_single_bit_errors, fix_two_bits_errors };
+static const crc_impl_t impl_ref = { reference_checksum, reference_fix_single, reference_fix_two };
+
+static int hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static void add_frame(unsigned char *f, int bits, int max_errors)
+{
+    if (max_errors > 0) {
+        int n = rand() % (max_errors + 1);
+        while (n-- > 0) {
+            int j = rand() % bits;
+            f[j/8] ^= 1 << (7-(j%8));
+        }
+    }
+    frame_bits[n_frames++] = bits;
+}
+
+static void read_frames(FILE *in, int max_errors)
+{
+    char line[256];
+
+    while (n_frames < MAX_FRAMES && fgets(line, sizeof(line), in)) {
+        unsigned char *f = frames[n_frames];
+        int len = 0;
+        char *p;
+
+        if (line[0] != '*')
+            continue;
+
+        for (p = line + 1; len < MODE_S_LONG_MSG_BYTES; p += 2) {
+            int h = hexval(p[0]), l = (h < 0 ? -1 : hexval(p[1]));
+            if (l < 0)
+                break;
+            f[len++] = (h << 4) | l;
+        }
+        if (len*8 != LONG_BITS && len*8 != SHORT_BITS)
+            continue;
+
+        add_frame(f, len*8, max_errors);
+    }
+}
+
+static void synthesize_frames(int n, int max_errors)
+{
+    while (n_frames < MAX_FRAMES && n-- > 0) {
+        unsigned char *f = frames[n_frames];
+        int bits = (rand() & 1) ? LONG_BITS : SHORT_BITS;
+        uint32_t crc;
+        int i;
+
+        for (i = 0; i < bits/8; i++)
+            f[i] = rand() & 0xff;
+        f[0] = ((bits == LONG_BITS ? 17 : 11) << 3) | (f[0] & 7);
+        crc = mode_s_checksum(f, bits);
+        f[bits/8-3] = crc >> 16;
+        f[bits/8-2] = crc >> 8;
+        f[bits/8-1] = crc;
+
+        add_frame(f, bits, max_errors);
+    }
+}
+
+static double run(const crc_impl_t *impl, int repeat, unsigned char (*out)[MODE_S_LONG_MSG_BYTES],
+                  int *n_good)
+{
+    clock_t start = clock();
+    int r, i;
+
+    *n_good = 0;
+    for (r = 0; r < repeat; ++r) {
+        for (i = 0; i < n_frames; ++i) {
+            unsigned char *f = out[i];
+            int bits = frame_bits[i];
+
+            memcpy(f, frames[i], MODE_S_LONG_MSG_BYTES);
+            if (received_crc(f, bits) == impl->checksum(f, bits) ||
+                impl->fix_single(f, bits) != -1 ||
+                (bits == LONG_BITS && impl->fix_two(f, bits) != -1)) {
+                if (r == 0)
+                    ++*n_good;
+            }
+        }
+    }
+
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static double run_checksum(const crc_impl_t *impl, int repeat)
+{
+    clock_t start = clock();
+    volatile uint32_t sink = 0;
+    int r, i;
+
+    for (r = 0; r < repeat; ++r)
+        for (i = 0; i < n_frames; ++i)
+            sink ^= impl->checksum(frames[i], frame_bits[i]);
+
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char **argv)
+{
+    static unsigned char out_new[MAX_FRAMES][MODE_S_LONG_MSG_BYTES];
+    static unsigned char out_ref[MAX_FRAMES][MODE_S_LONG_MSG_BYTES];
+    int max_errors = 0, repeat = 1, synthesize = 0, i;
+    int good_new, good_ref, same = 0;
+    double t_new, t_ref, c_new, c_ref, n;
+
+    for (i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-e") && i + 1 < argc)
+            max_errors = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            synthesize = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-s frames] [-e max_errors] [-n repeat] [< frames]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    srand(1);
+    if (synthesize > 0)
+        synthesize_frames(synthesize, max_errors);
+    else
+        read_frames(stdin, max_errors);
+    if (n_frames == 0) {
+        fprintf(stderr, "no Mode S frames read\n");
+        return 1;
+    }
+
+    c_new = run_checksum(&impl_new, repeat);
+    c_ref = run_checksum(&impl_ref, repeat);
+    t_new = run(&impl_new, repeat, out_new, &good_new);
+    t_ref = run(&impl_ref, repeat, out_ref, &good_ref);
+    for (i = 0; i < n_frames; ++i)
+        if (!memcmp(out_new[i], out_ref[i], frame_bits[i]/8))
+            ++same;
+    n = (double) n_frames * repeat;
+
+    printf("%d frames x %d, %d same\n", n_frames, repeat, same);
+    printf("checksum, byte table:   %8.3f us/frame\n", 1e6 * c_new / n);
+    printf("checksum, bit table:    %8.3f us/frame\n", 1e6 * c_ref / n);
+    printf("correction, syndromes:  %8.3f us/frame, %d good\n", 1e6 * t_new / n, good_new);
+    printf("correction, bit flips:  %8.3f us/frame, %d good\n", 1e6 * t_ref / n, good_ref);
+    return 0;
+}
@@ -75,20 +75,52 @@ uint32_t mode_s_checksum_table[] = {
   0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000
 };
 
+// Byte-wise form of the same computation: the checksum is the remainder of
+// the data bits (without the checksum bits) divided by the Mode S generator
+// polynomial 0x1fff409, and entry n of this table is the remainder for the
+// byte n. Gives the same result as xoring the table above bit by bit.
+const uint32_t mode_s_crc_table[256] = {
+  0x000000, 0xfff409, 0x001c1b, 0xffe812, 0x003836, 0xffcc3f, 0x00242d, 0xffd024,
+  0x00706c, 0xff8465, 0x006c77, 0xff987e, 0x00485a, 0xffbc53, 0x005441, 0xffa048,
+  0x00e0d8, 0xff14d1, 0x00fcc3, 0xff08ca, 0x00d8ee, 0xff2ce7, 0x00c4f5, 0xff30fc,
+  0x0090b4, 0xff64bd, 0x008caf, 0xff78a6, 0x00a882, 0xff5c8b, 0x00b499, 0xff4090,
+  0x01c1b0, 0xfe35b9, 0x01ddab, 0xfe29a2, 0x01f986, 0xfe0d8f, 0x01e59d, 0xfe1194,
+  0x01b1dc, 0xfe45d5, 0x01adc7, 0xfe59ce, 0x0189ea, 0xfe7de3, 0x0195f1, 0xfe61f8,
+  0x012168, 0xfed561, 0x013d73, 0xfec97a, 0x01195e, 0xfeed57, 0x010545, 0xfef14c,
+  0x015104, 0xfea50d, 0x014d1f, 0xfeb916, 0x016932, 0xfe9d3b, 0x017529, 0xfe8120,
+  0x038360, 0xfc7769, 0x039f7b, 0xfc6b72, 0x03bb56, 0xfc4f5f, 0x03a74d, 0xfc5344,
+  0x03f30c, 0xfc0705, 0x03ef17, 0xfc1b1e, 0x03cb3a, 0xfc3f33, 0x03d721, 0xfc2328,
+  0x0363b8, 0xfc97b1, 0x037fa3, 0xfc8baa, 0x035b8e, 0xfcaf87, 0x034795, 0xfcb39c,
+  0x0313d4, 0xfce7dd, 0x030fcf, 0xfcfbc6, 0x032be2, 0xfcdfeb, 0x0337f9, 0xfcc3f0,
+  0x0242d0, 0xfdb6d9, 0x025ecb, 0xfdaac2, 0x027ae6, 0xfd8eef, 0x0266fd, 0xfd92f4,
+  0x0232bc, 0xfdc6b5, 0x022ea7, 0xfddaae, 0x020a8a, 0xfdfe83, 0x021691, 0xfde298,
+  0x02a208, 0xfd5601, 0x02be13, 0xfd4a1a, 0x029a3e, 0xfd6e37, 0x028625, 0xfd722c,
+  0x02d264, 0xfd266d, 0x02ce7f, 0xfd3a76, 0x02ea52, 0xfd1e5b, 0x02f649, 0xfd0240,
+  0x0706c0, 0xf8f2c9, 0x071adb, 0xf8eed2, 0x073ef6, 0xf8caff, 0x0722ed, 0xf8d6e4,
+  0x0776ac, 0xf882a5, 0x076ab7, 0xf89ebe, 0x074e9a, 0xf8ba93, 0x075281, 0xf8a688,
+  0x07e618, 0xf81211, 0x07fa03, 0xf80e0a, 0x07de2e, 0xf82a27, 0x07c235, 0xf8363c,
+  0x079674, 0xf8627d, 0x078a6f, 0xf87e66, 0x07ae42, 0xf85a4b, 0x07b259, 0xf84650,
+  0x06c770, 0xf93379, 0x06db6b, 0xf92f62, 0x06ff46, 0xf90b4f, 0x06e35d, 0xf91754,
+  0x06b71c, 0xf94315, 0x06ab07, 0xf95f0e, 0x068f2a, 0xf97b23, 0x069331, 0xf96738,
+  0x0627a8, 0xf9d3a1, 0x063bb3, 0xf9cfba, 0x061f9e, 0xf9eb97, 0x060385, 0xf9f78c,
+  0x0657c4, 0xf9a3cd, 0x064bdf, 0xf9bfd6, 0x066ff2, 0xf99bfb, 0x0673e9, 0xf987e0,
+  0x0485a0, 0xfb71a9, 0x0499bb, 0xfb6db2, 0x04bd96, 0xfb499f, 0x04a18d, 0xfb5584,
+  0x04f5cc, 0xfb01c5, 0x04e9d7, 0xfb1dde, 0x04cdfa, 0xfb39f3, 0x04d1e1, 0xfb25e8,
+  0x046578, 0xfb9171, 0x047963, 0xfb8d6a, 0x045d4e, 0xfba947, 0x044155, 0xfbb55c,
+  0x041514, 0xfbe11d, 0x04090f, 0xfbfd06, 0x042d22, 0xfbd92b, 0x043139, 0xfbc530,
+  0x054410, 0xfab019, 0x05580b, 0xfaac02, 0x057c26, 0xfa882f, 0x05603d, 0xfa9434,
+  0x05347c, 0xfac075, 0x052867, 0xfadc6e, 0x050c4a, 0xfaf843, 0x051051, 0xfae458,
+  0x05a4c8, 0xfa50c1, 0x05b8d3, 0xfa4cda, 0x059cfe, 0xfa68f7, 0x0580e5, 0xfa74ec,
+  0x05d4a4, 0xfa20ad, 0x05c8bf, 0xfa3cb6, 0x05ec92, 0xfa189b, 0x05f089, 0xfa0480
+};
+
 uint32_t mode_s_checksum(unsigned char *msg, int bits) {
   uint32_t crc = 0;
-  int offset = (bits == 112) ? 0 : (112-56);
+  int n = bits/8 - 3; // Skip the checksum at the end.
   int j;
 
-  for(j = 0; j < bits; j++) {
-    int byte = j/8;
-    int bit = j%8;
-    int bitmask = 1 << (7-bit);
-
-    // If bit is set, xor with corresponding table entry.
-    if (msg[byte] & bitmask)
-      crc ^= mode_s_checksum_table[j+offset];
-  }
+  for (j = 0; j < n; j++)
+    crc = ((crc << 8) & 0xffffff) ^ mode_s_crc_table[((crc >> 16) ^ msg[j]) & 0xff];
   return crc; // 24 bit checksum.
 }
 
@@ -103,72 +135,106 @@ int mode_s_msg_len_by_type(int type) {
     return MODE_S_SHORT_MSG_BITS;
 }
 
+// Flipping bit j of a message changes its syndrome (the xor of the computed
+// checksum and the one received) by a value that only depends on j, and those
+// values differ for all 112 bits, and for all pairs of bits. So the error bits
+// can be looked up from the syndrome instead of trying every bit (pair).
+//
+// The table is indexed by a hash of the syndrome and holds the bit position
+// in a long message, a short message uses the last 56 positions.
+#define MODE_S_SYNDROME_LEN 256 // Power of two required
+
+static uint32_t syndrome_crc[MODE_S_SYNDROME_LEN];
+static int8_t syndrome_bit[MODE_S_SYNDROME_LEN];
+static int syndrome_initialized = 0;
+
+// Syndrome of an error at bit j of a long message.
+static uint32_t bit_syndrome(int j) {
+  if (j < MODE_S_LONG_MSG_BITS-24)
+    return mode_s_checksum_table[j];
+  return 1 << (MODE_S_LONG_MSG_BITS-1-j); // Error in the checksum itself.
+}
+
+static uint32_t syndrome_hash(uint32_t syndrome) {
+  return ((syndrome * 0x9e3779b1) >> 24) & (MODE_S_SYNDROME_LEN-1);
+}
+
+static void syndrome_init(void) {
+  int j;
+  uint32_t h;
+
+  memset(syndrome_bit, -1, sizeof(syndrome_bit));
+  for (j = 0; j < MODE_S_LONG_MSG_BITS; j++) {
+    h = syndrome_hash(bit_syndrome(j));
+    while (syndrome_bit[h] >= 0)
+      h = (h+1) & (MODE_S_SYNDROME_LEN-1);
+    syndrome_crc[h] = bit_syndrome(j);
+    syndrome_bit[h] = j;
+  }
+  syndrome_initialized = 1;
+}
+
+// Return the bit position in a message of 'bits' bits that has the given
+// syndrome when flipped, or -1.
+static int syndrome_to_bit(uint32_t syndrome, int bits) {
+  uint32_t h = syndrome_hash(syndrome);
+
+  while (syndrome_bit[h] >= 0) {
+    if (syndrome_crc[h] == syndrome) {
+      int j = syndrome_bit[h] - (MODE_S_LONG_MSG_BITS-bits);
+      return (j >= 0) ? j : -1;
+    }
+    h = (h+1) & (MODE_S_SYNDROME_LEN-1);
+  }
+  return -1;
+}
+
+static uint32_t msg_syndrome(unsigned char *msg, int bits) {
+  uint32_t crc = ((uint32_t)msg[(bits/8)-3] << 16) |
+                 ((uint32_t)msg[(bits/8)-2] << 8) |
+                  (uint32_t)msg[(bits/8)-1];
+  return crc ^ mode_s_checksum(msg, bits);
+}
+
 // Try to fix single bit errors using the checksum. On success modifies the
 // original buffer with the fixed version, and returns the position of the
 // error bit. Otherwise if fixing failed -1 is returned.
 int fix_single_bit_errors(unsigned char *msg, int bits) {
   int j;
-  unsigned char aux[MODE_S_LONG_MSG_BITS/8];
 
-  for (j = 0; j < bits; j++) {
-    int byte = j/8;
-    int bitmask = 1 << (7-(j%8));
-    uint32_t crc1, crc2;
-
-    memcpy(aux, msg, bits/8);
-    aux[byte] ^= bitmask; // Flip j-th bit.
-
-    crc1 = ((uint32_t)aux[(bits/8)-3] << 16) |
-           ((uint32_t)aux[(bits/8)-2] << 8) |
-            (uint32_t)aux[(bits/8)-1];
-    crc2 = mode_s_checksum(aux, bits);
-
-    if (crc1 == crc2) {
-      // The error is fixed. Overwrite the original buffer with the
-      // corrected sequence, and returns the error bit position.
-      memcpy(msg, aux, bits/8);
-      return j;
-    }
-  }
-  return -1;
+  if (!syndrome_initialized)
+    syndrome_init();
+
+  j = syndrome_to_bit(msg_syndrome(msg, bits), bits);
+  if (j != -1)
+    msg[j/8] ^= 1 << (7-(j%8)); // Flip j-th bit.
+  return j;
 }
 
-// Similar to fix_single_bit_errors() but try every possible two bit
-// combination. This is very slow and should be tried only against DF17
-// messages that don't pass the checksum, and only in Aggressive Mode.
+// Similar to fix_single_bit_errors() but for every possible first bit, look up
+// the second bit that would account for the rest of the syndrome. Should be
+// tried only against DF17 messages that don't pass the checksum, and only in
+// Aggressive Mode.
 int fix_two_bits_errors(unsigned char *msg, int bits) {
   int j, i;
-  unsigned char aux[MODE_S_LONG_MSG_BITS/8];
+  uint32_t syndrome;
+  int offset = MODE_S_LONG_MSG_BITS-bits;
+
+  if (!syndrome_initialized)
+    syndrome_init();
 
+  syndrome = msg_syndrome(msg, bits);
   for (j = 0; j < bits; j++) {
-    int byte1 = j/8;
-    int bitmask1 = 1 << (7-(j%8));
-
-    // Don't check the same pairs multiple times, so i starts from j+1
-    for (i = j+1; i < bits; i++) {
-      int byte2 = i/8;
-      int bitmask2 = 1 << (7-(i%8));
-      uint32_t crc1, crc2;
-
-      memcpy(aux, msg, bits/8);
-
-      aux[byte1] ^= bitmask1; // Flip j-th bit.
-      aux[byte2] ^= bitmask2; // Flip i-th bit.
-
-      crc1 = ((uint32_t)aux[(bits/8)-3] << 16) |
-             ((uint32_t)aux[(bits/8)-2] << 8) |
-              (uint32_t)aux[(bits/8)-1];
-      crc2 = mode_s_checksum(aux, bits);
-
-      if (crc1 == crc2) {
-        // The error is fixed. Overwrite the original buffer with the
-        // corrected sequence, and returns the error bit position.
-        memcpy(msg, aux, bits/8);
-        // We return the two bits as a 16 bit integer by shifting 'i'
-        // on the left. This is possible since 'i' will always be
-        // non-zero because i starts from j+1.
-        return j | (i<<8);
-      }
+    i = syndrome_to_bit(syndrome ^ bit_syndrome(j+offset), bits);
+
+    // Pairs with i < j were already tried as (i, j).
+    if (i > j) {
+      msg[j/8] ^= 1 << (7-(j%8)); // Flip j-th bit.
+      msg[i/8] ^= 1 << (7-(i%8)); // Flip i-th bit.
+      // We return the two bits as a 16 bit integer by shifting 'i'
+      // on the left. This is possible since 'i' will always be
+      // non-zero because i starts from j+1.
+      return j | (i<<8);
     }
   }
   return -1;
@@ -8,6 +8,10 @@
 #include <math.h>
 #include <time.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define MODE_S_ICAO_CACHE_LEN 256 // Power of two required
 #define MODE_S_LONG_MSG_BYTES (112/8)
 #define MODE_S_UNIT_FEET 0
@@ -76,4 +80,13 @@ void mode_s_compute_magnitude_vector(unsigned char *data, uint16_t *mag, uint32_
 void mode_s_detect(mode_s_t *self, uint16_t *mag, uint32_t maglen, mode_s_callback_t);
 void mode_s_decode(mode_s_t *self, struct mode_s_msg *mm, unsigned char *msg);
 
+// Byte-wise CRC table for the Mode S polynomial, and the 24 bit checksum of
+// a message of 'bits' bits, without its own last 24 bits.
+extern const uint32_t mode_s_crc_table[256];
+uint32_t mode_s_checksum(unsigned char *msg, int bits);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif